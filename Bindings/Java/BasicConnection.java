@@ -19,6 +19,8 @@
 
 package org.a11y.brlapi;
 
+import java.nio.ByteBuffer;
+
 public class BasicConnection extends NativeLibrary {
   protected long connectionHandle;
 
@@ -40,10 +42,12 @@ public class BasicConnection extends NativeLibrary {
 
   protected native void writeText (int cursor, String text);
   public native void writeDots (byte[] dots);
+  public native void writeDirectDots (ByteBuffer dots);
   public native void write (WriteArguments arguments);
 
   public native long readKey (boolean wait);
   public native long readKeyWithTimeout (int milliseconds);
+  public native int readKeys (long[] codes, int milliseconds);
 
   public native void ignoreKeys (long type, long[] keys);
   public native void acceptKeys (long type, long[] keys);
@@ -19,10 +19,18 @@
 
 package org.a11y.brlapi;
 
+import java.nio.ByteBuffer;
+
 public class WriteArguments {
   private String text = null;
   private byte andMask[] = null;
   private byte orMask[] = null;
+
+  // direct buffers are handed to the library in place (not copied)
+  private ByteBuffer textBuffer = null;
+  private int textLength = 0;
+  private ByteBuffer andMaskBuffer = null;
+  private ByteBuffer orMaskBuffer = null;
   private int regionBegin = 0;
   private int regionSize = 0;
   private int cursorPosition = Constants.CURSOR_LEAVE;
@@ -37,6 +45,23 @@ public class WriteArguments {
 
   public WriteArguments setText (String text) {
     this.text = text;
+    textBuffer = null;
+    return this;
+  }
+
+  public ByteBuffer getTextBuffer () {
+    return textBuffer;
+  }
+
+  public int getTextLength () {
+    return textLength;
+  }
+
+  // the first length bytes of a direct buffer, encoded in UTF-8
+  public WriteArguments setTextBuffer (ByteBuffer text, int length) {
+    textBuffer = text;
+    textLength = length;
+    this.text = null;
     return this;
   }
 
@@ -46,6 +71,18 @@ public class WriteArguments {
 
   public WriteArguments setAndMask (byte[] mask) {
     andMask = mask;
+    andMaskBuffer = null;
+    return this;
+  }
+
+  public ByteBuffer getAndMaskBuffer () {
+    return andMaskBuffer;
+  }
+
+  // a direct buffer - one byte per cell of the region
+  public WriteArguments setAndMaskBuffer (ByteBuffer mask) {
+    andMaskBuffer = mask;
+    andMask = null;
     return this;
   }
 
@@ -55,6 +92,18 @@ public class WriteArguments {
 
   public WriteArguments setOrMask (byte[] mask) {
     orMask = mask;
+    orMaskBuffer = null;
+    return this;
+  }
+
+  public ByteBuffer getOrMaskBuffer () {
+    return orMaskBuffer;
+  }
+
+  // a direct buffer - one byte per cell of the region
+  public WriteArguments setOrMaskBuffer (ByteBuffer mask) {
+    orMaskBuffer = mask;
+    orMask = null;
     return this;
   }
 
@@ -114,6 +114,30 @@ throwConnectionError (JNIEnv *env) {
     JAVA_SET_FIELD((env), Long, (object), field, (jlong) (intptr_t) (value)); \
   } while (0)
 
+static void *
+getDirectBufferAddress (JNIEnv *env, jobject jBuffer, jlong size) {
+  void *address;
+
+  if (size < 0) {
+    throwJavaError(env, JAVA_OBJECT_ILLEGAL_ARGUMENT_EXCEPTION, "negative length");
+    return NULL;
+  }
+
+  address = (*env)->GetDirectBufferAddress(env, jBuffer);
+
+  if (!address) {
+    throwJavaError(env, JAVA_OBJECT_ILLEGAL_ARGUMENT_EXCEPTION, "not a direct buffer");
+    return NULL;
+  }
+
+  if ((*env)->GetDirectBufferCapacity(env, jBuffer) < size) {
+    throwJavaError(env, JAVA_OBJECT_ILLEGAL_ARGUMENT_EXCEPTION, "buffer too small");
+    return NULL;
+  }
+
+  return address;
+}
+
 static void BRLAPI_STDCALL
 exceptionHandler (brlapi_handle_t *handle, int error, brlapi_packetType_t type, const void *packet, size_t size) {
   GET_GLOBAL_JAVA_ENVIRONMENT(env);
@@ -495,6 +519,30 @@ JAVA_INSTANCE_METHOD(
   }
 }
 
+JAVA_INSTANCE_METHOD(
+  org_a11y_brlapi_BasicConnection, writeDirectDots, void,
+  jobject jDots
+) {
+  GET_CONNECTION_HANDLE(env, this, );
+  SET_GLOBAL_JAVA_ENVIRONMENT(env);
+
+  if (!jDots) {
+    throwJavaError(env, JAVA_OBJECT_NULL_POINTER_EXCEPTION, __func__);
+    return;
+  }
+
+  unsigned int columns, rows;
+  if (brlapi__getDisplaySize(handle, &columns, &rows) < 0) {
+    throwConnectionError(env);
+    return;
+  }
+
+  const unsigned char *dots = getDirectBufferAddress(env, jDots, (columns * rows));
+  if (!dots) return;
+
+  if (brlapi__writeDots(handle, dots) < 0) throwConnectionError(env);
+}
+
 JAVA_INSTANCE_METHOD(
   org_a11y_brlapi_BasicConnection, write, void,
   jobject jArguments
@@ -525,13 +573,63 @@ JAVA_INSTANCE_METHOD(
     cArguments.regionSize = JAVA_GET_FIELD(env, Int, jArguments, field);
   }
 
+  /* Direct buffers are used in place - they needn't be released, so they're
+   * checked before any string or array is acquired.
+   */
+
+  jobject jTextBuffer;
+  {
+    FIND_FIELD(env, field, class, "textBuffer", JAVA_SIG_BYTE_BUFFER, );
+
+    if ((jTextBuffer = JAVA_GET_FIELD(env, Object, jArguments, field))) {
+      FIND_FIELD(env, lengthField, class, "textLength", JAVA_SIG_INT, );
+      jint length = JAVA_GET_FIELD(env, Int, jArguments, lengthField);
+
+      if (!(cArguments.text = getDirectBufferAddress(env, jTextBuffer, length))) return;
+      cArguments.textSize = length;
+    }
+  }
+
+  jobject jAndMaskBuffer;
+  jobject jOrMaskBuffer;
+  {
+    FIND_FIELD(env, andField, class, "andMaskBuffer", JAVA_SIG_BYTE_BUFFER, );
+    FIND_FIELD(env, orField, class, "orMaskBuffer", JAVA_SIG_BYTE_BUFFER, );
+
+    jAndMaskBuffer = JAVA_GET_FIELD(env, Object, jArguments, andField);
+    jOrMaskBuffer = JAVA_GET_FIELD(env, Object, jArguments, orField);
+
+    if (jAndMaskBuffer || jOrMaskBuffer) {
+      unsigned int size = cArguments.regionSize;
+
+      if (!(cArguments.regionBegin || size)) {
+        unsigned int columns, rows;
+
+        if (brlapi__getDisplaySize(handle, &columns, &rows) < 0) {
+          throwConnectionError(env);
+          return;
+        }
+
+        size = columns * rows;
+      }
+
+      if (jAndMaskBuffer) {
+        if (!(cArguments.andMask = getDirectBufferAddress(env, jAndMaskBuffer, size))) return;
+      }
+
+      if (jOrMaskBuffer) {
+        if (!(cArguments.orMask = getDirectBufferAddress(env, jOrMaskBuffer, size))) return;
+      }
+    }
+  }
+
   jstring jText;
   {
     FIND_FIELD(env, field, class, "text", JAVA_SIG_STRING, );
 
     if ((jText = JAVA_GET_FIELD(env, Object, jArguments, field))) {
       cArguments.text = (char *) (*env)->GetStringUTFChars(env, jText, NULL);
-    } else {
+    } else if (!jTextBuffer) {
       cArguments.text = NULL;
     }
   }
@@ -542,7 +640,7 @@ JAVA_INSTANCE_METHOD(
 
     if ((jAndMask = JAVA_GET_FIELD(env, Object, jArguments, field))) {
       cArguments.andMask = (unsigned char *) (*env)->GetByteArrayElements(env, jAndMask, NULL);
-    } else {
+    } else if (!jAndMaskBuffer) {
       cArguments.andMask = NULL;
     }
   }
@@ -553,7 +651,7 @@ JAVA_INSTANCE_METHOD(
 
     if ((jOrMask = JAVA_GET_FIELD(env, Object, jArguments, field))) {
       cArguments.orMask = (unsigned char *) (*env)->GetByteArrayElements(env, jOrMask, NULL);
-    } else {
+    } else if (!jOrMaskBuffer) {
       cArguments.orMask = NULL;
     }
   }
@@ -615,6 +713,58 @@ JAVA_INSTANCE_METHOD(
   return (jlong)code;
 }
 
+JAVA_INSTANCE_METHOD(
+  org_a11y_brlapi_BasicConnection, readKeys, jint,
+  jlongArray jCodes, jint timeout_ms
+) {
+  GET_CONNECTION_HANDLE(env, this, -1);
+  SET_GLOBAL_JAVA_ENVIRONMENT(env);
+
+  if (!jCodes) {
+    throwJavaError(env, JAVA_OBJECT_NULL_POINTER_EXCEPTION, __func__);
+    return -1;
+  }
+
+  jsize size = (*env)->GetArrayLength(env, jCodes);
+  jsize count = 0;
+
+  /* Codes are collected locally and copied into the array in blocks so that
+   * draining the pending keys costs only a few calls back into the JVM.
+   */
+  jlong codes[0X40];
+  jsize pending = 0;
+
+  while ((count + pending) < size) {
+    brlapi_keyCode_t code;
+    int result = brlapi__readKeyWithTimeout(handle, ((count + pending)? 0: timeout_ms), &code);
+
+    if (result < 0) {
+      if (!(count + pending)) {
+        throwConnectionError(env);
+        return -1;
+      }
+
+      break;
+    }
+
+    if (!result) break;
+    codes[pending++] = code;
+
+    if (pending == (sizeof(codes) / sizeof(codes[0]))) {
+      (*env)->SetLongArrayRegion(env, jCodes, count, pending, codes);
+      count += pending;
+      pending = 0;
+    }
+  }
+
+  if (pending) {
+    (*env)->SetLongArrayRegion(env, jCodes, count, pending, codes);
+    count += pending;
+  }
+
+  return count;
+}
+
 JAVA_INSTANCE_METHOD(
   org_a11y_brlapi_BasicConnection, ignoreKeys, void,
   jlong jrange, jlongArray js
@@ -27,10 +27,12 @@ extern "C" {
 #endif /* __cplusplus */
 
 #define JAVA_OBJECT(name) "java/lang/" name
+#define JAVA_OBJECT_ILLEGAL_ARGUMENT_EXCEPTION JAVA_OBJECT("IllegalArgumentException")
 #define JAVA_OBJECT_ILLEGAL_STATE_EXCEPTION JAVA_OBJECT("IllegalStateException")
 #define JAVA_OBJECT_NULL_POINTER_EXCEPTION JAVA_OBJECT("NullPointerException")
 #define JAVA_OBJECT_OUT_OF_MEMORY_ERROR JAVA_OBJECT("OutOfMemoryError")
 #define JAVA_OBJECT_STRING JAVA_OBJECT("String")
+#define JAVA_OBJECT_BYTE_BUFFER "java/nio/ByteBuffer"
 
 #define JAVA_SIG_BYTE                      "B"
 #define JAVA_SIG_CHAR                      "C"
@@ -52,6 +54,7 @@ extern "C" {
   ((*(env))->GetMethodID((env), (class), JAVA_CONSTRUCTOR_NAME, JAVA_SIG_CONSTRUCTOR(arguments)))
 
 #define JAVA_SIG_STRING JAVA_SIG_OBJECT(JAVA_OBJECT_STRING)
+#define JAVA_SIG_BYTE_BUFFER JAVA_SIG_OBJECT(JAVA_OBJECT_BYTE_BUFFER)
 
 #define JAVA_METHOD(object,name,returns) \
   JNIEXPORT returns JNICALL Java_ ## object ## _ ## name (JNIEnv *env
@@ -67,6 +67,37 @@ if __name__ == "__main__":
   def writeProperty (name, value):
     sys.stdout.write(name + ": " + value + "\n")
 
+  def writeBufferObjects (brl):
+    import array
+
+    size = brl.displaySize[0] * brl.displaySize[1]
+    text = "buffer objects".ljust(size)[:size].encode("UTF-8")
+    kinds = ["memoryview/array/bytearray"]
+
+    brl.write(
+      regionBegin = 1, regionSize = size, charset = "UTF-8",
+      text = memoryview(text),
+      andMask = array.array("B", [0XFF] * size),
+      orMask = bytearray(size)
+    )
+
+    try:
+      import numpy
+    except ImportError:
+      numpy = None
+
+    if numpy:
+      brl.write(
+        regionBegin = 1, regionSize = size, charset = "UTF-8",
+        text = numpy.frombuffer(text, dtype=numpy.uint8),
+        andMask = numpy.full(size, 0XFF, dtype=numpy.uint8),
+        orMask = numpy.zeros(size, dtype=numpy.uint8)
+      )
+
+      kinds.append("numpy")
+
+    writeProperty("Buffer Objects", ", ".join(kinds))
+
   writeProperty("BrlAPI Version", ".".join(map(str, brlapi.getLibraryVersion())))
 
   try:
@@ -82,6 +113,8 @@ if __name__ == "__main__":
       writeProperty("Display Height", str(brl.displaySize[1]))
 
       brl.enterTtyMode()
+      writeBufferObjects(brl)
+
       timeout = 10
       brl.writeText("press keys (timeout is %d seconds)" % (timeout, ))
 
@@ -79,6 +79,7 @@ except brlapi.ConnectionError as e:
 ###############################################################################
 
 cimport c_brlapi
+from cpython.buffer cimport PyObject_GetBuffer, PyBuffer_Release, PyBUF_SIMPLE
 import errno
 include "constants.auto.pyx"
 
@@ -183,6 +184,25 @@ class ConnectionError(OperationError):
 		"""Authentication method used"""
 		return self.settings.auth
 
+cdef class ByteView:
+	"""Read-only view of the bytes of an object which supports the buffer protocol (bytes, bytearray, memoryview, array, numpy arrays, ...).
+	It lets them be given to libbrlapi without being copied."""
+	cdef Py_buffer view
+	cdef int acquired
+
+	def __cinit__(self, data):
+		PyObject_GetBuffer(data, &self.view, PyBUF_SIMPLE)
+		self.acquired = 1
+
+	def __dealloc__(self):
+		if self.acquired:
+			PyBuffer_Release(&self.view)
+
+cdef ByteView getByteView(data, encoding):
+	if (type(data) == unicode):
+		data = data.encode(encoding)
+	return ByteView(data)
+
 cdef class WriteStruct:
 	"""Structure containing arguments to be given to Connection.write()
 	See brlapi_writeArguments_t(3).
@@ -514,21 +534,74 @@ cdef class Connection:
 			charset = None):
 		"""Update a specific region of the braille display and apply and/or masks.
 		See brlapi_write(3).
-		* s : gives information necessary for the update"""
+		* s : gives information necessary for the update
+
+		When writeArguments isn't given, text, andMask and orMask may be any object which supports the buffer protocol (bytes, bytearray, memoryview, numpy arrays, ...). Their contents are given to libbrlapi without being copied. Unicode text is encoded as UTF-8, and unicode masks as latin1."""
 		cdef int retval
+		cdef c_brlapi.brlapi_writeArguments_t props
+		cdef ByteView textView
+		cdef ByteView andView
+		cdef ByteView orView
+		cdef unsigned int x
+		cdef unsigned int y
+		cdef unsigned int size
 		if not writeArguments:
-			writeArguments = WriteStruct()
+			props = c_brlapi.brlapi_writeArguments_initialized
+			if displayNumber != None:
+				props.displayNumber = displayNumber
+			if regionBegin != None:
+				props.regionBegin = regionBegin
+			if regionSize != None:
+				props.regionSize = regionSize
+			if cursor != None:
+				props.cursor = cursor
+			if text is not None:
+				if (type(text) == unicode):
+					if not charset:
+						charset = b"UTF-8"
+				textView = getByteView(text, 'UTF-8')
+				props.text = <char*>textView.view.buf
+				props.textSize = textView.view.len
+			if (andMask is not None) or (orMask is not None):
+				if props.regionBegin or props.regionSize:
+					size = props.regionSize
+				else:
+					with nogil:
+						retval = c_brlapi.brlapi__getDisplaySize(self.h, &x, &y)
+					if retval == -1:
+						raise OperationError()
+					size = x * y
+				if andMask is not None:
+					andView = getByteView(andMask, 'latin1')
+					if andView.view.len < size:
+						raise ValueError("andMask is shorter than the region")
+					props.andMask = <unsigned char*>andView.view.buf
+				if orMask is not None:
+					orView = getByteView(orMask, 'latin1')
+					if orView.view.len < size:
+						raise ValueError("orMask is shorter than the region")
+					props.orMask = <unsigned char*>orView.view.buf
+			if charset:
+				if (type(charset) == unicode):
+					charset = charset.encode('ASCII')
+				props.charset = charset
+			with nogil:
+				retval = c_brlapi.brlapi__write(self.h, &props)
+			if retval == -1:
+				raise OperationError()
+			else:
+				return retval
 		if displayNumber != None:
 			writeArguments.displayNumber = displayNumber
 		if regionBegin != None:
 			writeArguments.regionBegin = regionBegin
 		if regionSize != None:
 			writeArguments.regionSize = regionSize
-		if text:
+		if text is not None:
 			writeArguments.text = text
-		if andMask:
+		if andMask is not None:
 			writeArguments.attrAnd = andMask
-		if orMask:
+		if orMask is not None:
 			writeArguments.attrOr = orMask
 		if cursor != None:
 			writeArguments.cursor = cursor
@@ -544,20 +617,25 @@ cdef class Connection:
 	def writeDots(self, dots):
 		"""Write the given dots array to the display.
 		See brlapi_writeDots(3).
-		* dots : points on an array of dot information, one per character. Its size must hence be the same as what displaysize provides."""
+		* dots : points on an array of dot information, one per character. Its size must hence be the same as what displaysize provides.
+
+		dots may be any object which supports the buffer protocol (bytes, bytearray, memoryview, numpy arrays, ...). Its contents are given to libbrlapi without being copied unless it's shorter than the display, in which case it's padded with empty cells."""
 		cdef int retval
-		cdef char *c_dots
-		cdef unsigned char *c_udots
-		(x, y) = self.displaySize
-		dispSize = x * y
-		if (type(dots) == unicode):
-			dots = dots.encode('latin1')
-		if (len(dots) < dispSize):
-			dots = dots + b"".center(dispSize - len(dots), '\0')
-		c_dots = dots
-		c_udots = <unsigned char *>c_dots
+		cdef unsigned int x
+		cdef unsigned int y
+		cdef ByteView view
+		cdef ByteView paddedView
 		with nogil:
-			retval = c_brlapi.brlapi__writeDots(self.h, c_udots)
+			retval = c_brlapi.brlapi__getDisplaySize(self.h, &x, &y)
+		if retval == -1:
+			raise OperationError()
+		view = getByteView(dots, 'latin1')
+		if (view.view.len < x * y):
+			paddedView = ByteView(bytearray(x * y))
+			c_brlapi.memcpy(paddedView.view.buf, view.view.buf, view.view.len)
+			view = paddedView
+		with nogil:
+			retval = c_brlapi.brlapi__writeDots(self.h, <unsigned char*>view.view.buf)
 		if retval == -1:
 			raise OperationError()
 		else:
@@ -608,6 +686,44 @@ cdef class Connection:
 		else:
 			return code
 
+	def readKeys(self, wait = False, maximum = 64):
+		"""Read the pending keys from the braille keyboard.
+		See brlapi_readKey(3).
+
+		This function returns a list of up to maximum key codes. If wait is True, it first waits for a key press. It then takes all the keys which are already pending, without waiting any further. The global interpreter lock is released while reading, and the list is empty if no key is pending.
+
+		An event loop can watch fileno() (via select(), asyncio's add_reader(), ...) and call readKeys() when the connection becomes readable, thus draining several keys per call."""
+		cdef c_brlapi.brlapi_keyCode_t *codes
+		cdef int retval
+		cdef int c_wait
+		cdef int c_maximum
+		cdef int count
+		c_wait = wait
+		c_maximum = maximum
+		count = 0
+		retval = 0
+		if c_maximum <= 0:
+			return []
+		codes = <c_brlapi.brlapi_keyCode_t*>c_brlapi.malloc(c_maximum * sizeof(c_brlapi.brlapi_keyCode_t))
+		if not codes:
+			raise MemoryError()
+		with nogil:
+			while count < c_maximum:
+				retval = c_brlapi.brlapi__readKey(self.h, c_wait, &codes[count])
+				if retval <= 0:
+					break
+				count = count + 1
+				c_wait = 0
+		keys = [codes[i] for i in range(count)]
+		c_brlapi.free(codes)
+		if retval == -1 and count == 0:
+			raise OperationError()
+		return keys
+
+	def fileno(self):
+		"""Returns the Unix file descriptor that the connection uses, so that a Connection can be given directly to select() or to asyncio's add_reader()"""
+		return self.fd
+
 	def readKeyWithTimeout(self, timeout_ms = -1):
 		"""Read a key from the braille keyboard.
 		See brlapi_readKeyWithtimeout(3).
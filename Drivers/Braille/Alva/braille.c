@@ -1149,7 +1149,7 @@ writeBraille1 (BrailleDisplay *brl, const unsigned char *cells, int start, int c
   byte = mempcpy(byte, cells, count);
   byte = mempcpy(byte, trailer, sizeof(trailer));
 
-  return writeBraillePacket(brl, NULL, packet, byte-packet);
+  return writeBrailleFrame(brl, NULL, BRAILLE_CELLS_FRAME(start, count), packet, byte-packet);
 }
 
 static const ProtocolOperations protocol1Operations = {
@@ -1605,7 +1605,7 @@ writeBraille2s (BrailleDisplay *brl, const unsigned char *cells, int start, int
   *byte++ = count;
   byte = mempcpy(byte, cells, count);
 
-  return writeBraillePacket(brl, NULL, packet, byte-packet);
+  return writeBrailleFrame(brl, NULL, BRAILLE_CELLS_FRAME(start, count), packet, byte-packet);
 }
 
 static const SettingsUpdateEntry requiredSettings2s[] = {
@@ -1782,7 +1782,7 @@ writeBraille2u (BrailleDisplay *brl, const unsigned char *cells, int start, int
     *byte++ = length;
     byte = mempcpy(byte, cells, length);
 
-    if (!writeBraillePacket(brl, NULL, packet, byte-packet)) return 0;
+    if (!writeBrailleFrame(brl, NULL, BRAILLE_CELLS_FRAME(start, length), packet, byte-packet)) return 0;
     cells += length;
     start += length;
     count -= length;
@@ -1996,6 +1996,9 @@ brl_writeWindow (BrailleDisplay *brl, const wchar_t *text) {
   unsigned int from;
   unsigned int to;
 
+  /* the display is moved if the driver was constructed by a probe */
+  brailleDisplay = brl;
+
   if (cellsHaveChanged(previousText, brl->buffer, brl->textColumns, &from, &to, &textRewriteRequired)) {
     if (model->flags & MOD_FLAG_FORCE_FROM_0) from = 0;
 
@@ -1283,9 +1283,8 @@ getBaumPacket (BrailleDisplay *brl, BaumResponsePacket *packet) {
   return readBaumPacket(brl, packet->bytes, sizeof(*packet));
 }
 
-static int
-writeBaumPacket (BrailleDisplay *brl, const unsigned char *packet, int length) {
-  unsigned char buffer[1 + (length * 2)];
+static size_t
+escapeBaumPacket (unsigned char *buffer, const unsigned char *packet, int length) {
   unsigned char *byte = buffer;
   *byte++ = ESC;
 
@@ -1296,7 +1295,24 @@ writeBaumPacket (BrailleDisplay *brl, const unsigned char *packet, int length) {
         *byte++ = ESC;
   }
 
-  return writeBraillePacket(brl, NULL, buffer, (byte - buffer));
+  return byte - buffer;
+}
+
+static int
+writeBaumPacket (BrailleDisplay *brl, const unsigned char *packet, int length) {
+  unsigned char buffer[1 + (length * 2)];
+  size_t size = escapeBaumPacket(buffer, packet, length);
+
+  return writeBraillePacket(brl, NULL, buffer, size);
+}
+
+static int
+writeBaumDisplayData (BrailleDisplay *brl, const unsigned char *packet, int length) {
+  unsigned char buffer[1 + (length * 2)];
+  size_t size = escapeBaumPacket(buffer, packet, length);
+
+  /* only the latest display content matters so a queued one is replaced */
+  return writeBrailleFrame(brl, NULL, BAUM_REQ_DisplayData, buffer, size);
 }
 
 static int
@@ -1367,7 +1383,7 @@ writeBaumCells_all (BrailleDisplay *brl) {
   *byte++ = BAUM_REQ_DisplayData;
   byte = mempcpy(byte, externalCells, cellCount);
 
-  return writeBaumPacket(brl, packet, byte-packet);
+  return writeBaumDisplayData(brl, packet, byte-packet);
 }
 
 static int
@@ -1379,7 +1395,7 @@ writeBaumCells_start (BrailleDisplay *brl) {
   *byte++ = 0;
   byte = mempcpy(byte, externalCells, cellCount);
 
-  return writeBaumPacket(brl, packet, byte-packet);
+  return writeBaumDisplayData(brl, packet, byte-packet);
 }
 
 static int
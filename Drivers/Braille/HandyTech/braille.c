@@ -865,6 +865,7 @@ verifyPacket (
   size_t *length, void *data
 ) {
   unsigned char byte = bytes[size-1];
+  BraillePacketVerifierResult result = BRL_PVR_INCLUDE;
 
   switch (size) {
     case 1:
@@ -884,7 +885,12 @@ verifyPacket (
       break;
 
     case 3:
-      if (bytes[0] == HT_PKT_Extended) *length += byte;
+      if (bytes[0] == HT_PKT_Extended) {
+        *length += byte;
+
+        /* only the last byte still needs to be checked */
+        if (bytes[1] != HT_MODEL_ActiveBraille) result = BRL_PVR_SPAN;
+      }
       break;
 
     case 5:
@@ -904,7 +910,7 @@ verifyPacket (
     return BRL_PVR_INVALID;
   }
 
-  return BRL_PVR_INCLUDE;
+  return result;
 }
 
 static size_t
@@ -0,0 +1,154 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2018 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU Lesser General Public License, as published by the Free Software
+ * Foundation; either version 2.1 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-LGPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <string.h>
+
+#include "log.h"
+#include "parse.h"
+#include "timing.h"
+
+typedef enum {
+  PARM_COLUMNS,
+  PARM_ROWS
+} DriverParameter;
+#define BRLPARMS "columns", "rows"
+
+#include "brl_driver.h"
+
+#define MAXIMUM_TEXT_COLUMNS 0XFF
+#define MAXIMUM_TEXT_ROWS 0X10
+
+typedef struct {
+  TimeValue first;
+  TimeValue last;
+  long int longestInterval;
+
+  unsigned long int writes;
+  unsigned long int changes;
+  unsigned long int cells;
+} WriteStatistics;
+
+struct BrailleDataStruct {
+  struct {
+    unsigned char rewrite;
+    unsigned char *cells;
+  } text;
+
+  WriteStatistics statistics;
+};
+
+static int
+brl_construct (BrailleDisplay *brl, char **parameters, const char *device) {
+  if ((brl->data = malloc(sizeof(*brl->data)))) {
+    memset(brl->data, 0, sizeof(*brl->data));
+
+    {
+      static const int minimum = 1;
+      static const int maximum = MAXIMUM_TEXT_COLUMNS;
+
+      int columns = 80;
+
+      if (!validateInteger(&columns, parameters[PARM_COLUMNS], &minimum, &maximum)) {
+        logMessage(LOG_WARNING, "%s: %s", "invalid column count", parameters[PARM_COLUMNS]);
+      }
+
+      brl->textColumns = columns;
+    }
+
+    {
+      static const int minimum = 1;
+      static const int maximum = MAXIMUM_TEXT_ROWS;
+
+      int rows = 1;
+
+      if (!validateInteger(&rows, parameters[PARM_ROWS], &minimum, &maximum)) {
+        logMessage(LOG_WARNING, "%s: %s", "invalid row count", parameters[PARM_ROWS]);
+      }
+
+      brl->textRows = rows;
+    }
+
+    if ((brl->data->text.cells = malloc(brl->textColumns * brl->textRows))) {
+      brl->data->text.rewrite = 1;
+      return 1;
+    } else {
+      logMallocError();
+    }
+
+    free(brl->data);
+  } else {
+    logMallocError();
+  }
+
+  return 0;
+}
+
+static void
+brl_destruct (BrailleDisplay *brl) {
+  if (brl->data) {
+    const WriteStatistics *statistics = &brl->data->statistics;
+
+    if (statistics->writes) {
+      long int elapsed = millisecondsBetween(&statistics->first, &statistics->last);
+
+      logMessage(LOG_NOTICE,
+                 "sink braille: %lu writes (%lu changed, %lu cells) in %ld ms, longest interval %ld ms",
+                 statistics->writes, statistics->changes, statistics->cells,
+                 elapsed, statistics->longestInterval);
+    }
+
+    free(brl->data->text.cells);
+    free(brl->data);
+    brl->data = NULL;
+  }
+}
+
+static int
+brl_writeWindow (BrailleDisplay *brl, const wchar_t *text) {
+  WriteStatistics *statistics = &brl->data->statistics;
+  unsigned int count = brl->textColumns * brl->textRows;
+  unsigned int from, to;
+  TimeValue now;
+
+  getMonotonicTime(&now);
+
+  if (statistics->writes++) {
+    long int interval = millisecondsBetween(&statistics->last, &now);
+
+    if (interval > statistics->longestInterval) statistics->longestInterval = interval;
+  } else {
+    statistics->first = now;
+  }
+
+  statistics->last = now;
+
+  if (cellsHaveChanged(brl->data->text.cells, brl->buffer, count,
+                       &from, &to, &brl->data->text.rewrite)) {
+    statistics->changes += 1;
+    statistics->cells += to - from;
+  }
+
+  return 1;
+}
+
+static int
+brl_readCommand (BrailleDisplay *brl, KeyTableCommandContext context) {
+  return EOF;
+}
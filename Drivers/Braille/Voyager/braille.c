@@ -266,10 +266,9 @@ askResource (
 
 static const char *const serialDeviceNames[] = {"Serial Adapter", "Base Unit"};
 
-static int
-writeSerialPacket (BrailleDisplay *brl, unsigned char code, unsigned char *data, unsigned char count) {
-  unsigned char buffer[2 + (count * 2)];
-  unsigned char size = 0;
+static size_t
+makeSerialPacket (unsigned char *buffer, unsigned char code, const unsigned char *data, unsigned char count) {
+  size_t size = 0;
   unsigned char index;
 
   buffer[size++] = ESC;
@@ -279,6 +278,14 @@ writeSerialPacket (BrailleDisplay *brl, unsigned char code, unsigned char *data,
     if ((buffer[size++] = data[index]) == buffer[0])
       buffer[size++] = buffer[0];
 
+  return size;
+}
+
+static int
+writeSerialPacket (BrailleDisplay *brl, unsigned char code, unsigned char *data, unsigned char count) {
+  unsigned char buffer[2 + (count * 2)];
+  size_t size = makeSerialPacket(buffer, code, data, count);
+
   return writeBraillePacket(brl, NULL, buffer, size);
 }
 
@@ -496,7 +503,13 @@ writeSerialBraille (BrailleDisplay *brl, const unsigned char *cells, unsigned ch
   buffer[size++] = count;
   memcpy(&buffer[size], cells, count);
   size += count;
-  return writeSerialPacket(brl, 0X42, buffer, size);
+
+  {
+    unsigned char packet[2 + (size * 2)];
+    size_t length = makeSerialPacket(packet, 0X42, buffer, size);
+
+    return writeBrailleFrame(brl, NULL, BRAILLE_CELLS_FRAME(start, count), packet, length);
+  }
 }
 
 static int
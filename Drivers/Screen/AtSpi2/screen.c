@@ -95,6 +95,7 @@ static char *curPath;
 static long curNumRows, curNumCols;
 static wchar_t **curRows;
 static long *curRowLengths;
+static long curTextLength;
 static long curCaret,curPosX,curPosY;
 
 static DBusConnection *bus = NULL;
@@ -390,6 +391,7 @@ static void caretPosition(long caret) {
 }
 
 static void finiTerm(void) {
+  long i;
   logMessage(LOG_CATEGORY(SCREEN_DRIVER),
              "end of term %s:%s",curSender,curPath);
   free(curSender);
@@ -397,9 +399,14 @@ static void finiTerm(void) {
   free(curPath);
   curPath = NULL;
   curPosX = curPosY = 0;
+  for (i=0;i<curNumRows;i++)
+    free(curRows[i]);
   free(curRows);
   curRows = NULL;
+  free(curRowLengths);
+  curRowLengths = NULL;
   curNumCols = curNumRows = 0;
+  curTextLength = 0;
 }
 
 /* Get the role of an AT-SPI2 object */
@@ -523,6 +530,7 @@ static void restartTerm(const char *sender, const char *path) {
     free(curRows);
   }
   curNumRows = 0;
+  curTextLength = 0;
   free(curRowLengths);
   c = text;
   while (*c) {
@@ -555,6 +563,7 @@ static void restartTerm(const char *sender, const char *path) {
     curRows[i] = malloc((len + (d!=NULL)) * sizeof(*curRows[i]));
     e = c;
     my_mbsrtowcs(curRows[i],&e,len,NULL);
+    curTextLength += curRowLengths[i];
     if (d)
       curRows[i][len]='\n';
     else
@@ -567,9 +576,26 @@ static void restartTerm(const char *sender, const char *path) {
   free(text);
 }
 
+/* The row model no longer matches what the events describe, fetch the whole text again */
+static void resyncTerm(const char *sender, const char *path, const char *reason) {
+  logMessage(LOG_CATEGORY(SCREEN_DRIVER),
+             "resyncing term %s:%s: %s",sender,path,reason);
+  restartTerm(sender, path);
+}
+
 /* Switched to a new object, check whether we want to read it, and if so, restart with it */
 static void tryRestartTerm(const char *sender, const char *path) {
-  char *role = getRole(sender, path);
+  char *role;
+
+  if (curSender && !strcmp(sender, curSender) && !strcmp(path, curPath)) {
+    /* the row model has been kept up to date by the text change events */
+    logMessage(LOG_CATEGORY(SCREEN_DRIVER),
+               "state changed focus to current term");
+    caretPosition(getCaret(sender, path));
+    return;
+  }
+
+  role = getRole(sender, path);
   logMessage(LOG_CATEGORY(SCREEN_DRIVER),
              "state changed focus to role %s", role);
   if (typeFlags[TYPE_ALL] ||
@@ -853,6 +879,14 @@ static void AtSpi2HandleEvent(const char *interface, DBusMessage *message)
     dbus_message_iter_get_basic(&iter_variant, &deleted);
     logMessage(LOG_CATEGORY(SCREEN_DRIVER),
                "'%s'",deleted);
+    if ((detail1 < 0) || (toDelete < 0) || (detail1 + toDelete > curTextLength)) {
+      resyncTerm(sender, path, "deleting past end of text");
+      goto done;
+    }
+    if (*deleted && ((long)my_mbslen(deleted, strlen(deleted)) != toDelete)) {
+      resyncTerm(sender, path, "deleted text length mismatch");
+      goto done;
+    }
     downTo = y;
     if (downTo < curNumRows)
       length = curRowLengths[downTo];
@@ -890,6 +924,7 @@ static void AtSpi2HandleEvent(const char *interface, DBusMessage *message)
       /* imaginary extra lines don't need to be deleted */
       downTo=curNumRows-1;
     delRows(y+1,downTo-y);
+    curTextLength -= toDelete;
     caretPosition(curCaret);
   } else if (!strcmp(interface, "Object") && !strcmp(member, "TextChanged") && !strcmp(detail, "insert")) {
     long len=detail2,semilen,x,y;
@@ -907,6 +942,15 @@ static void AtSpi2HandleEvent(const char *interface, DBusMessage *message)
     dbus_message_iter_get_basic(&iter_variant, &added);
     logMessage(LOG_CATEGORY(SCREEN_DRIVER),
                "'%s'",added);
+    if ((detail1 < 0) || (detail1 > curTextLength)) {
+      resyncTerm(sender, path, "inserting past end of text");
+      goto done;
+    }
+    if ((long)my_mbslen(added, strlen(added)) != len) {
+      resyncTerm(sender, path, "inserted text length mismatch");
+      goto done;
+    }
+    curTextLength += len;
     adding = c = added;
     if (x && (c = strchr(adding,'\n'))) {
       /* splitting line */
@@ -961,6 +1005,7 @@ static void AtSpi2HandleEvent(const char *interface, DBusMessage *message)
   } else {
     return;
   }
+done:
   updated = 1;
 }
 
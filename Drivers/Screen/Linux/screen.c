@@ -38,6 +38,7 @@
 #include "log.h"
 #include "report.h"
 #include "async_io.h"
+#include "async_wait.h"
 #include "device.h"
 #include "io_misc.h"
 #include "timing.h"
@@ -52,9 +53,10 @@ typedef enum {
   PARM_CHARSET,
   PARM_DEBUGSFM,
   PARM_HFB,
+  PARM_INPUTPACING,
   PARM_VT,
 } ScreenParameters;
-#define SCRPARMS "charset", "debugsfm", "hfb", "vt"
+#define SCRPARMS "charset", "debugsfm", "hfb", "inputpacing", "vt"
 
 #include "scr_driver.h"
 #include "screen.h"
@@ -62,6 +64,7 @@ typedef enum {
 static const char *problemText;
 static unsigned int debugScreenFontMap;
 static int virtualTerminal;
+static int inputPacing;
 
 #define UNICODE_ROW_DIRECT 0XF000
 
@@ -1081,6 +1084,20 @@ processParameters_LinuxScreen (char **parameters) {
     }
   }
 
+  inputPacing = 0;
+  {
+    const char *parameter = parameters[PARM_INPUTPACING];
+
+    if (parameter && *parameter) {
+      static const int minimum = 0;
+      static const int maximum = 1000;
+
+      if (!validateInteger(&inputPacing, parameter, &minimum, &maximum)) {
+        logMessage(LOG_WARNING, "%s: %s", "invalid input pacing", parameter);
+      }
+    }
+  }
+
   virtualTerminal = 0;
   {
     const char *parameter = parameters[PARM_VT];
@@ -1964,6 +1981,36 @@ insertKey_LinuxScreen (ScreenKey key) {
   return ok;
 }
 
+static int
+insertCharacters_LinuxScreen (const wchar_t *characters, size_t count) {
+  const wchar_t *end = characters + count;
+  int batching = 0;
+  int ok = 1;
+
+  while (characters < end) {
+    if (!batching && uinputKeyboard) {
+      beginInputEvents(uinputKeyboard);
+      batching = 1;
+    }
+
+    if (!insertKey_LinuxScreen(*characters++)) {
+      ok = 0;
+      break;
+    }
+
+    if (inputPacing && (characters < end)) {
+      if (batching) flushInputEvents(uinputKeyboard);
+      asyncWait(inputPacing);
+    }
+  }
+
+  if (batching) {
+    if (!endInputEvents(uinputKeyboard)) ok = 0;
+  }
+
+  return ok;
+}
+
 typedef struct {
   char subcode;
   struct tiocl_selection selection;
@@ -2172,6 +2219,7 @@ scr_initialize (MainScreen *main) {
   main->base.describe = describe_LinuxScreen;
   main->base.readCharacters = readCharacters_LinuxScreen;
   main->base.insertKey = insertKey_LinuxScreen;
+  main->base.insertCharacters = insertCharacters_LinuxScreen;
   main->base.highlightRegion = highlightRegion_LinuxScreen;
   main->base.unhighlightRegion = unhighlightRegion_LinuxScreen;
   main->base.selectVirtualTerminal = selectVirtualTerminal_LinuxScreen;
@@ -0,0 +1,465 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2018 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU Lesser General Public License, as published by the Free Software
+ * Foundation; either version 2.1 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-LGPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "parse.h"
+#include "timing.h"
+#include "async_alarm.h"
+#include "report.h"
+
+typedef enum {
+  PARM_WORKLOAD,
+  PARM_RATE,
+  PARM_COLUMNS,
+  PARM_ROWS,
+  PARM_COUNT
+} ScreenParameters;
+#define SCRPARMS "workload", "rate", "columns", "rows", "count"
+
+#include "scr_driver.h"
+
+#define MAXIMUM_RATE MSECS_PER_SEC
+#define MAXIMUM_COLUMNS 0XFF
+#define MAXIMUM_ROWS 0XFF
+#define LATENCY_SAMPLE_LIMIT 0X10000
+
+typedef enum {
+  WORKLOAD_LOG,
+  WORKLOAD_REDRAW,
+  WORKLOAD_EDIT
+} Workload;
+
+static const char *const workloadNames[] = {
+  "log", "redraw", "edit", NULL
+};
+
+static unsigned int screenWorkload;
+static int changeRate;
+static int screenColumns;
+static int screenRows;
+static int changeLimit;
+
+static ScreenCharacter *screenCharacters = NULL;
+static int cursorColumn;
+static int cursorRow;
+
+static AsyncHandle changeAlarm = NULL;
+static ReportListenerInstance *windowUpdatedListener = NULL;
+static unsigned long int randomState;
+
+static struct {
+  unsigned long int changes;
+  unsigned long int coalesced;
+  unsigned long int updates;
+
+  TimeValue started;
+  clock_t processorTime;
+
+  TimeValue pendingChange;
+  unsigned hasPendingChange:1;
+  unsigned isStarted:1;
+  unsigned isFinished:1;
+  unsigned isReported:1;
+
+  long int *latencies;
+  unsigned int latencyCount;
+} statistics;
+
+static unsigned long int
+getRandomNumber (void) {
+  /* a fixed generator so that every run produces the same screens */
+  randomState = (randomState * 1103515245) + 12345;
+  return (randomState >> 16) & 0X7FFF;
+}
+
+static ScreenCharacter *
+getScreenRow (int row) {
+  return &screenCharacters[row * screenColumns];
+}
+
+static void
+clearScreenRow (int row) {
+  ScreenCharacter *character = getScreenRow(row);
+  const ScreenCharacter *end = character + screenColumns;
+
+  while (character < end) {
+    character->text = WC_C(' ');
+    character->attributes = SCR_COLOUR_DEFAULT;
+    character += 1;
+  }
+}
+
+static void
+setScreenRow (int row, const char *text) {
+  ScreenCharacter *character = getScreenRow(row);
+  const ScreenCharacter *end = character + screenColumns;
+
+  clearScreenRow(row);
+  while (*text && (character < end)) (character++)->text = *text++;
+}
+
+static void
+scrollScreen (void) {
+  memmove(getScreenRow(0), getScreenRow(1),
+          ARRAY_SIZE(screenCharacters, (screenRows - 1) * screenColumns));
+  clearScreenRow(screenRows - 1);
+}
+
+static void
+changeScreen_log (void) {
+  char line[MAXIMUM_COLUMNS + 1];
+
+  snprintf(line, sizeof(line),
+           "%06lu synthetic[%lu]: event %lu on unit %lu, value 0X%04lX",
+           statistics.changes, getRandomNumber() % 1000,
+           getRandomNumber(), getRandomNumber() % 16, getRandomNumber());
+
+  scrollScreen();
+  setScreenRow(screenRows-1, line);
+
+  cursorColumn = MIN(strlen(line), screenColumns-1);
+  cursorRow = screenRows - 1;
+}
+
+static void
+changeScreen_redraw (void) {
+  int row;
+
+  for (row=0; row<screenRows; row+=1) {
+    ScreenCharacter *character = getScreenRow(row);
+    const ScreenCharacter *end = character + screenColumns;
+
+    while (character < end) {
+      unsigned long int number = getRandomNumber();
+
+      character->text = (number & 0X7)? (WC_C('a') + (number % 26)): WC_C(' ');
+      character->attributes = (number & 0X100)? SCR_COLOUR_DEFAULT: (SCR_COLOUR_FG_BLACK | SCR_COLOUR_BG_LIGHT_GREY);
+      character += 1;
+    }
+  }
+
+  cursorColumn = getRandomNumber() % screenColumns;
+  cursorRow = getRandomNumber() % screenRows;
+}
+
+static void
+changeScreen_edit (void) {
+  ScreenCharacter *row = getScreenRow(cursorRow);
+  int rest = screenColumns - cursorColumn - 1;
+
+  switch (getRandomNumber() % 4) {
+    case 0:
+    case 1:
+      memmove(&row[cursorColumn+1], &row[cursorColumn], ARRAY_SIZE(row, rest));
+      row[cursorColumn].text = WC_C('a') + (getRandomNumber() % 26);
+      if (cursorColumn < (screenColumns - 1)) cursorColumn += 1;
+      break;
+
+    case 2:
+      memmove(&row[cursorColumn], &row[cursorColumn+1], ARRAY_SIZE(row, rest));
+      row[screenColumns-1].text = WC_C(' ');
+      break;
+
+    default:
+      switch (getRandomNumber() % 4) {
+        case 0:
+          if (cursorColumn > 0) cursorColumn -= 1;
+          break;
+
+        case 1:
+          if (cursorColumn < (screenColumns - 1)) cursorColumn += 1;
+          break;
+
+        case 2:
+          if (cursorRow > 0) cursorRow -= 1;
+          break;
+
+        default:
+          if (cursorRow < (screenRows - 1)) cursorRow += 1;
+          break;
+      }
+      break;
+  }
+}
+
+static int
+compareLatencies (const void *element1, const void *element2) {
+  const long int *latency1 = element1;
+  const long int *latency2 = element2;
+
+  if (*latency1 < *latency2) return -1;
+  if (*latency1 > *latency2) return 1;
+  return 0;
+}
+
+static void
+logScreenStatistics (void) {
+  long int elapsed = MAX(getMonotonicElapsed(&statistics.started), 1);
+  unsigned long int updates = MAX(statistics.updates, 1);
+  clock_t processorTime = clock() - statistics.processorTime;
+
+  logMessage(LOG_NOTICE,
+             "synthetic screen: %s: %lu changes (%lu coalesced), %lu updates in %ld ms: %lu updates/s, %lu us CPU per update",
+             workloadNames[screenWorkload],
+             statistics.changes, statistics.coalesced, statistics.updates, elapsed,
+             (statistics.updates * MSECS_PER_SEC) / elapsed,
+             (unsigned long int)(((double)processorTime * USECS_PER_SEC / CLOCKS_PER_SEC) / updates));
+
+  if (statistics.latencyCount) {
+    long int *latencies = statistics.latencies;
+    unsigned int count = statistics.latencyCount;
+
+    qsort(latencies, count, sizeof(*latencies), compareLatencies);
+
+    logMessage(LOG_NOTICE,
+               "synthetic screen: change to braille latency (us): p50 %ld, p90 %ld, p99 %ld, max %ld",
+               latencies[(count * 50) / 100], latencies[(count * 90) / 100],
+               latencies[(count * 99) / 100], latencies[count - 1]);
+  }
+
+  statistics.isReported = 1;
+}
+
+ASYNC_ALARM_CALLBACK(syHandleChangeAlarm);
+
+static void
+startWorkload (void) {
+  int interval = MSECS_PER_SEC / changeRate;
+
+  statistics.isStarted = 1;
+  getMonotonicTime(&statistics.started);
+  statistics.processorTime = clock();
+
+  if (asyncNewRelativeAlarm(&changeAlarm, interval, syHandleChangeAlarm, NULL)) {
+    if (asyncResetAlarmEvery(changeAlarm, interval)) {
+      logMessage(LOG_INFO, "synthetic screen: %s workload, %d changes/s, %dx%d",
+                 workloadNames[screenWorkload], changeRate, screenColumns, screenRows);
+      return;
+    }
+
+    asyncCancelRequest(changeAlarm);
+    changeAlarm = NULL;
+  }
+
+  logMessage(LOG_WARNING, "synthetic screen: workload not started");
+}
+
+REPORT_LISTENER(syBrailleWindowUpdatedListener) {
+  if (!statistics.isStarted) return;
+
+  statistics.updates += 1;
+
+  if (statistics.hasPendingChange) {
+    TimeValue now;
+
+    getMonotonicTime(&now);
+    statistics.hasPendingChange = 0;
+
+    if (statistics.latencyCount < LATENCY_SAMPLE_LIMIT) {
+      statistics.latencies[statistics.latencyCount++] =
+        ((now.seconds - statistics.pendingChange.seconds) * USECS_PER_SEC) +
+        ((now.nanoseconds - statistics.pendingChange.nanoseconds) / NSECS_PER_USEC);
+    }
+  }
+
+  if (statistics.isFinished && !statistics.isReported) logScreenStatistics();
+}
+
+ASYNC_ALARM_CALLBACK(syHandleChangeAlarm) {
+  typedef void ScreenChanger (void);
+
+  static ScreenChanger *const changers[] = {
+    [WORKLOAD_LOG] = changeScreen_log,
+    [WORKLOAD_REDRAW] = changeScreen_redraw,
+    [WORKLOAD_EDIT] = changeScreen_edit
+  };
+
+  changers[screenWorkload]();
+  statistics.changes += 1;
+
+  if (statistics.hasPendingChange) {
+    statistics.coalesced += 1;
+  } else {
+    getMonotonicTime(&statistics.pendingChange);
+    statistics.hasPendingChange = 1;
+  }
+
+  if (changeLimit && (statistics.changes == changeLimit)) {
+    asyncCancelRequest(changeAlarm);
+    changeAlarm = NULL;
+    statistics.isFinished = 1;
+  }
+
+  mainScreenUpdated();
+}
+
+static int
+processParameters_SyntheticScreen (char **parameters) {
+  screenWorkload = WORKLOAD_LOG;
+  if (!validateChoice(&screenWorkload, parameters[PARM_WORKLOAD], workloadNames)) {
+    logMessage(LOG_WARNING, "%s: %s", "invalid workload", parameters[PARM_WORKLOAD]);
+  }
+
+  {
+    static const int minimum = 1;
+    static const int maximum = MAXIMUM_RATE;
+
+    changeRate = 100;
+    if (!validateInteger(&changeRate, parameters[PARM_RATE], &minimum, &maximum)) {
+      logMessage(LOG_WARNING, "%s: %s", "invalid change rate", parameters[PARM_RATE]);
+    }
+  }
+
+  {
+    static const int minimum = 1;
+    static const int maximum = MAXIMUM_COLUMNS;
+
+    screenColumns = 80;
+    if (!validateInteger(&screenColumns, parameters[PARM_COLUMNS], &minimum, &maximum)) {
+      logMessage(LOG_WARNING, "%s: %s", "invalid column count", parameters[PARM_COLUMNS]);
+    }
+  }
+
+  {
+    static const int minimum = 1;
+    static const int maximum = MAXIMUM_ROWS;
+
+    screenRows = 25;
+    if (!validateInteger(&screenRows, parameters[PARM_ROWS], &minimum, &maximum)) {
+      logMessage(LOG_WARNING, "%s: %s", "invalid row count", parameters[PARM_ROWS]);
+    }
+  }
+
+  {
+    static const int minimum = 0;
+
+    changeLimit = 0;
+    if (!validateInteger(&changeLimit, parameters[PARM_COUNT], &minimum, NULL)) {
+      logMessage(LOG_WARNING, "%s: %s", "invalid change count", parameters[PARM_COUNT]);
+    }
+  }
+
+  return 1;
+}
+
+static int
+construct_SyntheticScreen (void) {
+  memset(&statistics, 0, sizeof(statistics));
+  randomState = 1;
+
+  if ((screenCharacters = malloc(ARRAY_SIZE(screenCharacters, screenColumns * screenRows)))) {
+    if ((statistics.latencies = malloc(ARRAY_SIZE(statistics.latencies, LATENCY_SAMPLE_LIMIT)))) {
+      if ((windowUpdatedListener = registerReportListener(REPORT_BRAILLE_WINDOW_UPDATED, syBrailleWindowUpdatedListener, NULL))) {
+        int row;
+
+        for (row=0; row<screenRows; row+=1) clearScreenRow(row);
+        cursorColumn = cursorRow = 0;
+        return 1;
+      }
+
+      free(statistics.latencies);
+      statistics.latencies = NULL;
+    } else {
+      logMallocError();
+    }
+
+    free(screenCharacters);
+    screenCharacters = NULL;
+  } else {
+    logMallocError();
+  }
+
+  return 0;
+}
+
+static void
+destruct_SyntheticScreen (void) {
+  if (changeAlarm) {
+    asyncCancelRequest(changeAlarm);
+    changeAlarm = NULL;
+  }
+
+  if (windowUpdatedListener) {
+    unregisterReportListener(windowUpdatedListener);
+    windowUpdatedListener = NULL;
+  }
+
+  if (statistics.isStarted && !statistics.isReported) logScreenStatistics();
+
+  if (statistics.latencies) {
+    free(statistics.latencies);
+    statistics.latencies = NULL;
+  }
+
+  if (screenCharacters) {
+    free(screenCharacters);
+    screenCharacters = NULL;
+  }
+}
+
+static int
+poll_SyntheticScreen (void) {
+  return 0;
+}
+
+static void
+describe_SyntheticScreen (ScreenDescription *description) {
+  description->cols = screenColumns;
+  description->rows = screenRows;
+  description->posx = cursorColumn;
+  description->posy = cursorRow;
+  description->number = 1;
+}
+
+static int
+readCharacters_SyntheticScreen (const ScreenBox *box, ScreenCharacter *buffer) {
+  if (!validateScreenBox(box, screenColumns, screenRows)) return 0;
+
+  /* startup delays (messages, driver start, etc) mustn't skew the results
+   * so the workload begins when the screen is first read for an update
+   */
+  if (!statistics.isStarted) startWorkload();
+
+  {
+    int row;
+
+    for (row=box->top; row<(box->top + box->height); row+=1) {
+      memcpy(buffer, &getScreenRow(row)[box->left], ARRAY_SIZE(buffer, box->width));
+      buffer += box->width;
+    }
+  }
+
+  return 1;
+}
+
+static void
+scr_initialize (MainScreen *main) {
+  initializeRealScreen(main);
+  main->base.poll = poll_SyntheticScreen;
+  main->base.describe = describe_SyntheticScreen;
+  main->base.readCharacters = readCharacters_SyntheticScreen;
+  main->processParameters = processParameters_SyntheticScreen;
+  main->construct = construct_SyntheticScreen;
+  main->destruct = destruct_SyntheticScreen;
+}
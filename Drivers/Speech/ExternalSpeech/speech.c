@@ -40,27 +40,97 @@
 
 #ifdef __MINGW32__
 #include <io.h>
+#else /* __MINGW32__ */
+#include <signal.h>
+#include <sys/wait.h>
 #endif /* __MINGW32__ */
 
 #include "log.h"
+#include "parse.h"
 #include "timing.h"
+#include "queue.h"
 #include "async_io.h"
+#include "async_alarm.h"
 
 typedef enum {
   PARM_PROGRAM=0,
-  PARM_UID, PARM_GID
+  PARM_UID, PARM_GID,
+  PARM_PROTOCOL
 } DriverParameter;
-#define SPKPARMS "program", "uid", "gid"
+#define SPKPARMS "program", "uid", "gid", "protocol"
 
 #include "spk_driver.h"
 #include "speech.h"
 
 static int helper_fd_in = -1, helper_fd_out = -1;
+#ifndef __MINGW32__
+static pid_t helperProcess = -1;
+#endif /* __MINGW32__ */
 static uint16_t totalCharacterCount;
 
 #define TRACK_DATA_SIZE 2
 static AsyncHandle trackHandle = NULL;
 
+static const char *extProgPath;
+#ifndef __MINGW32__
+static uid_t helperUid;
+static gid_t helperGid;
+#endif /* __MINGW32__ */
+
+/* Protocol 2: every message, in either direction, is a frame consisting of
+ * a fixed header (type, reserved byte, 32-bit request identifier, 32-bit
+ * payload length - all big-endian) followed by its payload. See the README.
+ */
+#define XS_PROTOCOL_VERSION 2
+#define XS_HEADER_SIZE 10
+#define XS_INPUT_SIZE 0X100
+#define XS_RESTART_DELAY 1000
+#define XS_RESTART_LIMIT 5
+
+typedef enum {
+  XS_REQ_HELLO    = 0X00,
+  XS_REQ_SAY      = 0X01,
+  XS_REQ_MUTE     = 0X02,
+  XS_REQ_RATE     = 0X03,
+
+  XS_RSP_HELLO    = 0X80,
+  XS_RSP_LOCATION = 0X81,
+  XS_RSP_DONE     = 0X82,
+  XS_RSP_MUTED    = 0X83
+} XsFrameType;
+
+typedef struct {
+  XsFrameType type;
+  size_t size;
+  size_t written;
+  unsigned char bytes[];
+} XsOutputFrame;
+
+typedef struct {
+  uint32_t identifier;
+  size_t count;
+} XsUtterance;
+
+static unsigned int protocolVersion;
+
+static struct {
+  Queue *output;
+  AsyncHandle outputMonitor;
+
+  Queue *utterances;
+  uint32_t nextIdentifier;
+  uint32_t muteIdentifier;
+
+  AsyncHandle restartAlarm;
+  unsigned int restartCount;
+
+  unsigned haveRate:1;
+  unsigned char rate;
+} xs;
+
+static int xsStartHelper (volatile SpeechSynthesizer *spk);
+static void xsStopHelper (void);
+
 #define ERRBUFLEN 200
 static void myerror(volatile SpeechSynthesizer *spk, char *fmt, ...)
 {
@@ -75,7 +145,7 @@ static void myerror(volatile SpeechSynthesizer *spk, char *fmt, ...)
   buf[ERRBUFLEN-1] = 0;
   va_end(argp);
   logMessage(LOG_ERR, "%s", buf);
-  spk_destruct(spk);
+  if (protocolVersion != XS_PROTOCOL_VERSION) spk_destruct(spk);
 }
 static void myperror(volatile SpeechSynthesizer *spk, char *fmt, ...)
 {
@@ -92,7 +162,7 @@ static void myperror(volatile SpeechSynthesizer *spk, char *fmt, ...)
   buf[ERRBUFLEN-1] = 0;
   va_end(argp);
   logMessage(LOG_ERR, "%s", buf);
-  spk_destruct(spk);
+  if (protocolVersion != XS_PROTOCOL_VERSION) spk_destruct(spk);
 }
 
 static void mywrite(volatile SpeechSynthesizer *spk, int fd, const void *buf, int len)
@@ -117,9 +187,248 @@ static void mywrite(volatile SpeechSynthesizer *spk, int fd, const void *buf, in
     myerror(spk, "ExternalSpeech: pipe to helper program: write timed out");
 }
 
+static void
+xsPutBigEndian (unsigned char *bytes, uint32_t value, int size)
+{
+  while (size > 0) {
+    bytes[--size] = value & 0XFF;
+    value >>= 8;
+  }
+}
+
+static uint32_t
+xsGetBigEndian (const unsigned char *bytes, int size)
+{
+  uint32_t value = 0;
+
+  while (size > 0) {
+    value = (value << 8) | *bytes++;
+    size -= 1;
+  }
+
+  return value;
+}
+
+static void
+xsDeallocateItem (void *item, void *data)
+{
+  free(item);
+}
+
+static int
+xsCompareFrames (const void *newItem, const void *existingItem, void *queueData)
+{
+  const XsOutputFrame *newFrame = newItem;
+  const XsOutputFrame *existingFrame = existingItem;
+
+  /* a mute request overtakes everything which hasn't started going out */
+  return (newFrame->type == XS_REQ_MUTE)
+      && (existingFrame->type != XS_REQ_MUTE)
+      && !existingFrame->written;
+}
+
+static void xsScheduleRestart (volatile SpeechSynthesizer *spk);
+
+static void
+xsHelperFailed (volatile SpeechSynthesizer *spk, const char *problem)
+{
+  logMessage(LOG_WARNING, "ExternalSpeech: %s", problem);
+  xsStopHelper();
+
+  /* a partially written frame would corrupt the next helper's input */
+  deleteElements(xs.output);
+
+  /* the helper won't report on what it was saying */
+  if (getQueueSize(xs.utterances)) {
+    deleteElements(xs.utterances);
+    tellSpeechFinished(spk);
+  }
+
+  if (!xs.restartAlarm) {
+    if (xs.restartCount < XS_RESTART_LIMIT) {
+      xs.restartCount += 1;
+      logMessage(LOG_INFO, "ExternalSpeech: restarting helper program (attempt %u)", xs.restartCount);
+      xsScheduleRestart(spk);
+    } else {
+      logMessage(LOG_ERR, "ExternalSpeech: helper program failed too often");
+    }
+  }
+}
+
+ASYNC_MONITOR_CALLBACK(xsHandleOutputMonitor);
+
+static int
+xsWriteOutput (volatile SpeechSynthesizer *spk)
+{
+  Element *element;
+
+  while ((element = getQueueHead(xs.output))) {
+    XsOutputFrame *frame = getElementItem(element);
+    ssize_t count = write(helper_fd_out, &frame->bytes[frame->written], frame->size - frame->written);
+
+    if (count == -1) {
+      if (errno == EINTR) continue;
+
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        if (!xs.outputMonitor) {
+          if (!asyncMonitorFileOutput(&xs.outputMonitor, helper_fd_out,
+                                      xsHandleOutputMonitor, (void *)spk)) {
+            xsHelperFailed(spk, "unable to monitor output to helper program");
+            return 0;
+          }
+        }
+
+        return 1;
+      }
+
+      logSystemError("ExternalSpeech: pipe to helper program: write");
+      xsHelperFailed(spk, "helper program not accepting output");
+      return 0;
+    }
+
+    if ((frame->written += count) == frame->size) {
+      free(dequeueItem(xs.output));
+    }
+  }
+
+  return 1;
+}
+
+ASYNC_MONITOR_CALLBACK(xsHandleOutputMonitor)
+{
+  volatile SpeechSynthesizer *spk = parameters->data;
+
+  asyncDiscardHandle(xs.outputMonitor);
+  xs.outputMonitor = NULL;
+
+  if (parameters->error) {
+    logActionError(parameters->error, "ExternalSpeech output monitor");
+    xsHelperFailed(spk, "helper program output error");
+  } else {
+    xsWriteOutput(spk);
+  }
+
+  return 0;
+}
+
+static XsOutputFrame *
+xsNewFrame (XsFrameType type, uint32_t identifier, size_t length)
+{
+  XsOutputFrame *frame;
+  size_t size = XS_HEADER_SIZE + length;
+
+  if ((frame = malloc(sizeof(*frame) + size))) {
+    frame->type = type;
+    frame->size = size;
+    frame->written = 0;
+
+    frame->bytes[0] = type;
+    frame->bytes[1] = 0;
+    xsPutBigEndian(&frame->bytes[2], identifier, 4);
+    xsPutBigEndian(&frame->bytes[6], length, 4);
+    return frame;
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+static int
+xsSendFrame (volatile SpeechSynthesizer *spk, XsOutputFrame *frame)
+{
+  if ((helper_fd_out < 0) || !enqueueItem(xs.output, frame)) {
+    free(frame);
+    return 0;
+  }
+
+  if (xs.outputMonitor) return 1;
+  return xsWriteOutput(spk);
+}
+
+static void
+xsSendRate (volatile SpeechSynthesizer *spk)
+{
+  XsOutputFrame *frame;
+
+  if ((frame = xsNewFrame(XS_REQ_RATE, xs.nextIdentifier++, 4))) {
+    float expand = 1.0 / getFloatSpeechRate(xs.rate);
+    uint32_t bits;
+
+    memcpy(&bits, &expand, sizeof(bits));
+    xsPutBigEndian(&frame->bytes[XS_HEADER_SIZE], bits, 4);
+    xsSendFrame(spk, frame);
+  }
+}
+
+static void
+xsSay (volatile SpeechSynthesizer *spk, const unsigned char *text, size_t length, size_t count, const unsigned char *attributes)
+{
+  size_t attributesLength = attributes? count: 0;
+  XsOutputFrame *frame;
+
+  if ((frame = xsNewFrame(XS_REQ_SAY, xs.nextIdentifier, 8 + length + attributesLength))) {
+    unsigned char *payload = &frame->bytes[XS_HEADER_SIZE];
+    XsUtterance *utterance;
+
+    xsPutBigEndian(payload, length, 4);
+    xsPutBigEndian(payload+4, count, 4);
+    memcpy(payload+8, text, length);
+    if (attributes) memcpy(payload+8+length, attributes, attributesLength);
+
+    if ((utterance = malloc(sizeof(*utterance)))) {
+      utterance->identifier = xs.nextIdentifier++;
+      utterance->count = count;
+
+      if (enqueueItem(xs.utterances, utterance)) {
+        if (xsSendFrame(spk, frame)) return;
+        deleteItem(xs.utterances, utterance);
+        return;
+      }
+
+      free(utterance);
+    } else {
+      logMallocError();
+    }
+
+    free(frame);
+  }
+}
+
+static int
+xsTestUnsentText (const void *item, void *data)
+{
+  const XsOutputFrame *frame = item;
+
+  return (frame->type == XS_REQ_SAY) && !frame->written;
+}
+
+static void
+xsMute (volatile SpeechSynthesizer *spk)
+{
+  XsOutputFrame *frame;
+  Element *element;
+
+  /* text which hasn't started going out yet doesn't need to be sent at all */
+  while ((element = findElement(xs.output, xsTestUnsentText, NULL))) {
+    deleteElement(element);
+  }
+
+  deleteElements(xs.utterances);
+  xs.muteIdentifier = xs.nextIdentifier++;
+
+  if ((frame = xsNewFrame(XS_REQ_MUTE, xs.muteIdentifier, 0))) {
+    xsSendFrame(spk, frame);
+  }
+}
+
 static void spk_say(volatile SpeechSynthesizer *spk, const unsigned char *text, size_t length, size_t count, const unsigned char *attributes)
 {
   unsigned char l[5];
+  if (protocolVersion == XS_PROTOCOL_VERSION) {
+    xsSay(spk, text, length, count, attributes);
+    return;
+  }
   if(helper_fd_out < 0) return;
   l[0] = 4; /* say code */
   l[1] = length >> 8;
@@ -140,6 +449,11 @@ static void spk_say(volatile SpeechSynthesizer *spk, const unsigned char *text,
 static void spk_mute (volatile SpeechSynthesizer *spk)
 {
   unsigned char c = 1;
+  if (protocolVersion == XS_PROTOCOL_VERSION) {
+    logMessage(LOG_DEBUG,"mute");
+    xsMute(spk);
+    return;
+  }
   if(helper_fd_out < 0) return;
   logMessage(LOG_DEBUG,"mute");
   mywrite(spk, helper_fd_out, &c,1);
@@ -150,6 +464,13 @@ static void spk_setRate (volatile SpeechSynthesizer *spk, unsigned char setting)
   float expand = 1.0 / getFloatSpeechRate(setting); 
   unsigned char *p = (unsigned char *)&expand;
   unsigned char l[5];
+  if (protocolVersion == XS_PROTOCOL_VERSION) {
+    logMessage(LOG_DEBUG,"set rate to %u (time scale %f)", setting, expand);
+    xs.rate = setting;
+    xs.haveRate = 1;
+    xsSendRate(spk);
+    return;
+  }
   if(helper_fd_out < 0) return;
   logMessage(LOG_DEBUG,"set rate to %u (time scale %f)", setting, expand);
   l[0] = 3; /* time scale code */
@@ -184,14 +505,192 @@ ASYNC_INPUT_CALLBACK(xsHandleSpeechTrackingInput) {
   return 0;
 }
 
-static int spk_construct (volatile SpeechSynthesizer *spk, char **parameters)
+static int
+xsTestUtterance (const void *item, void *data)
 {
-  char *extProgPath = parameters[PARM_PROGRAM];
+  const XsUtterance *utterance = item;
+  const uint32_t *identifier = data;
 
-  spk->setRate = spk_setRate;
+  return utterance->identifier == *identifier;
+}
 
-  if(!*extProgPath) extProgPath = HELPER_PROG_PATH;
+static int
+xsIsStale (uint32_t identifier)
+{
+  /* anything requested before the most recent mute is no longer of interest */
+  return (int32_t)(identifier - xs.muteIdentifier) <= 0;
+}
+
+static void
+xsHandleFrame (volatile SpeechSynthesizer *spk, XsFrameType type, uint32_t identifier, const unsigned char *payload, size_t length)
+{
+  switch (type) {
+    case XS_RSP_HELLO:
+      if (length >= 2) {
+        logMessage(LOG_DEBUG, "ExternalSpeech: helper protocol version %u",
+                   (unsigned int)xsGetBigEndian(payload, 2));
+      }
+
+      xs.restartCount = 0;
+      break;
 
+    case XS_RSP_LOCATION:
+      if (!xsIsStale(identifier) && (length >= 4)) {
+        const XsUtterance *utterance = findItem(xs.utterances, xsTestUtterance, &identifier);
+
+        if (utterance) {
+          uint32_t location = xsGetBigEndian(payload, 4);
+
+          if (location < utterance->count) tellSpeechLocation(spk, location);
+        }
+      }
+      break;
+
+    case XS_RSP_DONE:
+      if (!xsIsStale(identifier)) {
+        Element *element = findElement(xs.utterances, xsTestUtterance, &identifier);
+
+        if (element) {
+          deleteElement(element);
+          if (!getQueueSize(xs.utterances)) tellSpeechFinished(spk);
+        }
+      }
+      break;
+
+    case XS_RSP_MUTED:
+      logMessage(LOG_DEBUG, "ExternalSpeech: mute %u acknowledged", (unsigned int)identifier);
+      break;
+
+    default:
+      logMessage(LOG_DEBUG, "ExternalSpeech: unknown frame type: %02X", type);
+      break;
+  }
+}
+
+ASYNC_INPUT_CALLBACK(xsHandleFrameInput) {
+  volatile SpeechSynthesizer *spk = parameters->data;
+
+  if (parameters->error || parameters->end) {
+    /* the read request ends with this call */
+    asyncDiscardHandle(trackHandle);
+    trackHandle = NULL;
+
+    if (parameters->error) {
+      logMessage(LOG_WARNING, "speech tracking input error: %s", strerror(parameters->error));
+      xsHelperFailed(spk, "helper program input error");
+    } else {
+      xsHelperFailed(spk, "helper program ended");
+    }
+  } else {
+    const unsigned char *buffer = parameters->buffer;
+    size_t left = parameters->length;
+
+    while (left >= XS_HEADER_SIZE) {
+      uint32_t length = xsGetBigEndian(&buffer[6], 4);
+      size_t size = XS_HEADER_SIZE + length;
+
+      if (size > XS_INPUT_SIZE) {
+        /* Framing has been lost. Closing the helper's input makes it end,
+         * which is then handled (above) like any other helper failure.
+         */
+        logMessage(LOG_WARNING, "ExternalSpeech: helper program sent an oversized frame");
+
+        if (xs.outputMonitor) {
+          asyncCancelRequest(xs.outputMonitor);
+          xs.outputMonitor = NULL;
+        }
+
+        if (helper_fd_out >= 0) {
+          close(helper_fd_out);
+          helper_fd_out = -1;
+        }
+
+        return parameters->length;
+      }
+
+      if (left < size) break;
+      xsHandleFrame(spk, buffer[0], xsGetBigEndian(&buffer[2], 4), &buffer[XS_HEADER_SIZE], length);
+
+      buffer += size;
+      left -= size;
+    }
+
+    return parameters->length - left;
+  }
+
+  return 0;
+}
+
+static int
+xsSendHello (volatile SpeechSynthesizer *spk)
+{
+  XsOutputFrame *frame;
+
+  if (!(frame = xsNewFrame(XS_REQ_HELLO, xs.nextIdentifier++, 2))) return 0;
+  xsPutBigEndian(&frame->bytes[XS_HEADER_SIZE], XS_PROTOCOL_VERSION, 2);
+  return xsSendFrame(spk, frame);
+}
+
+ASYNC_ALARM_CALLBACK(xsHandleRestartAlarm) {
+  volatile SpeechSynthesizer *spk = parameters->data;
+
+  asyncDiscardHandle(xs.restartAlarm);
+  xs.restartAlarm = NULL;
+
+  if (xsStartHelper(spk)) {
+    /* the new helper needs to be brought up to date */
+    xsSendHello(spk);
+    if (xs.haveRate) xsSendRate(spk);
+  } else {
+    xsStopHelper();
+    xsHelperFailed(spk, "helper program couldn't be restarted");
+  }
+}
+
+static void
+xsScheduleRestart (volatile SpeechSynthesizer *spk)
+{
+  asyncNewRelativeAlarm(&xs.restartAlarm, XS_RESTART_DELAY, xsHandleRestartAlarm, (void *)spk);
+}
+
+static void
+xsStopHelper (void)
+{
+  if (xs.outputMonitor) {
+    asyncCancelRequest(xs.outputMonitor);
+    xs.outputMonitor = NULL;
+  }
+
+  if (trackHandle) {
+    asyncCancelRequest(trackHandle);
+    trackHandle = NULL;
+  }
+
+  if (helper_fd_in >= 0) close(helper_fd_in);
+  if (helper_fd_out >= 0) close(helper_fd_out);
+  helper_fd_in = helper_fd_out = -1;
+
+#ifndef __MINGW32__
+  if (helperProcess != -1) {
+    int status;
+
+    /* it should exit when it sees its input being closed */
+    if (waitpid(helperProcess, &status, WNOHANG) == 0) {
+      kill(helperProcess, SIGTERM);
+
+      if (waitpid(helperProcess, &status, 0) == -1) {
+        logSystemError("waitpid");
+      }
+    }
+
+    helperProcess = -1;
+  }
+#endif /* __MINGW32__ */
+}
+
+static int
+xsStartHelper (volatile SpeechSynthesizer *spk)
+{
 #ifdef __MINGW32__
   STARTUPINFO startupinfo;
   PROCESS_INFORMATION processinfo;
@@ -227,44 +726,8 @@ static int spk_construct (volatile SpeechSynthesizer *spk, char **parameters)
   }
 #else /* __MINGW32__ */
   int fd1[2], fd2[2];
-  uid_t uid, gid;
-  char
-    *s_uid = parameters[PARM_UID],
-    *s_gid = parameters[PARM_GID];
-
-  if(*s_uid) {
-#ifdef HAVE_PWD_H
-    struct passwd *pe = getpwnam(s_uid);
-    if (pe) {
-      uid = pe->pw_uid;
-    } else
-#endif /* HAVE_PWD_H */
-    {
-      char *ptr;
-      uid = strtol(s_uid, &ptr, 0);
-      if(*ptr != 0) {
-        myerror(spk, "Unable to get an uid value with '%s'", s_uid);
-        return 0;
-      }
-    }
-  }else uid = UID;
-
-  if(*s_gid) {
-#ifdef HAVE_GRP_H
-    struct group *ge = getgrnam(s_gid);
-    if (ge) {
-      gid = ge->gr_gid;
-    } else
-#endif /* HAVE_GRP_H */
-    {
-      char *ptr;
-      gid = strtol(s_gid, &ptr, 0);
-      if(*ptr != 0) {
-        myerror(spk, "Unable to get a gid value with '%s'", s_gid);
-        return 0;
-      }
-    }
-  }else gid = GID;
+  uid_t uid = helperUid;
+  gid_t gid = helperGid;
 
   if(pipe(fd1) < 0
      || pipe(fd2) < 0) {
@@ -273,7 +736,7 @@ static int spk_construct (volatile SpeechSynthesizer *spk, char **parameters)
   }
   logMessage(LOG_DEBUG, "pipe fds: fd1 %d %d, fd2 %d %d",
 	     fd1[0],fd1[1], fd2[0],fd2[1]);
-  switch(fork()) {
+  switch((helperProcess = fork())) {
   case -1:
     myperror(spk, "fork");
     return 0;
@@ -323,18 +786,125 @@ static int spk_construct (volatile SpeechSynthesizer *spk, char **parameters)
   logMessage(LOG_INFO,"Opened pipe to external speech program '%s'",
 	     extProgPath);
 
-  asyncReadFile(&trackHandle, helper_fd_in, TRACK_DATA_SIZE*10, xsHandleSpeechTrackingInput, (void *)spk);
+  if (protocolVersion == XS_PROTOCOL_VERSION) {
+    asyncReadFile(&trackHandle, helper_fd_in, XS_INPUT_SIZE, xsHandleFrameInput, (void *)spk);
+  } else {
+    asyncReadFile(&trackHandle, helper_fd_in, TRACK_DATA_SIZE*10, xsHandleSpeechTrackingInput, (void *)spk);
+  }
+  return 1;
+}
+
+static int spk_construct (volatile SpeechSynthesizer *spk, char **parameters)
+{
+  spk->setRate = spk_setRate;
+
+  extProgPath = parameters[PARM_PROGRAM];
+  if(!*extProgPath) extProgPath = HELPER_PROG_PATH;
+
+  protocolVersion = 1;
+  if (*parameters[PARM_PROTOCOL]) {
+    static const int minimum = 1;
+    static const int maximum = XS_PROTOCOL_VERSION;
+    int version;
+
+    if (validateInteger(&version, parameters[PARM_PROTOCOL], &minimum, &maximum)) {
+      protocolVersion = version;
+    } else {
+      logMessage(LOG_WARNING, "%s: %s", "invalid protocol version", parameters[PARM_PROTOCOL]);
+    }
+  }
+
+#ifndef __MINGW32__
+  {
+    uid_t uid;
+    gid_t gid;
+    char
+      *s_uid = parameters[PARM_UID],
+      *s_gid = parameters[PARM_GID];
+
+    if(*s_uid) {
+#ifdef HAVE_PWD_H
+      struct passwd *pe = getpwnam(s_uid);
+      if (pe) {
+        uid = pe->pw_uid;
+      } else
+#endif /* HAVE_PWD_H */
+      {
+        char *ptr;
+        uid = strtol(s_uid, &ptr, 0);
+        if(*ptr != 0) {
+          myerror(spk, "Unable to get an uid value with '%s'", s_uid);
+          return 0;
+        }
+      }
+    }else uid = UID;
+
+    if(*s_gid) {
+#ifdef HAVE_GRP_H
+      struct group *ge = getgrnam(s_gid);
+      if (ge) {
+        gid = ge->gr_gid;
+      } else
+#endif /* HAVE_GRP_H */
+      {
+        char *ptr;
+        gid = strtol(s_gid, &ptr, 0);
+        if(*ptr != 0) {
+          myerror(spk, "Unable to get a gid value with '%s'", s_gid);
+          return 0;
+        }
+      }
+    }else gid = GID;
+
+    helperUid = uid;
+    helperGid = gid;
+  }
+#endif /* __MINGW32__ */
+
+  if (protocolVersion == XS_PROTOCOL_VERSION) {
+    memset(&xs, 0, sizeof(xs));
+    xs.nextIdentifier = 1;
+
+    if (!(xs.output = newQueue(xsDeallocateItem, xsCompareFrames))) return 0;
+
+    if (!(xs.utterances = newQueue(xsDeallocateItem, NULL))) {
+      deallocateQueue(xs.output);
+      xs.output = NULL;
+      return 0;
+    }
+  }
+
+  if (!xsStartHelper(spk)) {
+    spk_destruct(spk);
+    return 0;
+  }
+
+  if (protocolVersion == XS_PROTOCOL_VERSION) xsSendHello(spk);
   return 1;
 }
 
 static void spk_destruct (volatile SpeechSynthesizer *spk)
 {
-  if(trackHandle)
-    asyncCancelRequest(trackHandle);
-  if(helper_fd_in >= 0)
-    close(helper_fd_in);
-  if(helper_fd_out >= 0)
-    close(helper_fd_out);
-  helper_fd_in = helper_fd_out = -1;
-  trackHandle = NULL;
+  if (protocolVersion == XS_PROTOCOL_VERSION) {
+    if (xs.restartAlarm) {
+      asyncCancelRequest(xs.restartAlarm);
+      xs.restartAlarm = NULL;
+    }
+
+    xsStopHelper();
+
+    if (xs.output) {
+      deallocateQueue(xs.output);
+      xs.output = NULL;
+    }
+
+    if (xs.utterances) {
+      deallocateQueue(xs.utterances);
+      xs.utterances = NULL;
+    }
+
+    return;
+  }
+
+  xsStopHelper();
 }
@@ -23,14 +23,16 @@
 
 #include "log.h"
 #include "parse.h"
+#include "thread.h"
 
 typedef enum {
   PARM_PORT,
   PARM_MODULE,
   PARM_LANGUAGE,
-  PARM_VOICE
+  PARM_VOICE,
+  PARM_CANCEL_CONNECTION
 } DriverParameter;
-#define SPKPARMS "port", "module", "language", "voice"
+#define SPKPARMS "port", "module", "language", "voice", "cancelconnection"
 
 #include "spk_driver.h"
 
@@ -45,6 +47,19 @@ static signed int relativeVolume;
 static signed int relativePitch;
 static SPDPunctuation punctuationVerbosity;
 
+/* Setting changes aren't sent right away. They're merged and sent just
+ * before the next text, so that a burst of changes (e.g. rate adjustments
+ * during fast navigation) costs at most one SSIP round trip per setting.
+ */
+typedef enum {
+  SETTING_VOLUME      = 0X01,
+  SETTING_RATE        = 0X02,
+  SETTING_PITCH       = 0X04,
+  SETTING_PUNCTUATION = 0X08
+} PendingSetting;
+
+static unsigned int pendingSettings;
+
 static void
 clearSettings (void) {
   moduleName = NULL;
@@ -54,6 +69,7 @@ clearSettings (void) {
   relativeVolume = 0;
   relativePitch = 0;
   punctuationVerbosity = -1;
+  pendingSettings = 0;
 }
 
 static void
@@ -70,7 +86,7 @@ static void
 speechdAction (SpeechdAction action, const void *data) {
   if (connectionHandle) {
     action(data);
-    if (!connectionHandle->stream) closeConnection();
+    if (connectionHandle && !connectionHandle->stream) closeConnection();
   }
 }
 
@@ -96,8 +112,13 @@ setVolume (const void *data) {
 
 static void
 spk_setVolume (volatile SpeechSynthesizer *spk, unsigned char setting) {
-  relativeVolume = getIntegerSpeechVolume(setting, 100) - 100;
-  speechdAction(setVolume, NULL);
+  signed int volume = getIntegerSpeechVolume(setting, 100) - 100;
+
+  if (volume != relativeVolume) {
+    relativeVolume = volume;
+    pendingSettings |= SETTING_VOLUME;
+  }
+
   logMessage(LOG_DEBUG, "set volume: %u -> %d", setting, relativeVolume);
 }
 
@@ -108,8 +129,13 @@ setRate (const void *data) {
 
 static void
 spk_setRate (volatile SpeechSynthesizer *spk, unsigned char setting) {
-  relativeRate = getIntegerSpeechRate(setting, 100) - 100;
-  speechdAction(setRate, NULL);
+  signed int rate = getIntegerSpeechRate(setting, 100) - 100;
+
+  if (rate != relativeRate) {
+    relativeRate = rate;
+    pendingSettings |= SETTING_RATE;
+  }
+
   logMessage(LOG_DEBUG, "set rate: %u -> %d", setting, relativeRate);
 }
 
@@ -120,8 +146,13 @@ setPitch (const void *data) {
 
 static void
 spk_setPitch (volatile SpeechSynthesizer *spk, unsigned char setting) {
-  relativePitch = getIntegerSpeechPitch(setting, 100) - 100;
-  speechdAction(setPitch, NULL);
+  signed int pitch = getIntegerSpeechPitch(setting, 100) - 100;
+
+  if (pitch != relativePitch) {
+    relativePitch = pitch;
+    pendingSettings |= SETTING_PITCH;
+  }
+
   logMessage(LOG_DEBUG, "set pitch: %u -> %d", setting, relativePitch);
 }
 
@@ -132,18 +163,208 @@ setPunctuation (const void *data) {
 
 static void
 spk_setPunctuation (volatile SpeechSynthesizer *spk, SpeechPunctuation setting) {
-  punctuationVerbosity = (setting <= SPK_PUNCTUATION_NONE)? SPD_PUNCT_NONE: 
-                         (setting >= SPK_PUNCTUATION_ALL)? SPD_PUNCT_ALL: 
-                         SPD_PUNCT_SOME;
-  speechdAction(setPunctuation, NULL);
+  SPDPunctuation verbosity = (setting <= SPK_PUNCTUATION_NONE)? SPD_PUNCT_NONE: 
+                             (setting >= SPK_PUNCTUATION_ALL)? SPD_PUNCT_ALL: 
+                             SPD_PUNCT_SOME;
+
+  if (verbosity != punctuationVerbosity) {
+    punctuationVerbosity = verbosity;
+    pendingSettings |= SETTING_PUNCTUATION;
+  }
+
   logMessage(LOG_DEBUG, "set punctuation: %u -> %d", setting, punctuationVerbosity);
 }
 
+static void
+applySettings (void) {
+  typedef struct {
+    PendingSetting setting;
+    SpeechdAction action;
+  } SettingEntry;
+
+  static const SettingEntry settingTable[] = {
+    { .setting = SETTING_VOLUME, .action = setVolume },
+    { .setting = SETTING_RATE, .action = setRate },
+    { .setting = SETTING_PITCH, .action = setPitch },
+    { .setting = SETTING_PUNCTUATION, .action = setPunctuation },
+    { .action = NULL }
+  };
+
+  const SettingEntry *entry = settingTable;
+
+  while (entry->action && pendingSettings) {
+    if (pendingSettings & entry->setting) {
+      pendingSettings &= ~entry->setting;
+      speechdAction(entry->action, NULL);
+    }
+
+    entry += 1;
+  }
+}
+
 static void
 cancelSpeech (const void *data) {
   spd_cancel(connectionHandle);
 }
 
+#ifdef GOT_PTHREADS
+/* An optional second connection which is only used for cancelling. The
+ * cancel request is handed to a thread which owns it, so muting never waits
+ * for an SSIP round trip. The next text waits (if necessary) for that cancel
+ * to have been done so that it can't itself be cancelled.
+ */
+static struct {
+  SPDConnection *connection;
+  int clientIdentifier;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
+
+  unsigned active:1;
+  unsigned requested:1;
+  unsigned busy:1;
+  unsigned stop:1;
+} cancelChannel;
+
+static int
+getClientIdentifier (SPDConnection *connection) {
+  int identifier = -1;
+  char *reply = NULL;
+
+  if (spd_execute_command_with_reply(connection, "HISTORY GET CLIENT_ID", &reply) == 0) {
+    if (reply) {
+      const char *number = strstr(reply, "245-");
+
+      if (number) identifier = atoi(number + 4);
+    }
+  }
+
+  if (reply) free(reply);
+  return identifier;
+}
+
+THREAD_FUNCTION(runCancelThread) {
+  pthread_mutex_lock(&cancelChannel.mutex);
+
+  while (!cancelChannel.stop) {
+    if (cancelChannel.requested) {
+      int identifier = cancelChannel.clientIdentifier;
+
+      cancelChannel.requested = 0;
+      cancelChannel.busy = 1;
+      pthread_mutex_unlock(&cancelChannel.mutex);
+
+      if (spd_cancel_uid(cancelChannel.connection, identifier) != 0) {
+        logMessage(LOG_WARNING, "speech dispatcher cancel failure: client %d", identifier);
+      }
+
+      pthread_mutex_lock(&cancelChannel.mutex);
+      cancelChannel.busy = 0;
+      pthread_cond_broadcast(&cancelChannel.condition);
+    } else {
+      pthread_cond_wait(&cancelChannel.condition, &cancelChannel.mutex);
+    }
+  }
+
+  pthread_mutex_unlock(&cancelChannel.mutex);
+  return NULL;
+}
+
+static void
+awaitCancel (void) {
+  if (cancelChannel.active) {
+    pthread_mutex_lock(&cancelChannel.mutex);
+
+    while (cancelChannel.requested || cancelChannel.busy) {
+      pthread_cond_wait(&cancelChannel.condition, &cancelChannel.mutex);
+    }
+
+    pthread_mutex_unlock(&cancelChannel.mutex);
+  }
+}
+
+static int
+requestCancel (void) {
+  if (!cancelChannel.active) return 0;
+  if (cancelChannel.clientIdentifier < 0) return 0;
+
+  pthread_mutex_lock(&cancelChannel.mutex);
+  cancelChannel.requested = 1;
+  pthread_cond_broadcast(&cancelChannel.condition);
+  pthread_mutex_unlock(&cancelChannel.mutex);
+  return 1;
+}
+
+static void
+setCancelClient (void) {
+  if (cancelChannel.active) {
+    int identifier = getClientIdentifier(connectionHandle);
+
+    pthread_mutex_lock(&cancelChannel.mutex);
+    cancelChannel.clientIdentifier = identifier;
+    pthread_mutex_unlock(&cancelChannel.mutex);
+
+    if (identifier < 0) {
+      logMessage(LOG_WARNING, "speech dispatcher client identifier not available");
+    }
+  }
+}
+
+static void
+closeCancelChannel (void) {
+  if (cancelChannel.active) {
+    pthread_mutex_lock(&cancelChannel.mutex);
+    cancelChannel.stop = 1;
+    pthread_cond_broadcast(&cancelChannel.condition);
+    pthread_mutex_unlock(&cancelChannel.mutex);
+
+    pthread_join(cancelChannel.thread, NULL);
+    pthread_cond_destroy(&cancelChannel.condition);
+    pthread_mutex_destroy(&cancelChannel.mutex);
+    cancelChannel.active = 0;
+  }
+
+  if (cancelChannel.connection) {
+    spd_close(cancelChannel.connection);
+    cancelChannel.connection = NULL;
+  }
+}
+
+static void
+openCancelChannel (void) {
+  memset(&cancelChannel, 0, sizeof(cancelChannel));
+  cancelChannel.clientIdentifier = -1;
+
+  if ((cancelChannel.connection = spd_open("brltty", "cancel", NULL, SPD_MODE_SINGLE))) {
+    pthread_mutex_init(&cancelChannel.mutex, NULL);
+    pthread_cond_init(&cancelChannel.condition, NULL);
+
+    {
+      int error = createThread("driver-speech-SpeechDispatcher-cancel",
+                               &cancelChannel.thread, NULL,
+                               runCancelThread, NULL);
+
+      if (!error) {
+        cancelChannel.active = 1;
+        setCancelClient();
+        logMessage(LOG_DEBUG, "speech dispatcher cancel connection opened");
+        return;
+      }
+
+      logActionError(error, "speech dispatcher cancel thread creation");
+    }
+
+    pthread_cond_destroy(&cancelChannel.condition);
+    pthread_mutex_destroy(&cancelChannel.mutex);
+  } else {
+    logMessage(LOG_WARNING, "speech dispatcher cancel connection open failure");
+  }
+
+  closeCancelChannel();
+}
+#endif /* GOT_PTHREADS */
+
 static int
 openConnection (void) {
   if (!connectionHandle) {
@@ -166,6 +387,12 @@ openConnection (void) {
       const SpeechdAction *action = actions;
       while (*action) speechdAction(*action++, NULL);
     }
+
+    pendingSettings = 0;
+
+#ifdef GOT_PTHREADS
+    if (connectionHandle) setCancelClient();
+#endif /* GOT_PTHREADS */
   }
 
   return 1;
@@ -227,11 +454,31 @@ spk_construct (volatile SpeechSynthesizer *spk, char **parameters) {
     }
   }
 
-  return openConnection();
+  if (!openConnection()) return 0;
+
+  if (parameters[PARM_CANCEL_CONNECTION] && *parameters[PARM_CANCEL_CONNECTION]) {
+    unsigned int flag = 0;
+
+    if (!validateYesNo(&flag, parameters[PARM_CANCEL_CONNECTION])) {
+      logMessage(LOG_WARNING, "%s: %s", "invalid cancel connection setting", parameters[PARM_CANCEL_CONNECTION]);
+    } else if (flag) {
+#ifdef GOT_PTHREADS
+      openCancelChannel();
+#else /* GOT_PTHREADS */
+      logMessage(LOG_WARNING, "speech dispatcher cancel connection not supported");
+#endif /* GOT_PTHREADS */
+    }
+  }
+
+  return 1;
 }
 
 static void
 spk_destruct (volatile SpeechSynthesizer *spk) {
+#ifdef GOT_PTHREADS
+  closeCancelChannel();
+#endif /* GOT_PTHREADS */
+
   closeConnection();
   clearSettings();
 }
@@ -247,6 +494,13 @@ static void
 sayText (const void *data) {
   const SayData *say = data;
 
+#ifdef GOT_PTHREADS
+  awaitCancel();
+#endif /* GOT_PTHREADS */
+
+  applySettings();
+  if (!connectionHandle) return;
+
   if (say->count == 1) {
     char string[say->length + 1];
     memcpy(string, say->text, say->length);
@@ -276,5 +530,9 @@ spk_say (volatile SpeechSynthesizer *spk, const unsigned char *text, size_t leng
 
 static void
 spk_mute (volatile SpeechSynthesizer *spk) {
+#ifdef GOT_PTHREADS
+  if (requestCancel()) return;
+#endif /* GOT_PTHREADS */
+
   speechdAction(cancelSpeech, NULL);
 }
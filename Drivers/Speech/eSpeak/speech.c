@@ -24,14 +24,18 @@
 
 #include "log.h"
 #include "parse.h"
+#include "thread.h"
+#include "pcm.h"
 
 typedef enum {
 	PARM_PATH,
 	PARM_PUNCTLIST,
 	PARM_VOICE,
-	PARM_MAXRATE
+	PARM_MAXRATE,
+	PARM_PCM,
+	PARM_PCMDEVICE
 } DriverParameter;
-#define SPKPARMS "path", "punctlist", "voice", "maxrate"
+#define SPKPARMS "path", "punctlist", "voice", "maxrate", "pcm", "pcmdevice"
 
 #include "spk_driver.h"
 
@@ -43,22 +47,328 @@ typedef enum {
 #endif /* ESPEAK_API_REVISION < 6 */
 
 static int maxrate = espeakRATE_MAXIMUM;
+static unsigned int usePcm = 0;
+
+#ifdef GOT_PTHREADS
+/*
+ * In PCM mode eSpeak only synthesizes (AUDIO_OUTPUT_RETRIEVAL) and the
+ * samples are played through BRLTTY's own PCM device by a dedicated
+ * thread. A small ring decouples the two, events are held back until
+ * the samples preceding them have actually been played, and muting
+ * only needs to empty the ring and flush the device.
+ */
+
+#define PCM_RING_MILLISECONDS 500
+#define PCM_BLOCK_SAMPLES 0X200
+
+typedef struct {
+	unsigned long int position;
+	espeak_EVENT_TYPE type;
+	int textPosition;
+} PcmEvent;
+
+static struct {
+	PcmDevice *device;
+	int rate;
+	volatile SpeechSynthesizer *spk;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	unsigned running:1;
+	unsigned canceling:1;
+	unsigned flush:1;
+	unsigned newMessage:1;
+
+	short *samples;
+	unsigned int size;
+	unsigned int head;
+	unsigned int count;
+
+	unsigned long int enqueued;
+	unsigned long int played;
+	unsigned long int messageBase;
+	unsigned int generation;
+	unsigned int pending;
+
+	PcmEvent events[0X100];
+	unsigned int eventHead;
+	unsigned int eventCount;
+} pcmOutput;
+
+static void
+tellPcmEvent(const PcmEvent *event)
+{
+	if (event->type == espeakEVENT_WORD) {
+		tellSpeechLocation(pcmOutput.spk, event->textPosition - 1);
+	} else if (event->type == espeakEVENT_MSG_TERMINATED) {
+		if (pcmOutput.pending) pcmOutput.pending -= 1;
+		tellSpeechFinished(pcmOutput.spk);
+	}
+}
+
+static void
+deliverPcmEvents(void)
+{
+	while (pcmOutput.eventCount) {
+		const PcmEvent *event = &pcmOutput.events[pcmOutput.eventHead];
+
+		if (event->position > pcmOutput.played) break;
+		tellPcmEvent(event);
+
+		pcmOutput.eventHead = (pcmOutput.eventHead + 1) % ARRAY_COUNT(pcmOutput.events);
+		pcmOutput.eventCount -= 1;
+	}
+}
+
+static void
+addPcmEvent(const espeak_EVENT *event, unsigned long int position)
+{
+	PcmEvent pcmEvent = {
+		.position = position,
+		.type = event->type,
+		.textPosition = event->text_position
+	};
+
+	if (pcmOutput.eventCount == ARRAY_COUNT(pcmOutput.events)) {
+		/* never lose a termination - the speech would never finish */
+		if (pcmEvent.type == espeakEVENT_MSG_TERMINATED) tellPcmEvent(&pcmEvent);
+		return;
+	}
+
+	pcmOutput.events[(pcmOutput.eventHead + pcmOutput.eventCount++) % ARRAY_COUNT(pcmOutput.events)] = pcmEvent;
+}
+
+THREAD_FUNCTION(runPcmOutput)
+{
+	short block[PCM_BLOCK_SAMPLES];
+
+	pthread_mutex_lock(&pcmOutput.mutex);
+
+	while (pcmOutput.running) {
+		if (pcmOutput.flush) {
+			pcmOutput.flush = 0;
+			pthread_mutex_unlock(&pcmOutput.mutex);
+			cancelPcmOutput(pcmOutput.device);
+			pthread_mutex_lock(&pcmOutput.mutex);
+		} else if (!pcmOutput.count) {
+			pthread_cond_wait(&pcmOutput.condition, &pcmOutput.mutex);
+		} else {
+			unsigned int generation = pcmOutput.generation;
+			unsigned int count = MIN(pcmOutput.count, ARRAY_COUNT(block));
+
+			count = MIN(count, pcmOutput.size - pcmOutput.head);
+			memcpy(block, &pcmOutput.samples[pcmOutput.head], ARRAY_SIZE(block, count));
+			pcmOutput.head = (pcmOutput.head + count) % pcmOutput.size;
+			pcmOutput.count -= count;
+			pthread_cond_broadcast(&pcmOutput.condition);
+
+			pthread_mutex_unlock(&pcmOutput.mutex);
+			writePcmData(pcmOutput.device, (const unsigned char *)block, ARRAY_SIZE(block, count));
+			pthread_mutex_lock(&pcmOutput.mutex);
+
+			if (generation == pcmOutput.generation) {
+				pcmOutput.played += count;
+				deliverPcmEvents();
+				pthread_cond_broadcast(&pcmOutput.condition);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&pcmOutput.mutex);
+	return NULL;
+}
+
+static int PcmSynthCallback(short *audio, int numsamples, espeak_EVENT *events)
+{
+	int cancel;
+
+	pthread_mutex_lock(&pcmOutput.mutex);
+
+	if (!pcmOutput.canceling) {
+		unsigned long int end = pcmOutput.enqueued + numsamples;
+
+		if (pcmOutput.newMessage) {
+			pcmOutput.messageBase = pcmOutput.enqueued;
+			pcmOutput.newMessage = 0;
+		}
+
+		while (events->type != espeakEVENT_LIST_TERMINATED) {
+			if (events->type == espeakEVENT_WORD) {
+				unsigned long int position = pcmOutput.messageBase +
+					((unsigned long int)events->audio_position * pcmOutput.rate / 1000);
+
+				addPcmEvent(events, MIN(position, end));
+			} else if (events->type == espeakEVENT_MSG_TERMINATED) {
+				addPcmEvent(events, end);
+				pcmOutput.newMessage = 1;
+			}
+
+			events++;
+		}
+
+		while (audio && (numsamples > 0)) {
+			unsigned int tail;
+			unsigned int count;
+
+			while ((pcmOutput.count == pcmOutput.size) && !pcmOutput.canceling) {
+				pthread_cond_wait(&pcmOutput.condition, &pcmOutput.mutex);
+			}
+			if (pcmOutput.canceling) break;
+
+			tail = (pcmOutput.head + pcmOutput.count) % pcmOutput.size;
+			count = MIN(numsamples, pcmOutput.size - pcmOutput.count);
+			count = MIN(count, pcmOutput.size - tail);
+
+			memcpy(&pcmOutput.samples[tail], audio, ARRAY_SIZE(audio, count));
+			pcmOutput.count += count;
+			pcmOutput.enqueued += count;
+			audio += count;
+			numsamples -= count;
+			pthread_cond_broadcast(&pcmOutput.condition);
+		}
+
+		/* a termination without samples may already be due */
+		if (!pcmOutput.count) deliverPcmEvents();
+	}
+
+	cancel = pcmOutput.canceling;
+	pthread_mutex_unlock(&pcmOutput.mutex);
+	return cancel;
+}
+
+static void
+stopPcmOutput(void)
+{
+	if (pcmOutput.running) {
+		pthread_mutex_lock(&pcmOutput.mutex);
+		pcmOutput.running = 0;
+		pcmOutput.canceling = 1;
+		pthread_cond_broadcast(&pcmOutput.condition);
+		pthread_mutex_unlock(&pcmOutput.mutex);
+
+		pthread_join(pcmOutput.thread, NULL);
+		pthread_cond_destroy(&pcmOutput.condition);
+		pthread_mutex_destroy(&pcmOutput.mutex);
+	}
+
+	if (pcmOutput.samples) {
+		free(pcmOutput.samples);
+		pcmOutput.samples = NULL;
+	}
+
+	if (pcmOutput.device) {
+		closePcmDevice(pcmOutput.device);
+		pcmOutput.device = NULL;
+	}
+}
+
+static int
+startPcmOutput(volatile SpeechSynthesizer *spk, int rate, const char *device)
+{
+	memset(&pcmOutput, 0, sizeof(pcmOutput));
+	pcmOutput.spk = spk;
+	pcmOutput.newMessage = 1;
+
+	if (!(pcmOutput.device = openPcmDevice(LOG_WARNING, device))) return 0;
+
+	if ((setPcmChannelCount(pcmOutput.device, 1) != 1) ||
+	    (setPcmAmplitudeFormat(pcmOutput.device, PCM_FMT_S16N) != PCM_FMT_S16N)) {
+		logMessage(LOG_WARNING, "eSpeak: PCM device doesn't support 16-bit mono output");
+		goto failed;
+	}
+
+	pcmOutput.rate = setPcmSampleRate(pcmOutput.device, rate);
+	if (pcmOutput.rate != rate) {
+		logMessage(LOG_WARNING, "eSpeak: PCM device doesn't support %d Hz", rate);
+		goto failed;
+	}
+
+	pcmOutput.size = rate * PCM_RING_MILLISECONDS / 1000;
+	if (!(pcmOutput.samples = malloc(ARRAY_SIZE(pcmOutput.samples, pcmOutput.size)))) {
+		logMallocError();
+		goto failed;
+	}
+
+	pthread_mutex_init(&pcmOutput.mutex, NULL);
+	pthread_cond_init(&pcmOutput.condition, NULL);
+	pcmOutput.running = 1;
+
+	{
+		int error = createThread("driver-speech-eSpeak-pcm",
+					 &pcmOutput.thread, NULL,
+					 runPcmOutput, NULL);
+
+		if (!error) return 1;
+		logActionError(error, "eSpeak PCM thread creation");
+	}
+
+	pcmOutput.running = 0;
+	pthread_cond_destroy(&pcmOutput.condition);
+	pthread_mutex_destroy(&pcmOutput.mutex);
+
+failed:
+	stopPcmOutput();
+	return 0;
+}
+#endif /* GOT_PTHREADS */
 
 static void
 spk_say(volatile SpeechSynthesizer *spk, const unsigned char *buffer, size_t length, size_t count, const unsigned char *attributes)
 {
 	int result;
 
+#ifdef GOT_PTHREADS
+	if (usePcm) {
+		pthread_mutex_lock(&pcmOutput.mutex);
+		pcmOutput.pending += 1;
+		pthread_mutex_unlock(&pcmOutput.mutex);
+	}
+#endif /* GOT_PTHREADS */
+
 	/* add 1 to the length in order to pass along the trailing zero */
 	result = espeak_Synth(buffer, length+1, 0, POS_CHARACTER, 0,
 			espeakCHARS_UTF8, NULL, (void *)spk);
-	if (result != EE_OK)
+	if (result != EE_OK) {
 		logMessage(LOG_ERR, "eSpeak: Synth() returned error %d", result);
+
+#ifdef GOT_PTHREADS
+		if (usePcm) {
+			pthread_mutex_lock(&pcmOutput.mutex);
+			if (pcmOutput.pending) pcmOutput.pending -= 1;
+			pthread_cond_broadcast(&pcmOutput.condition);
+			pthread_mutex_unlock(&pcmOutput.mutex);
+		}
+#endif /* GOT_PTHREADS */
+	}
 }
 
 static void
 spk_mute(volatile SpeechSynthesizer *spk)
 {
+#ifdef GOT_PTHREADS
+	if (usePcm) {
+		pthread_mutex_lock(&pcmOutput.mutex);
+		pcmOutput.canceling = 1;
+		pcmOutput.flush = 1;
+		pcmOutput.count = 0;
+		pcmOutput.eventCount = 0;
+		pcmOutput.pending = 0;
+		pcmOutput.generation += 1;
+		pcmOutput.played = pcmOutput.enqueued;
+		pcmOutput.newMessage = 1;
+		pthread_cond_broadcast(&pcmOutput.condition);
+		pthread_mutex_unlock(&pcmOutput.mutex);
+
+		espeak_Cancel();
+
+		pthread_mutex_lock(&pcmOutput.mutex);
+		pcmOutput.canceling = 0;
+		pthread_mutex_unlock(&pcmOutput.mutex);
+		return;
+	}
+#endif /* GOT_PTHREADS */
+
 	espeak_Cancel();
 }
 
@@ -79,6 +389,19 @@ static int SynthCallback(short *audio, int numsamples, espeak_EVENT *events)
 static void
 spk_drain(volatile SpeechSynthesizer *spk)
 {
+#ifdef GOT_PTHREADS
+	if (usePcm) {
+		pthread_mutex_lock(&pcmOutput.mutex);
+		while (pcmOutput.pending || pcmOutput.count) {
+			pthread_cond_wait(&pcmOutput.condition, &pcmOutput.mutex);
+		}
+		pthread_mutex_unlock(&pcmOutput.mutex);
+
+		awaitPcmOutput(pcmOutput.device);
+		return;
+	}
+#endif /* GOT_PTHREADS */
+
 	espeak_Synchronize();
 }
 
@@ -119,7 +442,7 @@ spk_setPunctuation(volatile SpeechSynthesizer *spk, SpeechPunctuation setting)
 
 static int spk_construct(volatile SpeechSynthesizer *spk, char **parameters)
 {
-	char *data_path, *voicename, *punctlist;
+	char *data_path, *voicename, *punctlist, *pcmDevice;
 	int result;
 
 	spk->setVolume = spk_setVolume;
@@ -133,10 +456,48 @@ static int spk_construct(volatile SpeechSynthesizer *spk, char **parameters)
 	data_path = parameters[PARM_PATH];
 	if (data_path && !*data_path)
 		data_path = NULL;
-	result = espeak_Initialize(AUDIO_OUTPUT_PLAYBACK, 0, data_path, 0);
-	if (result < 0) {
-		logMessage(LOG_ERR, "eSpeak: initialization failed");
-		return 0;
+
+	pcmDevice = parameters[PARM_PCMDEVICE];
+	if (!pcmDevice)
+		pcmDevice = "";
+
+	usePcm = 0;
+	if (parameters[PARM_PCM] && *parameters[PARM_PCM]) {
+		if (!validateYesNo(&usePcm, parameters[PARM_PCM])) {
+			logMessage(LOG_WARNING, "%s: %s", "invalid PCM setting", parameters[PARM_PCM]);
+		}
+	}
+
+#ifdef GOT_PTHREADS
+	if (usePcm) {
+		result = espeak_Initialize(AUDIO_OUTPUT_RETRIEVAL, 0, data_path, 0);
+
+		if (result < 0) {
+			logMessage(LOG_ERR, "eSpeak: initialization failed");
+			return 0;
+		}
+
+		if (startPcmOutput(spk, result, pcmDevice)) {
+			logMessage(LOG_DEBUG, "eSpeak: playing through PCM device at %d Hz", result);
+		} else {
+			logMessage(LOG_WARNING, "eSpeak: PCM output not available - using eSpeak playback");
+			espeak_Terminate();
+			usePcm = 0;
+		}
+	}
+#else /* GOT_PTHREADS */
+	if (usePcm) {
+		logMessage(LOG_WARNING, "eSpeak: PCM output not supported - using eSpeak playback");
+		usePcm = 0;
+	}
+#endif /* GOT_PTHREADS */
+
+	if (!usePcm) {
+		result = espeak_Initialize(AUDIO_OUTPUT_PLAYBACK, 0, data_path, 0);
+		if (result < 0) {
+			logMessage(LOG_ERR, "eSpeak: initialization failed");
+			return 0;
+		}
 	}
 
 	voicename = parameters[PARM_VOICE];
@@ -167,6 +528,11 @@ static int spk_construct(volatile SpeechSynthesizer *spk, char **parameters)
 		if (val > espeakRATE_MINIMUM) maxrate = val;
 	}
 
+#ifdef GOT_PTHREADS
+	if (usePcm) {
+		espeak_SetSynthCallback(PcmSynthCallback);
+	} else
+#endif /* GOT_PTHREADS */
 	espeak_SetSynthCallback(SynthCallback);
 
 	return 1;
@@ -174,6 +540,13 @@ static int spk_construct(volatile SpeechSynthesizer *spk, char **parameters)
 
 static void spk_destruct(volatile SpeechSynthesizer *spk)
 {
-	espeak_Cancel();
+	spk_mute(spk);
 	espeak_Terminate();
+
+#ifdef GOT_PTHREADS
+	if (usePcm) {
+		stopPcmOutput();
+		usePcm = 0;
+	}
+#endif /* GOT_PTHREADS */
 }
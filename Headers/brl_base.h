@@ -69,6 +69,17 @@ extern void makeInputTable (void);
 extern void *translateInputCells (unsigned char *target, const unsigned char *source, size_t count);
 extern unsigned char translateInputCell (unsigned char cell);
 
+typedef struct {
+  TranslationTable internalOutputTable;
+  const unsigned char *outputTable;
+
+  TranslationTable internalInputTable;
+  const unsigned char *inputTable;
+} CellTranslationTables;
+
+extern void setThreadCellTranslationTables (CellTranslationTables *tables);
+extern void adoptCellTranslationTables (const CellTranslationTables *tables);
+
 #define MAKE_OUTPUT_TABLE(dot1, dot2, dot3, dot4, dot5, dot6, dot7, dot8) { \
   static const DotsTable dots = { \
     (dot1), (dot2), (dot3), (dot4), (dot5), (dot6), (dot7), (dot8) \
@@ -99,7 +110,14 @@ extern void disconnectBrailleResource (
 typedef enum {
   BRL_PVR_INVALID,
   BRL_PVR_INCLUDE,
-  BRL_PVR_EXCLUDE
+  BRL_PVR_EXCLUDE,
+
+  /* Like BRL_PVR_INCLUDE, but the bytes which follow, up to (but not
+   * including) the last one of the packet, are then taken as they are,
+   * i.e. without calling the verifier for each of them. It may still be
+   * called for some of them when the packet arrives in pieces.
+   */
+  BRL_PVR_SPAN
 } BraillePacketVerifierResult;
 
 typedef BraillePacketVerifierResult BraillePacketVerifier (
@@ -120,6 +138,17 @@ extern int writeBraillePacket (
   const void *packet, size_t size
 );
 
+extern int writeBrailleFrame (
+  BrailleDisplay *brl, GioEndpoint *endpoint,
+  int type,
+  const void *packet, size_t size
+);
+
+/* The frame type for a write of a range of cells - it's only replaced by a
+ * newer write of the same range.
+ */
+#define BRAILLE_CELLS_FRAME(start, count) (0X10000 | ((start) << 8) | (count))
+
 extern int writeBrailleMessage (
   BrailleDisplay *brl, GioEndpoint *endpoint,
   int type,
@@ -86,6 +86,7 @@ struct BrailleDisplayStruct {
 
   GioEndpoint *gioEndpoint;
   unsigned int writeDelay;
+  unsigned long int packetsRead;
 
   unsigned char *buffer;
   unsigned isCoreBuffer:1;
@@ -28,6 +28,9 @@ extern DataArea *newDataArea (void);
 extern void destroyDataArea (DataArea *area);
 extern void resetDataArea (DataArea *area);
 
+extern int reserveDataArea (DataArea *area, size_t size);
+extern void trimDataArea (DataArea *area);
+
 typedef unsigned long int DataOffset;
 extern int allocateDataItem (DataArea *area, DataOffset *offset, size_t size, size_t alignment);
 extern void *getDataItem (DataArea *area, DataOffset offset);
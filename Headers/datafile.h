@@ -29,6 +29,11 @@ extern "C" {
 
 extern int setBaseDataVariables (const VariableInitializer *initializers);
 extern int setTableDataVariables (const char *tableExtension, const char *subtableExtension);
+extern void releaseDataVariables (void);
+
+#define DATA_FILE_OPENED_HANDLER(name) void name (const char *path, void *data)
+typedef DATA_FILE_OPENED_HANDLER(DataFileOpenedHandler);
+extern void setDataFileOpenedHandler (DataFileOpenedHandler *handler, void *data);
 
 extern FILE *openDataFile (const char *path, const char *mode, int optional);
 
@@ -21,6 +21,7 @@
 
 #include "gio_types.h"
 #include "async_io.h"
+#include "timing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,9 +41,24 @@ extern const void *gioGetApplicationData (GioEndpoint *endpoint);
 extern char *gioGetResourceName (GioEndpoint *endpoint);
 
 extern ssize_t gioWriteData (GioEndpoint *endpoint, const void *data, size_t size);
+
+#define GIO_FRAME_ORDERED 0
+extern ssize_t gioWriteFrame (GioEndpoint *endpoint, int type, const void *data, size_t size);
+
+typedef struct {
+  unsigned int queueDepth;
+  unsigned int maximumQueueDepth;
+  unsigned long int enqueuedFrames;
+  unsigned long int supersededFrames;
+} GioOutputStatistics;
+
+extern void gioGetOutputStatistics (GioEndpoint *endpoint, GioOutputStatistics *statistics);
+
 extern int gioAwaitInput (GioEndpoint *endpoint, int timeout);
 extern ssize_t gioReadData (GioEndpoint *endpoint, void *buffer, size_t size, int wait);
 extern int gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait);
+extern ssize_t gioPeekInput (GioEndpoint *endpoint, const unsigned char **bytes, int wait);
+extern void gioConsumeInput (GioEndpoint *endpoint, size_t count);
 extern int gioDiscardInput (GioEndpoint *endpoint);
 
 extern int gioReconfigureResource (
@@ -122,12 +138,28 @@ typedef enum {
   GIO_RESOURCE_NULL,
   GIO_RESOURCE_SERIAL,
   GIO_RESOURCE_USB,
-  GIO_RESOURCE_BLUETOOTH
+  GIO_RESOURCE_BLUETOOTH,
+  GIO_RESOURCE_REPLAY
 } GioResourceType;
 
 extern GioResourceType gioGetResourceType (GioEndpoint *endpoint);
 extern void *gioGetResourceObject (GioEndpoint *endpoint);
 
+typedef struct {
+  unsigned long int inputBytes;
+  unsigned long int inputChunks;
+  TimeValue inputTime; /* when the last byte the driver has taken arrived */
+
+  unsigned long int outputBytes;
+  unsigned long int outputWrites;
+
+  unsigned inputFinished:1;
+  unsigned awaitingOutput:1;
+} GioReplayStatistics;
+
+extern void gioEnableReplay (void);
+extern int gioGetReplayStatistics (GioEndpoint *endpoint, GioReplayStatistics *statistics);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -20,6 +20,7 @@
 #define BRLTTY_INCLUDED_NOTES
 
 #include "note_types.h"
+#include "tune.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,7 @@ extern float getRealNoteFrequency (unsigned char note);
 #endif /* NO_FLOAT */
 
 typedef struct NoteDeviceStruct NoteDevice;
+typedef struct NoteRenderingStruct NoteRendering;
 
 typedef struct {
   NoteDevice * (*construct) (int errorLevel);
@@ -51,6 +53,12 @@ typedef struct {
   int (*note) (NoteDevice *device, unsigned int duration, unsigned char note);
 
   int (*flush) (NoteDevice *device);
+
+  /* optional - for devices which can play a whole tune prepared in advance */
+  NoteRendering * (*render) (NoteDevice *device, const ToneElement *tune);
+  int (*isRenderingUsable) (NoteDevice *device, const NoteRendering *rendering);
+  int (*play) (NoteDevice *device, const NoteRendering *rendering);
+  void (*release) (NoteRendering *rendering);
 } NoteMethods;
 
 extern const NoteMethods beepNoteMethods;
@@ -36,6 +36,7 @@ typedef struct {
   void (*describe) (ScreenDescription *);
   int (*readCharacters) (const ScreenBox *box, ScreenCharacter *buffer);
   int (*insertKey) (ScreenKey key);
+  int (*insertCharacters) (const wchar_t *characters, size_t count);
   int (*routeCursor) (int column, int row, int screen);
   int (*highlightRegion) (int left, int right, int top, int bottom);
   int (*unhighlightRegion) (void);
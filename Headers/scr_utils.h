@@ -26,6 +26,21 @@ extern "C" {
 #endif /* __cplusplus */
 
 extern void clearScreenCharacters (ScreenCharacter *characters, size_t count);
+
+typedef uint32_t ScreenRowHash;
+extern ScreenRowHash hashScreenCharacters (const ScreenCharacter *characters, size_t count);
+
+typedef struct {
+  unsigned int column;
+  unsigned int oldCount;
+  unsigned int newCount;
+} ScreenTextChange;
+
+extern void findScreenTextChange (
+  ScreenTextChange *change,
+  const ScreenCharacter *oldCharacters, unsigned int oldCount,
+  const ScreenCharacter *newCharacters, unsigned int newCount
+);
 extern void setScreenCharacterText (ScreenCharacter *characters, wchar_t text, size_t count);
 extern void setScreenCharacterAttributes (ScreenCharacter *characters, unsigned char attributes, size_t count);
 
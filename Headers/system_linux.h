@@ -27,6 +27,8 @@ extern int installKernelModule (const char *name, unsigned char *status);
 
 extern int openCharacterDevice (const char *name, int flags, int major, int minor);
 
+extern int newKobjectUeventSocket (void);
+
 typedef struct UinputObjectStruct UinputObject;
 extern UinputObject *newUinputObject (const char *name);
 extern void destroyUinputObject (UinputObject *uinput);
@@ -36,6 +38,9 @@ extern int createUinputDevice (UinputObject *uinput);
 
 extern int enableUinputEventType (UinputObject *uinput, int type);
 extern int writeInputEvent (UinputObject *uinput, uint16_t type, uint16_t code, int32_t value);
+extern void beginInputEvents (UinputObject *uinput);
+extern int endInputEvents (UinputObject *uinput);
+extern int flushInputEvents (UinputObject *uinput);
 
 extern int enableUinputKey (UinputObject *uinput, int key);
 extern int writeKeyEvent (UinputObject *uinput, int key, int press);
@@ -37,6 +37,7 @@ extern char *selectTextTable (const char *directory);
 extern int replaceTextTable (const char *directory, const char *name);
 
 extern unsigned char convertCharacterToDots (TextTable *table, wchar_t character);
+extern void convertCharactersToDots (TextTable *table, const wchar_t *characters, unsigned char *dots, size_t count);
 extern wchar_t convertDotsToCharacter (TextTable *table, unsigned char dots);
 
 extern void setTryBaseCharacter (TextTable *table, unsigned char yes);
@@ -50,6 +50,14 @@ extern void suppressTuneDeviceOpenErrors (void);
 extern int tuneSetDevice (TuneDevice device);
 extern void tunePlayNotes (const NoteElement *tune);
 extern void tunePlayTones (const ToneElement *tune);
+
+/* For tunes which stay allocated and unchanged until forgotten. Devices
+ * which support it render them the first time they're played and then play
+ * them from that copy.
+ */
+extern void tuneRenderTones (const ToneElement *tune);
+extern void tuneForgetTones (const ToneElement *tune);
+
 extern void tuneWait (int time);
 extern void tuneSynchronize (void);
 
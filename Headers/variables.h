@@ -52,6 +52,7 @@ extern int setStringVariables (VariableNestingLevel *vnl, const VariableInitiali
 
 extern VariableNestingLevel *getGlobalVariables (int create);
 extern int setGlobalVariable (const char *name, const char *value);
+extern VariableNestingLevel *copyGlobalVariables (void);
 
 #ifdef __cplusplus
 }
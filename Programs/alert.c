@@ -180,6 +180,16 @@ static ToneElement emptyTune[] = {TONE_STOP()};
 
 static void
 exitAlertTunes (void *data) {
+  {
+    ToneElement **tune = tuneTable;
+    ToneElement **end = tune + ARRAY_COUNT(tuneTable);
+
+    while (tune < end) {
+      if (*tune && (*tune != emptyTune)) tuneForgetTones(*tune);
+      tune += 1;
+    }
+  }
+
   tuneSynchronize();
 
   {
@@ -215,34 +225,44 @@ getTuneBuilder (void) {
   return tuneBuilder;
 }
 
-void
-alert (AlertIdentifier identifier) {
-  if (identifier < ARRAY_COUNT(alertTable)) {
-    const AlertEntry *alert = &alertTable[identifier];
+static const ToneElement *
+getAlertTune (AlertIdentifier identifier) {
+  const AlertEntry *alert = &alertTable[identifier];
+  ToneElement **tune = &tuneTable[identifier];
 
-    if (prefs.alertTunes && alert->tune && *alert->tune) {
-      ToneElement **tune = &tuneTable[identifier];
+  if (!*tune) {
+    TuneBuilder *tb = getTuneBuilder();
 
-      if (!*tune) {
-        TuneBuilder *tb = getTuneBuilder();
+    if (tb) {
+      setTuneSourceName(tuneBuilder, "alert");
+      setTuneSourceIndex(tb, identifier);
 
-        if (tb) {
-          setTuneSourceName(tuneBuilder, "alert");
-          setTuneSourceIndex(tb, identifier);
+      if (parseTuneString(tb, "p100")) {
+        if (parseTuneString(tb, alert->tune)) {
+          *tune = getTune(tb);
+        }
+      }
 
-          if (parseTuneString(tb, "p100")) {
-            if (parseTuneString(tb, alert->tune)) {
-              *tune = getTune(tb);
-            }
-          }
+      resetTuneBuilder(tb);
+    }
 
-          resetTuneBuilder(tb);
-        }
+    if (*tune) {
+      tuneRenderTones(*tune);
+    } else {
+      *tune = emptyTune;
+    }
+  }
 
-        if (!*tune) *tune = emptyTune;
-      }
+  return *tune;
+}
 
-      tunePlayTones(*tune);
+void
+alert (AlertIdentifier identifier) {
+  if (identifier < ARRAY_COUNT(alertTable)) {
+    const AlertEntry *alert = &alertTable[identifier];
+
+    if (prefs.alertTunes && alert->tune && *alert->tune) {
+      tunePlayTones(getAlertTune(identifier));
     } else if (prefs.alertDots && alert->tactile.duration) {
       showDotPattern(alert->tactile.pattern, alert->tactile.duration);
     } else if (prefs.alertMessages && alert->message) {
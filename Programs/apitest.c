@@ -35,6 +35,8 @@
 #include "cmd.h"
 #include "cmd_brlapi.h"
 #include "async_wait.h"
+#include "timing.h"
+#include "brlapi_keyranges.h"
 
 #define BRLAPI_NO_DEPRECATED
 #include "brlapi.h"
@@ -51,6 +53,8 @@ static int opt_showSize;
 static int opt_showKeyCodes;
 static int opt_suspendMode;
 static int opt_threadMode;
+static int opt_benchmarkKeyranges;
+static int opt_batchMode;
 
 BEGIN_OPTION_TABLE(programOptions)
   { .letter = 'n',
@@ -102,6 +106,18 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = "Exercise threaded use"
   },
 
+  { .letter = 'B',
+    .word = "batch",
+    .setting.flag = &opt_batchMode,
+    .description = "Exercise batched requests."
+  },
+
+  { .letter = 'r',
+    .word = "ranges",
+    .setting.flag = &opt_benchmarkKeyranges,
+    .description = "Benchmark key range filtering (doesn't connect to BrlAPI)."
+  },
+
   { .letter = 'b',
     .word = "brlapi",
     .argument = "[host][:port]",
@@ -338,6 +354,108 @@ static void exerciseThreads(void)
   pthread_join(thread, NULL);
 }
 
+static void exerciseBatch(void)
+{
+  const unsigned int iterations = 1000;
+  brlapi_batch_t *batch;
+  char name[30];
+  char identifier[30];
+  unsigned int x, y;
+  TimeValue start, end;
+
+  if (!(batch = brlapi_newBatch())) {
+    brlapi_perror("newBatch");
+    exit(PROG_EXIT_FATAL);
+  }
+
+  fprintf(stderr, "Getting driver name, model identifier, and display size in one batch: ");
+  if ((brlapi_batchGetDriverName(batch, name, sizeof(name)) < 0) ||
+      (brlapi_batchGetModelIdentifier(batch, identifier, sizeof(identifier)) < 0) ||
+      (brlapi_batchGetDisplaySize(batch, &x, &y) < 0) ||
+      (brlapi_executeBatch(batch) < 0)) {
+    brlapi_perror("failed");
+    exit(PROG_EXIT_FATAL);
+  }
+  fprintf(stderr, "%s %s %dX%d\n", name, identifier, x, y);
+
+  getMonotonicTime(&start);
+  for (unsigned int i=0; i<iterations; i+=1) {
+    if ((brlapi_getDriverName(name, sizeof(name)) < 0) ||
+        (brlapi_getModelIdentifier(identifier, sizeof(identifier)) < 0)) {
+      brlapi_perror("failed");
+      exit(PROG_EXIT_FATAL);
+    }
+  }
+  getMonotonicTime(&end);
+  fprintf(stderr, "%u separate request pairs: %ldms\n", iterations, millisecondsBetween(&start, &end));
+
+  getMonotonicTime(&start);
+  for (unsigned int i=0; i<iterations; i+=1) {
+    if ((brlapi_batchGetDriverName(batch, name, sizeof(name)) < 0) ||
+        (brlapi_batchGetModelIdentifier(batch, identifier, sizeof(identifier)) < 0) ||
+        (brlapi_executeBatch(batch) < 0)) {
+      brlapi_perror("failed");
+      exit(PROG_EXIT_FATAL);
+    }
+  }
+  getMonotonicTime(&end);
+  fprintf(stderr, "%u batched request pairs: %ldms\n", iterations, millisecondsBetween(&start, &end));
+
+  brlapi_freeBatch(batch);
+}
+
+static void benchmarkKeyranges(void)
+{
+  static const unsigned int ignoredCounts[] = {1, 10, 100, 1000, 10000};
+  const unsigned int lookupCount = 10000000;
+
+  for (unsigned int i=0; i<ARRAY_COUNT(ignoredCounts); i+=1) {
+    unsigned int ignoredCount = ignoredCounts[i];
+    KeyrangeList *list = NULL;
+    TimeValue start, end;
+    long int elapsed;
+    unsigned int found = 0;
+
+    /* like a client accepting everything and then ignoring a few keys */
+    if (addKeyrange(0, BRLAPI_KEY_MAX, &list) == -1) goto error;
+
+    getMonotonicTime(&start);
+    {
+      KeyrangeElem ranges[ignoredCount][2];
+
+      for (unsigned int j=0; j<ignoredCount; j+=1) {
+        KeyrangeElem key = BRLAPI_KEY_TYPE_SYM | (j * 7);
+        ranges[j][0] = ranges[j][1] = key;
+      }
+
+      if (removeKeyranges(ranges, ignoredCount, &list) == -1) goto error;
+    }
+    getMonotonicTime(&end);
+    elapsed = millisecondsBetween(&start, &end);
+
+    printf("%u ignored keys: %u ranges, removed in %ldms", ignoredCount, getKeyrangeCount(list), elapsed);
+
+    getMonotonicTime(&start);
+    for (unsigned int j=0; j<lookupCount; j+=1) {
+      KeyrangeElem key = BRLAPI_KEY_TYPE_SYM | (j % (ignoredCount * 8));
+      if (inKeyrangeList(list, key)) found += 1;
+    }
+    getMonotonicTime(&end);
+    elapsed = millisecondsBetween(&start, &end);
+
+    printf(", %u lookups (%u accepted) in %ldms (%.1fns each)\n",
+           lookupCount, found, elapsed, (elapsed * 1e6) / lookupCount);
+
+    freeKeyrangeList(&list);
+    continue;
+
+  error:
+    freeKeyrangeList(&list);
+    fprintf(stderr, "not enough memory for key ranges\n");
+    exit(PROG_EXIT_FATAL);
+  }
+}
+
 int
 main (int argc, char *argv[]) {
   ProgramExitStatus exitStatus = PROG_EXIT_SUCCESS;
@@ -351,6 +469,11 @@ main (int argc, char *argv[]) {
     PROCESS_OPTIONS(descriptor, argc, argv);
   }
 
+  if (opt_benchmarkKeyranges) {
+    benchmarkKeyranges();
+    return exitStatus;
+  }
+
   settings.host = opt_host;
   settings.auth = opt_auth;
   fprintf(stderr, "Connecting to BrlAPI... ");
@@ -390,6 +513,10 @@ main (int argc, char *argv[]) {
       exerciseThreads();
     }
 
+    if (opt_batchMode) {
+      exerciseBatch();
+    }
+
     brlapi_closeConnection();
     fprintf(stderr, "Disconnected\n");
   } else {
@@ -179,6 +179,7 @@ compileAttributesTable (const char *name) {
         if (processDataFile(name, &parameters)) {
           if (makeAttributesToDots(&atd)) {
             if ((table = malloc(sizeof(*table)))) {
+              trimDataArea(atd.area);
               table->header.fields = getAttributesTableHeader(&atd);
               table->size = getDataSize(atd.area);
               resetDataArea(atd.area);
@@ -52,6 +52,7 @@ constructBrailleDisplay (BrailleDisplay *brl) {
 
   brl->gioEndpoint = NULL;
   brl->writeDelay = 0;
+  brl->packetsRead = 0;
 
   brl->buffer = NULL;
   brl->isCoreBuffer = 0;
@@ -87,55 +87,98 @@ translateCell (const TranslationTable table, unsigned char cell) {
   return table? table[cell]: cell;
 }
 
-static TranslationTable internalOutputTable;
-static const unsigned char *outputTable;
+#ifndef THREAD_LOCAL
+#define THREAD_LOCAL
+#endif /* THREAD_LOCAL */
+
+/* Drivers being probed concurrently each build their tables into their own
+ * copy (see setThreadCellTranslationTables) so that they don't replace the
+ * ones which are in use.
+ */
+static CellTranslationTables sharedCellTranslationTables;
+static THREAD_LOCAL CellTranslationTables *threadCellTranslationTables = NULL;
+
+static inline CellTranslationTables *
+getCellTranslationTables (void) {
+  if (threadCellTranslationTables) return threadCellTranslationTables;
+  return &sharedCellTranslationTables;
+}
+
+void
+setThreadCellTranslationTables (CellTranslationTables *tables) {
+  threadCellTranslationTables = tables;
+}
+
+static const unsigned char *
+adoptCellTranslationTable (
+  const unsigned char *table,
+  const TranslationTable from, TranslationTable to
+) {
+  if (table != from) return table;
+  memcpy(to, from, TRANSLATION_TABLE_SIZE);
+  return to;
+}
+
+void
+adoptCellTranslationTables (const CellTranslationTables *tables) {
+  CellTranslationTables *shared = &sharedCellTranslationTables;
+
+  shared->outputTable = adoptCellTranslationTable(tables->outputTable,
+                                                  tables->internalOutputTable,
+                                                  shared->internalOutputTable);
+
+  shared->inputTable = adoptCellTranslationTable(tables->inputTable,
+                                                 tables->internalInputTable,
+                                                 shared->internalInputTable);
+}
 
 void
 setOutputTable (const TranslationTable table) {
-  outputTable = table;
+  getCellTranslationTables()->outputTable = table;
 }
 
 void
 makeOutputTable (const DotsTable dots) {
+  CellTranslationTables *tables = getCellTranslationTables();
+
   if (memcmp(dots, dotsTable_ISO11548_1, DOTS_TABLE_SIZE) == 0) {
-    outputTable = NULL;
+    tables->outputTable = NULL;
   } else {
-    makeTranslationTable(dots, internalOutputTable);
-    outputTable = internalOutputTable;
+    makeTranslationTable(dots, tables->internalOutputTable);
+    tables->outputTable = tables->internalOutputTable;
   }
 }
 
 void *
 translateOutputCells (unsigned char *target, const unsigned char *source, size_t count) {
-  return translateCells(outputTable, target, source, count);
+  return translateCells(getCellTranslationTables()->outputTable, target, source, count);
 }
 
 unsigned char
 translateOutputCell (unsigned char cell) {
-  return translateCell(outputTable, cell);
+  return translateCell(getCellTranslationTables()->outputTable, cell);
 }
 
-static TranslationTable internalInputTable;
-static const unsigned char *inputTable;
-
 void
 makeInputTable (void) {
-  if (outputTable) {
-    reverseTranslationTable(outputTable, internalInputTable);
-    inputTable = internalInputTable;
+  CellTranslationTables *tables = getCellTranslationTables();
+
+  if (tables->outputTable) {
+    reverseTranslationTable(tables->outputTable, tables->internalInputTable);
+    tables->inputTable = tables->internalInputTable;
   } else {
-    inputTable = NULL;
+    tables->inputTable = NULL;
   }
 }
 
 void *
 translateInputCells (unsigned char *target, const unsigned char *source, size_t count) {
-  return translateCells(inputTable, target, source, count);
+  return translateCells(getCellTranslationTables()->inputTable, target, source, count);
 }
 
 unsigned char
 translateInputCell (unsigned char cell) {
-  return translateCell(inputTable, cell);
+  return translateCell(getCellTranslationTables()->inputTable, cell);
 }
 
 void
@@ -218,55 +261,88 @@ readBraillePacket (
 
   if (!endpoint) endpoint = brl->gioEndpoint;
 
+  /* work directly on what the endpoint has already buffered so that a
+   * whole burst of input can be framed without reading it byte by byte
+   */
   while (1) {
-    unsigned char byte;
+    const unsigned char *input;
+    ssize_t available = gioPeekInput(endpoint, &input, started);
+    size_t index = 0;
 
-    if (!gioReadByte(endpoint, &byte, started)) {
+    if (available <= 0) {
       if (count > 0) logPartialPacket(bytes, count);
       return 0;
     }
 
-  gotByte:
-    started = 1;
+    while (index < available) {
+      unsigned char byte = input[index++];
 
-    if (count < size) {
-      bytes[count++] = byte;
+    gotByte:
+      started = 1;
 
-      {
-        BraillePacketVerifierResult result = verifyPacket(brl, bytes, count, &length, data);
+      if (count < size) {
+        bytes[count++] = byte;
 
-        switch (result) {
-          case BRL_PVR_EXCLUDE:
-            count -= 1;
-          case BRL_PVR_INCLUDE:
-            break;
+        {
+          BraillePacketVerifierResult result = verifyPacket(brl, bytes, count, &length, data);
 
-          default:
-            logMessage(LOG_WARNING, "unimplemented braille packet verifier result: %u", result);
-            /* fall through */
-          case BRL_PVR_INVALID:
-            started = 0;
-
-            if (--count) {
-              logShortPacket(bytes, count);
-              count = 0;
-              length = 1;
-              goto gotByte;
+          switch (result) {
+            case BRL_PVR_EXCLUDE:
+              count -= 1;
+            case BRL_PVR_INCLUDE:
+              break;
+
+            case BRL_PVR_SPAN: {
+              size_t span = available - index;
+
+              if (length > size) {
+                span = MIN(span, size-count);
+              } else if (length > count) {
+                span = MIN(span, length-count-1);
+              } else {
+                span = 0;
+              }
+
+              if (span) {
+                memcpy(&bytes[count], &input[index], span);
+                count += span;
+                index += span;
+              }
+
+              break;
             }
 
-            logIgnoredByte(byte);
-            continue;
+            default:
+              logMessage(LOG_WARNING, "unimplemented braille packet verifier result: %u", result);
+              /* fall through */
+            case BRL_PVR_INVALID:
+              started = 0;
+
+              if (--count) {
+                logShortPacket(bytes, count);
+                count = 0;
+                length = 1;
+                goto gotByte;
+              }
+
+              logIgnoredByte(byte);
+              continue;
+          }
         }
-      }
 
-      if (count >= length) {
-        logInputPacket(bytes, length);
-        return length;
+        if (count >= length) {
+          gioConsumeInput(endpoint, index);
+          logInputPacket(bytes, length);
+          if (endpoint == brl->gioEndpoint) brl->packetsRead += 1;
+          return length;
+        }
+      } else {
+        if (count++ == size) logTruncatedPacket(bytes, size);
+        logDiscardedByte(byte);
       }
-    } else {
-      if (count++ == size) logTruncatedPacket(bytes, size);
-      logDiscardedByte(byte);
     }
+
+    gioConsumeInput(endpoint, index);
   }
 }
 
@@ -286,6 +362,22 @@ writeBraillePacket (
   return 1;
 }
 
+int
+writeBrailleFrame (
+  BrailleDisplay *brl, GioEndpoint *endpoint,
+  int type,
+  const void *packet, size_t size
+) {
+  if (!endpoint) endpoint = brl->gioEndpoint;
+  logOutputPacket(packet, size);
+
+  /* The endpoint paces frames itself, and a newer frame replaces a queued
+   * one, so the core mustn't be held back by the transfer time.
+   */
+  if (gioWriteFrame(endpoint, type, packet, size) == -1) return 0;
+  return 1;
+}
+
 typedef struct {
   GioEndpoint *endpoint;
   int type;
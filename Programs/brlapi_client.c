@@ -299,6 +299,29 @@ static void brlapi_initializeHandle(brlapi_handle_t *handle)
   handle->clientData = NULL;
 }
 
+/* brlapi_handleException */
+/* Closes the connection and calls the exception handler */
+static void brlapi__handleException(brlapi_handle_t *handle, const brlapi_errorPacket_t *errorPacket, size_t size)
+{
+  size_t esize;
+  int hdrSize = sizeof(errorPacket->code)+sizeof(errorPacket->type);
+
+  if (size<hdrSize)
+    esize = 0;
+  else
+    esize = size-hdrSize;
+
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  closeFileDescriptor(handle->fileDescriptor);
+  handle->fileDescriptor = INVALID_FILE_DESCRIPTOR;
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+
+  if (handle==&defaultHandle)
+    defaultHandle.exceptionHandler.withoutHandle(ntohl(errorPacket->code), ntohl(errorPacket->type), &errorPacket->packet, esize);
+  else
+    handle->exceptionHandler.withHandle(handle, ntohl(errorPacket->code), ntohl(errorPacket->type), &errorPacket->packet, esize);
+}
+
 /* brlapi_doWaitForPacket */
 /* Waits for the specified type of packet: must be called with brlapi_req_mutex locked */
 /* deadline can be used to stop waiting after a given date, or wait forever (NULL) */
@@ -418,24 +441,7 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
   }
 
   if (type==BRLAPI_PACKET_EXCEPTION) {
-    size_t esize;
-    int hdrSize = sizeof(errorPacket->code)+sizeof(errorPacket->type);
-
-    if (size<hdrSize)
-      esize = 0;
-    else
-      esize = size-hdrSize;
-
-    pthread_mutex_lock(&handle->fileDescriptor_mutex);
-    closeFileDescriptor(handle->fileDescriptor);
-    handle->fileDescriptor = INVALID_FILE_DESCRIPTOR;
-    pthread_mutex_unlock(&handle->fileDescriptor_mutex);
-
-    if (handle==&defaultHandle)
-      defaultHandle.exceptionHandler.withoutHandle(ntohl(errorPacket->code), ntohl(errorPacket->type), &errorPacket->packet, esize);
-    else
-      handle->exceptionHandler.withHandle(handle, ntohl(errorPacket->code), ntohl(errorPacket->type), &errorPacket->packet, esize);
-
+    brlapi__handleException(handle, errorPacket, size);
     return -2;
   }
 
@@ -1204,33 +1210,17 @@ int BRLAPI_STDCALL brlapi_enterTtyMode(int tty, const char *how)
   return brlapi__enterTtyMode(&defaultHandle, tty, how);
 }
 
-/* Function : brlapi_enterTtyModeWithPath */
-/* Takes control of a tty path */
-int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *ttys, int nttys, const char *driverName)
+/* Function : makeEnterTtyModePacket */
+/* Fills in the packet for taking control of a tty path */
+/* Returns its size, or -1 on error */
+static ssize_t makeEnterTtyModePacket(brlapi_packet_t *packet, int *ttys, int nttys, const char *driverName)
 {
-  int res;
-  brlapi_packet_t packet;
   unsigned char *p;
-  uint32_t *nbTtys = (uint32_t*) &packet, *t = nbTtys+1;
+  uint32_t *nbTtys = (uint32_t*) packet, *t = nbTtys+1;
   char *ttytreepath,*ttytreepathstop;
   int ttypath;
   unsigned int n;
 
-  pthread_mutex_lock(&handle->state_mutex);
-  if ((handle->state & STCONTROLLINGTTY)) {
-    pthread_mutex_unlock(&handle->state_mutex);
-    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
-    return -1;
-  }
-
-  if (brlapi__getDisplaySize(handle, &handle->brlx, &handle->brly)<0) return -1;
-
-  /* Clear key buffer before taking the tty, just in case... */
-  pthread_mutex_lock(&handle->read_mutex);
-  handle->keybuf_next = handle->keybuf_nb = 0;
-  pthread_mutex_unlock(&handle->read_mutex);
-
-  /* OK, Now we know where we are, so get the effective control of the terminal! */
   *nbTtys = 0;
   ttytreepath = getenv("WINDOWPATH");
   if (!ttytreepath && getenv("DISPLAY"))
@@ -1258,13 +1248,13 @@ int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *tt
   p++;
   if (n) p = mempcpy(p, driverName, n);
 
-  if ((res=brlapi__writePacketWaitForAck(handle,BRLAPI_PACKET_ENTERTTYMODE,&packet,(p-(unsigned char *)&packet))) == 0) {
-    handle->state |= STCONTROLLINGTTY;
-  }
-
-  pthread_mutex_unlock(&handle->state_mutex);
+  return p-(unsigned char *)packet;
+}
 
-  /* Determine default charset if application did not call setlocale.  */
+/* Function : loadDefaultLocale */
+/* Determines default charset if application did not call setlocale */
+static void loadDefaultLocale(brlapi_handle_t *handle)
+{
 #ifdef LC_GLOBAL_LOCALE
   const char *locale = setlocale(LC_CTYPE, NULL);
 
@@ -1274,7 +1264,43 @@ int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *tt
     if (default_locale) handle->default_locale = default_locale;
   }
 #endif /* LC_GLOBAL_LOCALE */
+}
+
+/* Function : brlapi_enterTtyModeWithPath */
+/* Takes control of a tty path */
+int BRLAPI_STDCALL brlapi__enterTtyModeWithPath(brlapi_handle_t *handle, int *ttys, int nttys, const char *driverName)
+{
+  int res;
+  brlapi_packet_t packet;
+  ssize_t size;
+
+  pthread_mutex_lock(&handle->state_mutex);
+  if ((handle->state & STCONTROLLINGTTY)) {
+    pthread_mutex_unlock(&handle->state_mutex);
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    return -1;
+  }
+
+  if (brlapi__getDisplaySize(handle, &handle->brlx, &handle->brly)<0) return -1;
 
+  /* Clear key buffer before taking the tty, just in case... */
+  pthread_mutex_lock(&handle->read_mutex);
+  handle->keybuf_next = handle->keybuf_nb = 0;
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  /* OK, Now we know where we are, so get the effective control of the terminal! */
+  if ((size = makeEnterTtyModePacket(&packet, ttys, nttys, driverName)) == -1) {
+    pthread_mutex_unlock(&handle->state_mutex);
+    return -1;
+  }
+
+  if ((res=brlapi__writePacketWaitForAck(handle,BRLAPI_PACKET_ENTERTTYMODE,&packet,size)) == 0) {
+    handle->state |= STCONTROLLINGTTY;
+  }
+
+  pthread_mutex_unlock(&handle->state_mutex);
+
+  loadDefaultLocale(handle);
   return res;
 }
 
@@ -1895,13 +1921,11 @@ done:
   return result;
 }
 
-/* Function : ignore_accept_key_range */
-/* Common tasks for ignoring and unignoring key ranges */
-/* what = 0 for ignoring !0 for unignoring */
-static int ignore_accept_key_ranges(brlapi_handle_t *handle, int what, const brlapi_range_t ranges[], unsigned int n)
+/* Function : pack_key_ranges */
+/* Converts key ranges to their network representation */
+static void pack_key_ranges(uint32_t ints[][4], const brlapi_range_t ranges[], unsigned int n)
 {
-  uint32_t ints[n][4];
-  unsigned int i, remaining, todo;
+  unsigned int i;
 
   for (i=0; i<n; i++) {
     ints[i][0] = htonl(ranges[i].first >> 32);
@@ -1909,6 +1933,17 @@ static int ignore_accept_key_ranges(brlapi_handle_t *handle, int what, const brl
     ints[i][2] = htonl(ranges[i].last >> 32);
     ints[i][3] = htonl(ranges[i].last & 0xffffffff);
   };
+}
+
+/* Function : ignore_accept_key_range */
+/* Common tasks for ignoring and unignoring key ranges */
+/* what = 0 for ignoring !0 for unignoring */
+static int ignore_accept_key_ranges(brlapi_handle_t *handle, int what, const brlapi_range_t ranges[], unsigned int n)
+{
+  uint32_t ints[n][4];
+  unsigned int remaining, todo;
+
+  pack_key_ranges(ints, ranges, n);
 
   for (remaining = n; remaining; remaining -= todo) {
     todo = remaining;
@@ -1920,20 +1955,21 @@ static int ignore_accept_key_ranges(brlapi_handle_t *handle, int what, const brl
   return 0;
 }
 
-/* Function : ignore_accept_keys */
-/* Common tasks for ignoring and unignoring keys */
-/* what = 0 for ignoring !0 for unignoring */
-static int ignore_accept_keys(brlapi_handle_t *handle, int what, brlapi_rangeType_t r, const brlapi_keyCode_t *code, unsigned int n)
+/* Function : keys_to_ranges */
+/* Converts keys of the given type to key ranges */
+/* ranges must have room for MAX(n, 1) elements */
+/* Returns the number of ranges, or -1 on error */
+static int keys_to_ranges(brlapi_rangeType_t r, const brlapi_keyCode_t *code, unsigned int n, brlapi_range_t ranges[])
 {
   if (!n) {
     if (r != brlapi_rangeType_all) {
       brlapi_errno = BRLAPI_ERROR_INVALID_PARAMETER;
       return -1;
     }
-    brlapi_range_t range = { .first = 0, .last = BRLAPI_KEY_MAX };
-    return ignore_accept_key_ranges(handle, what, &range, 1);
+    ranges[0].first = 0;
+    ranges[0].last = BRLAPI_KEY_MAX;
+    return 1;
   } else {
-    brlapi_range_t ranges[n];
     unsigned int i;
     brlapi_keyCode_t mask;
 
@@ -1947,10 +1983,22 @@ static int ignore_accept_keys(brlapi_handle_t *handle, int what, brlapi_rangeTyp
       ranges[i].first = code[i];
       ranges[i].last = code[i] | mask;
     }
-    return ignore_accept_key_ranges(handle, what, ranges, n);
+    return n;
   }
 }
 
+/* Function : ignore_accept_keys */
+/* Common tasks for ignoring and unignoring keys */
+/* what = 0 for ignoring !0 for unignoring */
+static int ignore_accept_keys(brlapi_handle_t *handle, int what, brlapi_rangeType_t r, const brlapi_keyCode_t *code, unsigned int n)
+{
+  brlapi_range_t ranges[MAX(n, 1)];
+  int count = keys_to_ranges(r, code, n, ranges);
+
+  if (count == -1) return -1;
+  return ignore_accept_key_ranges(handle, what, ranges, count);
+}
+
 /* Function : brlapi_acceptKeyRanges */
 int BRLAPI_STDCALL brlapi__acceptKeyRanges(brlapi_handle_t *handle, const brlapi_range_t ranges[], unsigned int n)
 {
@@ -1995,6 +2043,334 @@ int BRLAPI_STDCALL brlapi_ignoreKeys(brlapi_rangeType_t r, const brlapi_keyCode_
   return brlapi__ignoreKeys(&defaultHandle, r, code, n);
 }
 
+/* Batched requests */
+
+typedef struct {
+  brlapi_packetType_t type;
+  union {
+    struct {
+      char *buffer;
+      size_t size;
+    } name;
+
+    struct {
+      unsigned int *x;
+      unsigned int *y;
+    } displaySize;
+  } reply;
+} brlapi_batchedRequest_t;
+
+struct brlapi_batch_t {
+  unsigned int count;
+  size_t size;
+  int error; /* brlapi_errno of the first request which couldn't be added */
+  int entersTty;
+  brlapi_batchedRequest_t requests[BRLAPI_MAXPACKETSIZE / BRLAPI_HEADERSIZE];
+  brlapi_packet_t packet;
+};
+
+/* Function : brlapi_resetBatch */
+/* Empties a batch so that it can be used again */
+static void brlapi_resetBatch(brlapi_batch_t *batch)
+{
+  batch->count = 0;
+  batch->size = 0;
+  batch->error = 0;
+  batch->entersTty = 0;
+}
+
+brlapi_batch_t *BRLAPI_STDCALL brlapi_newBatch(void)
+{
+  brlapi_batch_t *batch = malloc(sizeof(*batch));
+
+  if (!batch) {
+    brlapi_errno = BRLAPI_ERROR_NOMEM;
+    return NULL;
+  }
+
+  brlapi_resetBatch(batch);
+  return batch;
+}
+
+void BRLAPI_STDCALL brlapi_freeBatch(brlapi_batch_t *batch)
+{
+  free(batch);
+}
+
+/* Function : brlapi_addBatchedRequest */
+/* Appends a request to a batch */
+/* Returns the new request, or NULL if it doesn't fit */
+static brlapi_batchedRequest_t *brlapi_addBatchedRequest(brlapi_batch_t *batch, brlapi_packetType_t type, const void *data, size_t size)
+{
+  brlapi_batchedRequest_t *request;
+  brlapi_header_t header;
+
+  if (batch->error) return NULL;
+
+  if ((batch->size + BRLAPI_HEADERSIZE + size) > BRLAPI_MAXPACKETSIZE) {
+    /* remembered so that executing the batch reports it too */
+    batch->error = brlapi_errno = BRLAPI_ERROR_INVALID_PARAMETER;
+    return NULL;
+  }
+
+  header.size = htonl(size);
+  header.type = htonl(type);
+  memcpy(&batch->packet.data[batch->size], &header, BRLAPI_HEADERSIZE);
+  batch->size += BRLAPI_HEADERSIZE;
+
+  if (size) {
+    memcpy(&batch->packet.data[batch->size], data, size);
+    batch->size += size;
+  }
+
+  request = &batch->requests[batch->count++];
+  memset(request, 0, sizeof(*request));
+  request->type = type;
+  return request;
+}
+
+static int brlapi_batchGetName(brlapi_batch_t *batch, brlapi_packetType_t type, char *buffer, size_t size)
+{
+  brlapi_batchedRequest_t *request = brlapi_addBatchedRequest(batch, type, NULL, 0);
+  if (!request) return -1;
+
+  request->reply.name.buffer = buffer;
+  request->reply.name.size = size;
+  return 0;
+}
+
+int BRLAPI_STDCALL brlapi_batchGetDriverName(brlapi_batch_t *batch, char *buffer, size_t size)
+{
+  return brlapi_batchGetName(batch, BRLAPI_PACKET_GETDRIVERNAME, buffer, size);
+}
+
+int BRLAPI_STDCALL brlapi_batchGetModelIdentifier(brlapi_batch_t *batch, char *buffer, size_t size)
+{
+  return brlapi_batchGetName(batch, BRLAPI_PACKET_GETMODELID, buffer, size);
+}
+
+int BRLAPI_STDCALL brlapi_batchGetDisplaySize(brlapi_batch_t *batch, unsigned int *x, unsigned int *y)
+{
+  brlapi_batchedRequest_t *request = brlapi_addBatchedRequest(batch, BRLAPI_PACKET_GETDISPLAYSIZE, NULL, 0);
+  if (!request) return -1;
+
+  request->reply.displaySize.x = x;
+  request->reply.displaySize.y = y;
+  return 0;
+}
+
+int BRLAPI_STDCALL brlapi_batchEnterTtyModeWithPath(brlapi_batch_t *batch, int *ttys, int nttys, const char *driverName)
+{
+  brlapi_packet_t packet;
+  ssize_t size;
+
+  if (batch->entersTty) {
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    return -1;
+  }
+
+  if ((size = makeEnterTtyModePacket(&packet, ttys, nttys, driverName)) == -1) return -1;
+
+  /* writing text needs the display size, which is otherwise asked for first */
+  if (brlapi_batchGetDisplaySize(batch, NULL, NULL) == -1) return -1;
+  if (!brlapi_addBatchedRequest(batch, BRLAPI_PACKET_ENTERTTYMODE, &packet, size)) return -1;
+
+  batch->entersTty = 1;
+  return 0;
+}
+
+int BRLAPI_STDCALL brlapi_batchAcceptKeyRanges(brlapi_batch_t *batch, const brlapi_range_t ranges[], unsigned int n)
+{
+  uint32_t ints[MAX(n, 1)][4];
+
+  if (!n) return 0;
+  pack_key_ranges(ints, ranges, n);
+  return brlapi_addBatchedRequest(batch, BRLAPI_PACKET_ACCEPTKEYRANGES, ints, n*sizeof(ints[0]))? 0: -1;
+}
+
+int BRLAPI_STDCALL brlapi_batchIgnoreKeyRanges(brlapi_batch_t *batch, const brlapi_range_t ranges[], unsigned int n)
+{
+  uint32_t ints[MAX(n, 1)][4];
+
+  if (!n) return 0;
+  pack_key_ranges(ints, ranges, n);
+  return brlapi_addBatchedRequest(batch, BRLAPI_PACKET_IGNOREKEYRANGES, ints, n*sizeof(ints[0]))? 0: -1;
+}
+
+int BRLAPI_STDCALL brlapi_batchAcceptKeys(brlapi_batch_t *batch, brlapi_rangeType_t r, const brlapi_keyCode_t *code, unsigned int n)
+{
+  brlapi_range_t ranges[MAX(n, 1)];
+  int count = keys_to_ranges(r, code, n, ranges);
+
+  if (count == -1) return -1;
+  return brlapi_batchAcceptKeyRanges(batch, ranges, count);
+}
+
+int BRLAPI_STDCALL brlapi_batchIgnoreKeys(brlapi_batch_t *batch, brlapi_rangeType_t r, const brlapi_keyCode_t *code, unsigned int n)
+{
+  brlapi_range_t ranges[MAX(n, 1)];
+  int count = keys_to_ranges(r, code, n, ranges);
+
+  if (count == -1) return -1;
+  return brlapi_batchIgnoreKeyRanges(batch, ranges, count);
+}
+
+/* Function : brlapi__handleBatchedReply */
+/* Processes the reply to one request of a batch */
+/* Returns 0 if the request succeeded, -1 if it failed, */
+/* and -2 if the connection was closed */
+static int brlapi__handleBatchedReply(brlapi_handle_t *handle, const brlapi_batchedRequest_t *request, brlapi_packetType_t type, const brlapi_packet_t *reply, size_t size)
+{
+  switch (type) {
+    case BRLAPI_PACKET_ERROR:
+      brlapi_errno = (size >= sizeof(reply->error.code))? ntohl(reply->error.code): BRLAPI_ERROR_INVALID_PACKET;
+      return -1;
+
+    case BRLAPI_PACKET_EXCEPTION:
+      brlapi__handleException(handle, &reply->error, size);
+      brlapi_errno = BRLAPI_ERROR_EOF;
+      return -2;
+
+    case BRLAPI_PACKET_ACK:
+      if (request->type == BRLAPI_PACKET_ENTERTTYMODE) handle->state |= STCONTROLLINGTTY;
+      return 0;
+
+    default:
+      break;
+  }
+
+  if (type != request->type) {
+    syslog(LOG_ERR,"(brlapi_executeBatch) Received unexpected reply of type %s for a %s request\n",brlapi_getPacketTypeName(type),brlapi_getPacketTypeName(request->type));
+    brlapi_errno = BRLAPI_ERROR_PROTOCOL_VERSION;
+    return -1;
+  }
+
+  switch (type) {
+    case BRLAPI_PACKET_GETDRIVERNAME:
+    case BRLAPI_PACKET_GETMODELID:
+      if (request->reply.name.size) {
+        size_t length = MIN(size, request->reply.name.size);
+        memcpy(request->reply.name.buffer, reply->data, length);
+        request->reply.name.buffer[length? length-1: 0] = '\0';
+      }
+      return 0;
+
+    case BRLAPI_PACKET_GETDISPLAYSIZE: {
+      uint32_t displaySize[2];
+
+      if (size < sizeof(displaySize)) {
+        brlapi_errno = BRLAPI_ERROR_INVALID_PACKET;
+        return -1;
+      }
+
+      memcpy(displaySize, reply->data, sizeof(displaySize));
+      handle->brlx = ntohl(displaySize[0]);
+      handle->brly = ntohl(displaySize[1]);
+      if (request->reply.displaySize.x) *request->reply.displaySize.x = handle->brlx;
+      if (request->reply.displaySize.y) *request->reply.displaySize.y = handle->brly;
+      return 0;
+    }
+
+    default:
+      return 0;
+  }
+}
+
+int BRLAPI_STDCALL brlapi__executeBatch(brlapi_handle_t *handle, brlapi_batch_t *batch)
+{
+  unsigned int index = 0;
+  int error = 0;
+  int res = 0;
+
+  if (batch->error) {
+    brlapi_errno = batch->error;
+    brlapi_resetBatch(batch);
+    return -1;
+  }
+
+  if (!batch->count) return 0;
+
+  pthread_mutex_lock(&handle->state_mutex);
+
+  if (batch->entersTty) {
+    if ((handle->state & STCONTROLLINGTTY)) {
+      pthread_mutex_unlock(&handle->state_mutex);
+      brlapi_resetBatch(batch);
+      brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+      return -1;
+    }
+
+    /* Clear key buffer before taking the tty, just in case... */
+    pthread_mutex_lock(&handle->read_mutex);
+    handle->keybuf_next = handle->keybuf_nb = 0;
+    pthread_mutex_unlock(&handle->read_mutex);
+  }
+
+  pthread_mutex_lock(&handle->req_mutex);
+
+  if (brlapi_writePacket(handle->fileDescriptor, BRLAPI_PACKET_BATCH, &batch->packet, batch->size) < 0) {
+    res = -1;
+  } else {
+    /* the replies may be spread over several batch packets */
+    while (index < batch->count) {
+      brlapi_packet_t packet;
+      ssize_t size = brlapi__waitForPacket(handle, BRLAPI_PACKET_BATCH, &packet, sizeof(packet), 1, -1);
+      size_t offset = 0;
+
+      if (size < 0) {
+        res = -1;
+        break;
+      }
+
+      while ((index < batch->count) && ((size - offset) >= BRLAPI_HEADERSIZE)) {
+        brlapi_header_t header;
+        brlapi_packet_t reply;
+        int result;
+
+        memcpy(&header, &packet.data[offset], BRLAPI_HEADERSIZE);
+        offset += BRLAPI_HEADERSIZE;
+        header.size = ntohl(header.size);
+        header.type = ntohl(header.type);
+        if (header.size > (size - offset)) header.size = size - offset;
+
+        /* copy it so that it is properly aligned */
+        memcpy(&reply.data, &packet.data[offset], header.size);
+        offset += header.size;
+
+        result = brlapi__handleBatchedReply(handle, &batch->requests[index++], header.type, &reply, header.size);
+        if (result == -2) {
+          res = -1;
+          error = brlapi_errno;
+          goto done;
+        }
+
+        if ((result == -1) && !error) error = brlapi_errno;
+      }
+    }
+  }
+
+done:
+  pthread_mutex_unlock(&handle->req_mutex);
+  pthread_mutex_unlock(&handle->state_mutex);
+
+  if (batch->entersTty && (handle->state & STCONTROLLINGTTY)) loadDefaultLocale(handle);
+  brlapi_resetBatch(batch);
+
+  if (res == -1) return -1;
+
+  if (error) {
+    brlapi_errno = error;
+    return -1;
+  }
+
+  return 0;
+}
+
+int BRLAPI_STDCALL brlapi_executeBatch(brlapi_batch_t *batch)
+{
+  return brlapi__executeBatch(&defaultHandle, batch);
+}
+
 /* Error code handling */
 
 /* brlapi_errlist: error messages */
@@ -475,6 +475,7 @@ static const brlapi_packetTypeEntry_t brlapi_packetTypeTable[] = {
   { BRLAPI_PACKET_PACKET, "Packet" },
   { BRLAPI_PACKET_SUSPENDDRIVER, "SuspendDriver" },
   { BRLAPI_PACKET_RESUMEDRIVER, "ResumeDriver" },
+  { BRLAPI_PACKET_BATCH, "Batch" },
   { BRLAPI_PACKET_ACK, "Ack" },
   { BRLAPI_PACKET_ERROR, "Error" },
   { BRLAPI_PACKET_EXCEPTION, "Exception" },
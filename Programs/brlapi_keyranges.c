@@ -19,211 +19,420 @@
 #include "prologue.h"
 
 /* Source file for range list management module */
-/* For a description of what each function does, see rangelist.h */
+/* For a description of what each function does, see brlapi_keyranges.h */
+
+/* A list is a flat array of ranges sorted by their lowest value. Ranges may
+ * overlap (they can differ in their flags), so each position also records
+ * the highest value reached by any range up to and including it. Finding
+ * the ranges which might contain a value is then a binary search followed
+ * by a short walk back which stops as soon as that reach falls below it.
+ */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "brlapi_keyranges.h"
 #include "log.h"
 
-static int inKeyrange(KeyrangeList *l, KeyrangeElem e)
+struct KeyrangeListStruct {
+  Keyrange *ranges;
+  uint32_t *reach;
+  unsigned int count;
+  unsigned int size;
+};
+
+static int inKeyrange(const Keyrange *r, KeyrangeElem e)
 {
   uint32_t flags = KeyrangeFlags(e);
   uint32_t val = KeyrangeVal(e);
-  return (l->minVal <= val && val <= l->maxVal && (flags | l->minFlags) == flags && ((flags & ~l->maxFlags) == 0));
+  return (r->minVal <= val && val <= r->maxVal && (flags | r->minFlags) == flags && ((flags & ~r->maxFlags) == 0));
+}
+
+static void makeKeyrange(Keyrange *r, KeyrangeElem x0, KeyrangeElem y0)
+{
+  r->minFlags = KeyrangeFlags(x0) & KeyrangeFlags(y0);
+  r->maxFlags = KeyrangeFlags(x0) | KeyrangeFlags(y0);
+  r->minVal   = MIN(KeyrangeVal(x0), KeyrangeVal(y0));
+  r->maxVal   = MAX(KeyrangeVal(x0), KeyrangeVal(y0));
+}
+
+/* Function : getKeyrangeList */
+/* Returns the list, creating an empty one if necessary */
+static KeyrangeList *getKeyrangeList(KeyrangeList **l)
+{
+  if (!*l) {
+    KeyrangeList *list = malloc(sizeof(*list));
+    if (list == NULL) return NULL;
+    memset(list, 0, sizeof(*list));
+    *l = list;
+  }
+
+  return *l;
+}
+
+/* Function : reserveKeyranges */
+/* Makes room for count ranges */
+static int reserveKeyranges(KeyrangeList *l, unsigned int count)
+{
+  if (count > l->size) {
+    unsigned int size = MAX(count, (l->size? l->size<<1: 0X10));
+    Keyrange *ranges;
+    uint32_t *reach;
+
+    if (!(ranges = realloc(l->ranges, ARRAY_SIZE(ranges, size)))) return 0;
+    l->ranges = ranges;
+
+    if (!(reach = realloc(l->reach, ARRAY_SIZE(reach, size)))) return 0;
+    l->reach = reach;
+
+    l->size = size;
+  }
+
+  return 1;
 }
 
-/* Function : createKeyrange */
-static KeyrangeList **createKeyrange(KeyrangeList **p, uint32_t minFlags, uint32_t minVal, uint32_t maxFlags, uint32_t maxVal, KeyrangeList *n)
+/* Function : updateReach */
+/* Recomputes the reach of every range from the given index on */
+static void updateReach(KeyrangeList *l, unsigned int from)
 {
-  KeyrangeList *c = malloc(sizeof(KeyrangeList));
-  if (c==NULL) return NULL;
-  c->minFlags = minFlags; c->minVal = minVal;
-  c->maxFlags = maxFlags; c->maxVal = maxVal;
-  c->next = n;
-  *p = c;
-  return &c->next;
+  uint32_t reach = from? l->reach[from-1]: 0;
+
+  for (unsigned int i=from; i<l->count; i+=1) {
+    if (l->ranges[i].maxVal > reach) reach = l->ranges[i].maxVal;
+    l->reach[i] = reach;
+  }
 }
 
-/* Function : freeKeyrange */
-static void freeKeyrange(KeyrangeList **p, KeyrangeList *c)
+/* Function : countLowerRanges */
+/* Returns how many ranges have a lowest value not greater than val */
+static unsigned int countLowerRanges(const KeyrangeList *l, uint32_t val)
 {
-  if (c==NULL) return;
-  *p = c->next;
-  free(c);
+  unsigned int first = 0;
+  unsigned int last = l->count;
+
+  while (first < last) {
+    unsigned int current = (first + last) / 2;
+
+    if (l->ranges[current].minVal <= val) {
+      first = current + 1;
+    } else {
+      last = current;
+    }
+  }
+
+  return first;
+}
+
+/* Function : findFirstReach */
+/* Returns the index of the first range whose reach is at least val */
+static unsigned int findFirstReach(const KeyrangeList *l, uint32_t val)
+{
+  unsigned int first = 0;
+  unsigned int last = l->count;
+
+  while (first < last) {
+    unsigned int current = (first + last) / 2;
+
+    if (l->reach[current] < val) {
+      first = current + 1;
+    } else {
+      last = current;
+    }
+  }
+
+  return first;
+}
+
+static int compareByValue(const void *element1, const void *element2)
+{
+  const Keyrange *r1 = element1;
+  const Keyrange *r2 = element2;
+
+  if (r1->minVal < r2->minVal) return -1;
+  if (r1->minVal > r2->minVal) return 1;
+  return 0;
+}
+
+static int compareByFlags(const void *element1, const void *element2)
+{
+  const Keyrange *r1 = element1;
+  const Keyrange *r2 = element2;
+
+  if (r1->minFlags < r2->minFlags) return -1;
+  if (r1->minFlags > r2->minFlags) return 1;
+  if (r1->maxFlags < r2->maxFlags) return -1;
+  if (r1->maxFlags > r2->maxFlags) return 1;
+  return compareByValue(r1, r2);
+}
+
+/* Function : normalizeKeyrangeList */
+/* Merges overlapping and adjacent ranges which have the same flags, */
+/* then restores the ordering by value and the reach */
+static void normalizeKeyrangeList(KeyrangeList *l)
+{
+  if (l->count > 1) {
+    Keyrange *to = l->ranges;
+    const Keyrange *from = to + 1;
+    const Keyrange *end = to + l->count;
+
+    qsort(l->ranges, l->count, sizeof(*l->ranges), compareByFlags);
+
+    while (from < end) {
+      if ((from->minFlags == to->minFlags) && (from->maxFlags == to->maxFlags) &&
+          ((to->maxVal == UINT32_MAX) || (from->minVal <= (to->maxVal + 1)))) {
+        if (from->maxVal > to->maxVal) to->maxVal = from->maxVal;
+      } else {
+        *++to = *from;
+      }
+
+      from += 1;
+    }
+
+    l->count = to - l->ranges + 1;
+    qsort(l->ranges, l->count, sizeof(*l->ranges), compareByValue);
+  }
+
+  updateReach(l, 0);
 }
 
 /* Function : freeKeyrangeList */
 void freeKeyrangeList(KeyrangeList **l)
 {
-  KeyrangeList *p1, *p2;
   if (l==NULL) return;
-  p2 = *l;
-  while (p2!=NULL) {
-    p1 = p2;
-    p2 = p1->next;
-    free(p1);
+
+  if (*l) {
+    if ((*l)->ranges) free((*l)->ranges);
+    if ((*l)->reach) free((*l)->reach);
+    free(*l);
+    *l = NULL;
   }
-  *l = NULL;
 }
 
 /* Function : inKeyrangeList */
-KeyrangeList *inKeyrangeList(KeyrangeList *l, KeyrangeElem n)
+const Keyrange *inKeyrangeList(const KeyrangeList *l, KeyrangeElem n)
 {
-  KeyrangeList *c = l;
-  while (c!=NULL) {
-    if (inKeyrange(c, n)) return c;
-    c = c->next;
+  if (l) {
+    uint32_t val = KeyrangeVal(n);
+    unsigned int i = countLowerRanges(l, val);
+
+    while (i > 0) {
+      const Keyrange *c = &l->ranges[--i];
+
+      if (l->reach[i] < val) break;
+      if (inKeyrange(c, n)) return c;
+    }
   }
+
   return NULL;
 }
 
+/* Function : getKeyrangeCount */
+unsigned int getKeyrangeCount(const KeyrangeList *l)
+{
+  return l? l->count: 0;
+}
+
 /* Function : DisplayKeyrangeList */
 void DisplayKeyrangeList(KeyrangeList *l)
 {
-  if (l==NULL) printf("emptyset");
+  if (!getKeyrangeCount(l)) printf("emptyset");
   else {
-    KeyrangeList *c = l;
-    while (1) {
+    for (unsigned int i=0; i<l->count; i+=1) {
+      const Keyrange *c = &l->ranges[i];
+      if (i) printf(",");
       printf("[%lx(%lx)..%lx(%lx)]",(unsigned long)c->minVal,(unsigned long)c->minFlags,(unsigned long)c->maxVal,(unsigned long)c->maxFlags);
-      if (c->next==NULL) break;
-      printf(",");
-      c = c->next;
     }
   }
   printf("\n");
 }
 
+/* Function : addKeyranges */
+int addKeyranges(const KeyrangeElem ranges[][2], unsigned int count, KeyrangeList **l)
+{
+  KeyrangeList *list;
+
+  if (!(list = getKeyrangeList(l))) return -1;
+  if (!reserveKeyranges(list, list->count + count)) return -1;
+
+  for (unsigned int i=0; i<count; i+=1) {
+    Keyrange *r = &list->ranges[list->count++];
+
+    makeKeyrange(r, ranges[i][0], ranges[i][1]);
+    logMessage(LOG_DEBUG, "adding range [%"PRIx32"(%"PRIx32")..%"PRIx32"(%"PRIx32")]", r->minVal, r->minFlags, r->maxVal, r->maxFlags);
+  }
+
+  normalizeKeyrangeList(list);
+  return 0;
+}
+
 /* Function : addKeyrange */
 int addKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
 {
-  KeyrangeList *c;
-  uint32_t minFlags = KeyrangeFlags(x0) & KeyrangeFlags(y0);
-  uint32_t maxFlags = KeyrangeFlags(x0) | KeyrangeFlags(y0);
-  uint32_t minVal   = MIN(KeyrangeVal(x0), KeyrangeVal(y0));
-  uint32_t maxVal   = MAX(KeyrangeVal(x0), KeyrangeVal(y0));
-  KeyrangeElem min = KeyrangeElem(minFlags, minVal);
-  KeyrangeElem max = KeyrangeElem(maxFlags, maxVal);
-
-  logMessage(LOG_DEBUG, "adding range [%"PRIx32"(%"PRIx32")..%"PRIx32"(%"PRIx32")]", minVal, minFlags, maxVal, maxFlags);
-
-  c = *l;
-  while (c) {
-    if (inKeyrange(c, min) && inKeyrange(c, max))
-      /* Falls completely within an existing range */
-      return 0;
-
-    if (c->minVal <= maxVal && maxVal <= c->maxVal && minFlags == c->minFlags && maxFlags == c->maxFlags) {
-      /* May just change lower bound */
-      /* Note that minVal can't be >= c->minVal */
-      c->minVal = minVal;
-      return 0;
-    }
+  const KeyrangeElem range[1][2] = {{x0, y0}};
+  return addKeyranges(range, 1, l);
+}
 
-    if (c->minVal <= minVal && minVal <= c->maxVal && minFlags == c->minFlags && maxFlags == c->maxFlags) {
-      /* May just change upper bound */
-      /* Note that maxVal can't be <= c->maxVal */
-      c->maxVal = maxVal;
-      return 0;
-    }
+typedef struct {
+  Keyrange *ranges;
+  unsigned int count;
+  unsigned int size;
+} KeyrangePieces;
+
+static int addKeyrangePiece(KeyrangePieces *pieces, uint32_t minFlags, uint32_t minVal, uint32_t maxFlags, uint32_t maxVal)
+{
+  if (pieces->count == pieces->size) {
+    unsigned int size = pieces->size? pieces->size<<1: 0X10;
+    Keyrange *ranges = realloc(pieces->ranges, ARRAY_SIZE(ranges, size));
 
-    c = c->next;
+    if (!ranges) return 0;
+    pieces->ranges = ranges;
+    pieces->size = size;
   }
 
-  /* Else things are not easy, just add */
-  if ((createKeyrange(l,minFlags,minVal,maxFlags,maxVal,*l)) == NULL) return -1;
-  return 0;
+  {
+    Keyrange *r = &pieces->ranges[pieces->count++];
+    r->minFlags = minFlags; r->minVal = minVal;
+    r->maxFlags = maxFlags; r->maxVal = maxVal;
+  }
+
+  return 1;
 }
 
-int removeKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
+/* Function : subtractKeyrange */
+/* Adds what remains of c, once d has been removed from it, to pieces */
+static int subtractKeyrange(Keyrange c, const Keyrange *d, KeyrangePieces *pieces)
 {
-  uint32_t minFlags = KeyrangeFlags(x0) & KeyrangeFlags(y0);
-  uint32_t maxFlags = KeyrangeFlags(x0) | KeyrangeFlags(y0);
-  uint32_t minVal   = MIN(KeyrangeVal(x0), KeyrangeVal(y0));
-  uint32_t maxVal   = MAX(KeyrangeVal(x0), KeyrangeVal(y0));
-  KeyrangeList *c, **p, *tmp;
   int i;
 
-  if ((l==NULL) || (*l==NULL)) return 0;
+  if (c.minVal > d->maxVal || c.maxVal < d->minVal ||
+      !(c.maxFlags | ~d->minFlags) || !(~c.minFlags | d->maxFlags)) {
+    /* don't intersect */
+    return addKeyrangePiece(pieces, c.minFlags, c.minVal, c.maxFlags, c.maxVal);
+  }
+
+  if (d->minVal <= c.minVal && d->maxVal >= c.maxVal &&
+      (c.minFlags | d->minFlags) == c.minFlags &&
+      (c.maxFlags & ~d->maxFlags) == 0) {
+    /* range falls completely in deletion range, just drop it */
+    return 1;
+  }
+
+  /* Partly intersect */
+
+  if (c.minVal < d->minVal) {
+    /* lower part should be kept intact, save it. */
+    if (!addKeyrangePiece(pieces, c.minFlags, c.minVal, c.maxFlags, d->minVal - 1)) return 0;
+    c.minVal = d->minVal;
+  }
+
+  if (c.maxVal > d->maxVal) {
+    /* upper part should be kept intact, save it. */
+    if (!addKeyrangePiece(pieces, c.minFlags, d->maxVal + 1, c.maxFlags, c.maxVal)) return 0;
+    c.maxVal = d->maxVal;
+  }
 
-  logMessage(LOG_DEBUG, "removing range [%"PRIx32"(%"PRIx32")..%"PRIx32"(%"PRIx32")]", minVal, minFlags, maxVal, maxFlags);
+  /* Now values are the same, tinker with flags */
+  for (i=0; i<32; i++) {
+    uint32_t mask = 1<<i;
 
-  /* Need to intersect with every range */
-  p = l; c = *p;
-  while (c) {
-    if (c->minVal > maxVal || c->maxVal < minVal ||
-        !(c->maxFlags | ~minFlags) || !(~c->minFlags | maxFlags)) {
-      /* don't intersect */
-      p = &c->next;
-      c = *p;
+    if ((!(c.maxFlags & mask) &&  (d->minFlags & mask)) ||
+        ( (c.minFlags & mask) && !(d->maxFlags & mask)))
+      /* don't intersect on this flag */
       continue;
+
+    if (!(c.minFlags & mask) &&  (d->minFlags & mask)) {
+      /* && (c.maxFlags & mask) */
+      /* part without flag i should be kept intact, save it */
+      if (!addKeyrangePiece(pieces, c.minFlags, c.minVal, c.maxFlags & ~mask, c.maxVal)) return 0;
+      /* now handling part with flag i */
+      c.minFlags |= mask;
     }
 
-    if (minVal <= c->minVal && maxVal >= c->maxVal &&
-        (c->minFlags | minFlags) == c->minFlags &&
-        (c->maxFlags & ~maxFlags) == 0) {
-      /* range falls completely in deletion range, just drop it */
-      tmp = c; c = c->next;
-      freeKeyrange(p,tmp);
-      continue;
+    if ( (c.maxFlags & mask) && !(d->maxFlags & mask)) {
+      /* && !(c.minFlags & mask) */
+      /* part with flag i should be kept intact, save it */
+      if (!addKeyrangePiece(pieces, c.minFlags | mask, c.minVal, c.maxFlags, c.maxVal)) return 0;
+      /* now handling part without flag i */
+      c.maxFlags &= ~mask;
     }
 
-    /* Partly intersect */
+    if (!(c.maxFlags | ~d->minFlags) || !(~c.minFlags | d->maxFlags))
+      /* don't intersect any more*/
+      break;
+  }
 
-    if (c->minVal < minVal) {
-      /* lower part should be kept intact, save it. */
-      p = createKeyrange(p, c->minFlags, c->minVal, c->maxFlags, minVal - 1, c);
-      if (p == NULL) return -1;
-      c->minVal = minVal;
-    }
+  if (i<32) {
+    /* don't intersect any more, keep it */
+    if (!addKeyrangePiece(pieces, c.minFlags, c.minVal, c.maxFlags, c.maxVal)) return 0;
+  }
 
-    if (c->maxVal > maxVal) {
-      /* upper part should be kept intact, save it. */
-      p = createKeyrange(p, c->minFlags, maxVal + 1, c->maxFlags, c->maxVal, c);
-      if (p == NULL) return -1;
-      c->maxVal = maxVal;
-    }
+  /* else remaining intersection, drop it */
+  return 1;
+}
 
-    /* Now values are the same, tinker with flags */
-    for (i=0; i<32; i++) {
-      uint32_t mask = 1<<i;
-
-      if ((!(c->maxFlags & mask) &&  (minFlags & mask)) ||
-          ( (c->minFlags & mask) && !(maxFlags & mask)))
-	/* don't intersect on this flag */
-	continue;
-
-      if (!(c->minFlags & mask) &&  (minFlags & mask)) {
-        /* && (c->maxFlags & mask) */
-	/* part without flag i should be kept intact, save it */
-        p = createKeyrange(p, c->minFlags, c->minVal, c->maxFlags & ~mask, c->maxVal, c);
-        if (p == NULL) return -1;
-	/* now handling part with flag i */
-        c->minFlags |= mask;
-      }
+/* Function : removeKeyranges */
+int removeKeyranges(const KeyrangeElem ranges[][2], unsigned int count, KeyrangeList **l)
+{
+  KeyrangeList *list = *l;
+  KeyrangePieces pieces = {
+    .ranges = NULL,
+    .count = 0,
+    .size = 0
+  };
+  int result = 0;
+
+  if ((list==NULL) || !list->count) return 0;
+
+  for (unsigned int i=0; i<count; i+=1) {
+    Keyrange d;
+    makeKeyrange(&d, ranges[i][0], ranges[i][1]);
+
+    logMessage(LOG_DEBUG, "removing range [%"PRIx32"(%"PRIx32")..%"PRIx32"(%"PRIx32")]", d.minVal, d.minFlags, d.maxVal, d.maxFlags);
 
-      if ( (c->maxFlags & mask) && !(maxFlags & mask)) {
-        /* && !(c->minFlags & mask) */
-	/* part with flag i should be kept intact, save it */
-        p = createKeyrange(p, c->minFlags | mask, c->minVal, c->maxFlags, c->maxVal, c);
-        if (p == NULL) return -1;
-	/* now handling part without flag i */
-        c->maxFlags &= ~mask;
+    {
+      /* only these ranges can intersect with the deletion range */
+      unsigned int first = findFirstReach(list, d.minVal);
+      unsigned int end = countLowerRanges(list, d.maxVal);
+
+      if (first >= end) continue;
+      pieces.count = 0;
+
+      for (unsigned int j=first; j<end; j+=1) {
+        if (!subtractKeyrange(list->ranges[j], &d, &pieces)) {
+          result = -1;
+          goto done;
+        }
       }
 
-      if (!(c->maxFlags | ~minFlags) || !(~c->minFlags | maxFlags))
-        /* don't intersect any more*/
-	break;
-    }
-    if (i<32) {
-      /* don't intersect any more, keep it */
-      break;
-    } else {
-      /* remaining intersection, drop it */
-      tmp = c; c = c->next;
-      freeKeyrange(p,tmp);
+      /* Every piece starts at or after the first range it replaces, and at */
+      /* or before the ranges which follow, so sorting them is enough */
+      qsort(pieces.ranges, pieces.count, sizeof(*pieces.ranges), compareByValue);
+
+      {
+        unsigned int newCount = list->count - (end - first) + pieces.count;
+
+        if (!reserveKeyranges(list, newCount)) {
+          result = -1;
+          goto done;
+        }
+
+        memmove(&list->ranges[first + pieces.count], &list->ranges[end],
+                ARRAY_SIZE(list->ranges, list->count - end));
+        memcpy(&list->ranges[first], pieces.ranges, ARRAY_SIZE(pieces.ranges, pieces.count));
+        list->count = newCount;
+        updateReach(list, first);
+      }
     }
   }
 
-  return 0;
+done:
+  if (pieces.ranges) free(pieces.ranges);
+  return result;
+}
+
+/* Function : removeKeyrange */
+int removeKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
+{
+  const KeyrangeElem range[1][2] = {{x0, y0}};
+  return removeKeyranges(range, 1, l);
 }
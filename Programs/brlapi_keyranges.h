@@ -35,40 +35,53 @@ typedef uint64_t KeyrangeElem;
 #define KeyrangeElem(flags,val) (((KeyrangeElem)(flags) << 32) | (val))
 
 
-typedef struct KeyrangeList {
+typedef struct {
   uint32_t minFlags, maxFlags;
   uint32_t minVal, maxVal;
-  struct KeyrangeList *next;
-} KeyrangeList;
+} Keyrange;
+
+typedef struct KeyrangeListStruct KeyrangeList;
 
 /* Function : freeKeyrangeList */
 /* Frees a whole list */
-/* If you want to destroy a whole list, call this function, rather than */
-/* calling freeKeyrange on each element, since th latter cares about links */
-/* and hence is slower */
 extern void freeKeyrangeList(KeyrangeList **l);
 
 /* Function : inKeyrangeList */
 /* Determines if the range list l contains x */
-/* If yes, returns the adress of the cell [a..b] such that a<=x<=b */
+/* If yes, returns the adress of a range [a..b] such that a<=x<=b */
 /* If no, returns NULL */
-extern KeyrangeList *inKeyrangeList(KeyrangeList *l, KeyrangeElem n);
+/* This takes O(log n) time when ranges seldom overlap */
+extern const Keyrange *inKeyrangeList(const KeyrangeList *l, KeyrangeElem n);
+
+/* Function : getKeyrangeCount */
+/* Returns the number of ranges in a range list */
+extern unsigned int getKeyrangeCount(const KeyrangeList *l);
 
-/* Function : displayKeyrangeList */
+/* Function : DisplayKeyrangeList */
 /* Prints a range list on stdout */
 /* This is for debugging only */
-extern void displayKeyrangeList(KeyrangeList *l);
+extern void DisplayKeyrangeList(KeyrangeList *l);
 
 /* Function : addKeyrange */
 /* Adds a range to a range list */
 /* Return 0 if success, -1 if an error occurs */
 extern int addKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l);
 
+/* Function : addKeyranges */
+/* Adds several ranges (first/last pairs) to a range list at once */
+/* Return 0 if success, -1 if an error occurs */
+extern int addKeyranges(const KeyrangeElem ranges[][2], unsigned int count, KeyrangeList **l);
+
 /* Function : removeKeyrange */
 /* Removes a range from a range list */
 /* Returns 0 if success, -1 if failure */
 extern int removeKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l);
 
+/* Function : removeKeyranges */
+/* Removes several ranges (first/last pairs) from a range list at once */
+/* Returns 0 if success, -1 if failure */
+extern int removeKeyranges(const KeyrangeElem ranges[][2], unsigned int count, KeyrangeList **l);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
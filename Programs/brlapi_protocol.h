@@ -75,6 +75,7 @@ extern "C" {
 #define BRLAPI_PACKET_EXCEPTION       'E'   /**< Exception                   */
 #define BRLAPI_PACKET_SUSPENDDRIVER   'S'   /**< Suspend driver              */
 #define BRLAPI_PACKET_RESUMEDRIVER    'R'   /**< Resume driver               */
+#define BRLAPI_PACKET_BATCH           'B'   /**< Several requests at once    */
 
 /** Magic number to give when sending a BRLPACKET_ENTERRAWMODE or BRLPACKET_SUSPEND packet */
 #define BRLAPI_DEVICE_MAGIC (0xdeadbeefL)
@@ -136,6 +137,12 @@ typedef struct {
   unsigned char data; /** Fields in the same order as flag weight */
 } brlapi_writeArgumentsPacket_t;
 
+/** Batch packets are a sequence of sub-packets, each made of a
+ * brlapi_header_t (in network byte order) followed by its content. The
+ * server executes them in order, and answers with batch packets holding
+ * exactly one reply (ack, error, exception or data) per sub-packet, in the
+ * same order. A nested batch is refused with an error reply. */
+
 /** Type for packets.  Should be used instead of a mere char[], since it has
  * correct alignment requirements. */
 typedef union {
@@ -365,11 +365,62 @@ static int resumeDriver(BrailleDisplay *brl) {
 /** PACKET HANDLING                                                        **/
 /****************************************************************************/
 
+/* While a batch request is being executed, the replies to its */
+/* sub-requests are collected here instead of being sent one by one. */
+/* Only the server thread, which runs the packet handlers, may touch this: */
+/* the core thread also writes replies (e.g. raw mode driver errors), */
+/* and those must neither look at it nor be diverted into a batch. */
+typedef struct {
+  FileDescriptor fd;
+  unsigned int count;
+  size_t size;
+  brlapi_packet_t packet;
+} BatchReply;
+
+static BatchReply *batchReply = NULL;
+
+/* Function : flushBatchReply */
+/* Sends the replies collected so far as one batch packet */
+static void flushBatchReply(BatchReply *reply)
+{
+  if (reply->size) {
+    brlapiserver_writePacket(reply->fd,BRLAPI_PACKET_BATCH,&reply->packet.data,reply->size);
+    reply->size = 0;
+  }
+}
+
+/* Function : writeReply */
+/* Sends a reply packet on the given socket, or adds it to the batch reply */
+static void writeReply(FileDescriptor fd, brlapi_packetType_t type, const void *buf, size_t size)
+{
+  BatchReply *reply = pthread_equal(pthread_self(), serverThread)? batchReply: NULL;
+
+  if (reply && (reply->fd == fd)) {
+    brlapi_header_t *header;
+
+    if (size > (BRLAPI_MAXPACKETSIZE - BRLAPI_HEADERSIZE)) size = BRLAPI_MAXPACKETSIZE - BRLAPI_HEADERSIZE;
+    if ((reply->size + BRLAPI_HEADERSIZE + size) > BRLAPI_MAXPACKETSIZE) flushBatchReply(reply);
+
+    header = (brlapi_header_t *) &reply->packet.data[reply->size];
+    header->size = htonl(size);
+    header->type = htonl(type);
+    reply->size += BRLAPI_HEADERSIZE;
+    reply->count += 1;
+
+    if (size) {
+      memcpy(&reply->packet.data[reply->size], buf, size);
+      reply->size += size;
+    }
+  } else {
+    brlapiserver_writePacket(fd,type,buf,size);
+  }
+}
+
 /* Function : writeAck */
 /* Sends an acknowledgement on the given socket */
 static inline void writeAck(FileDescriptor fd)
 {
-  brlapiserver_writePacket(fd,BRLAPI_PACKET_ACK,NULL,0);
+  writeReply(fd,BRLAPI_PACKET_ACK,NULL,0);
 }
 
 /* Function : writeError */
@@ -378,7 +429,7 @@ static void writeError(FileDescriptor fd, unsigned int err)
 {
   uint32_t code = htonl(err);
   logMessage(LOG_CATEGORY(SERVER_EVENTS), "error %u on fd %"PRIfd, err, fd);
-  brlapiserver_writePacket(fd,BRLAPI_PACKET_ERROR,&code,sizeof(code));
+  writeReply(fd,BRLAPI_PACKET_ERROR,&code,sizeof(code));
 }
 
 /* Function : writeException */
@@ -394,7 +445,7 @@ static void writeException(FileDescriptor fd, unsigned int err, brlapi_packetTyp
   errorPacket->type = htonl(type);
   esize = MIN(size, BRLAPI_MAXPACKETSIZE-hdrsize);
   if ((packet!=NULL) && (size!=0)) memcpy(&errorPacket->packet, &packet->data, esize);
-  brlapiserver_writePacket(fd,BRLAPI_PACKET_EXCEPTION,&epacket.data, hdrsize+esize);
+  writeReply(fd,BRLAPI_PACKET_EXCEPTION,&epacket.data, hdrsize+esize);
 }
 
 static void writeKey(FileDescriptor fd, brlapi_keyCode_t key) {
@@ -422,6 +473,7 @@ typedef struct { /* packet handlers */
   PacketHandler packet;
   PacketHandler suspendDriver;
   PacketHandler resumeDriver;
+  PacketHandler batch;
 } PacketHandlers;
 
 /****************************************************************************/
@@ -483,10 +535,9 @@ getCursorOverlay (BrailleDisplay *brl) {
 static void getDots(const BrailleWindow *brailleWindow, unsigned char *buf)
 {
   int i;
-  unsigned char c;
+  convertCharactersToDots(textTable, brailleWindow->text, buf, displaySize);
   for (i=0; i<displaySize; i++) {
-    c = convertCharacterToDots(textTable, brailleWindow->text[i]);
-    buf[i] = (c & brailleWindow->andAttr[i]) | brailleWindow->orAttr[i];
+    buf[i] = (buf[i] & brailleWindow->andAttr[i]) | brailleWindow->orAttr[i];
   }
 
   if (brailleWindow->cursor) {
@@ -669,7 +720,7 @@ static int handleGetDriver(Connection *c, brlapi_packetType_t type, size_t size,
   int len = strlen(str);
   CHECKERR(size==0,BRLAPI_ERROR_INVALID_PACKET,"packet should be empty");
   CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
-  brlapiserver_writePacket(c->fd, type, str, len+1);
+  writeReply(c->fd, type, str, len+1);
   return 0;
 }
 
@@ -687,7 +738,7 @@ static int handleGetDisplaySize(Connection *c, brlapi_packetType_t type, brlapi_
 {
   CHECKERR(size==0,BRLAPI_ERROR_INVALID_PACKET,"packet should be empty");
   CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
-  brlapiserver_writePacket(c->fd,BRLAPI_PACKET_GETDISPLAYSIZE,&displayDimensions[0],sizeof(displayDimensions));
+  writeReply(c->fd,BRLAPI_PACKET_GETDISPLAYSIZE,&displayDimensions[0],sizeof(displayDimensions));
   return 0;
 }
 
@@ -843,28 +894,36 @@ static int handleLeaveTtyMode(Connection *c, brlapi_packetType_t type, brlapi_pa
 
 static int handleKeyRanges(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
 {
-  int res = 0;
-  brlapi_keyCode_t x,y;
+  int res;
   uint32_t (*ints)[4] = (uint32_t (*)[4]) packet;
+  unsigned int count = size / (2*sizeof(brlapi_keyCode_t));
   unsigned int i;
   CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
   CHECKERR(c->tty,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed out of tty mode");
   CHECKERR(!(size%(2*sizeof(brlapi_keyCode_t))),BRLAPI_ERROR_INVALID_PACKET,"wrong packet size");
-  lockMutex(&c->acceptedKeysMutex);
-  for (i=0; i<size/(2*sizeof(brlapi_keyCode_t)); i++) {
-    x = ((brlapi_keyCode_t)ntohl(ints[i][0]) << 32) | ntohl(ints[i][1]);
-    y = ((brlapi_keyCode_t)ntohl(ints[i][2]) << 32) | ntohl(ints[i][3]);
-    logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd" range: [%016"BRLAPI_PRIxKEYCODE"..%016"BRLAPI_PRIxKEYCODE"]",c->fd,x,y);
-    if (type==BRLAPI_PACKET_IGNOREKEYRANGES) res = removeKeyrange(x,y,&c->acceptedKeys);
-    else res = addKeyrange(x,y,&c->acceptedKeys);
-    if (res==-1) {
-      /* XXX: humf, in the middle of keycode updates :( */
-      WERR(c->fd,BRLAPI_ERROR_NOMEM,"no memory for key range");
-      break;
+  if (!count) {
+    writeAck(c->fd);
+    return 0;
+  }
+  {
+    KeyrangeElem ranges[count][2];
+    for (i=0; i<count; i++) {
+      ranges[i][0] = ((brlapi_keyCode_t)ntohl(ints[i][0]) << 32) | ntohl(ints[i][1]);
+      ranges[i][1] = ((brlapi_keyCode_t)ntohl(ints[i][2]) << 32) | ntohl(ints[i][3]);
+      logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd" range: [%016"BRLAPI_PRIxKEYCODE"..%016"BRLAPI_PRIxKEYCODE"]",c->fd,ranges[i][0],ranges[i][1]);
     }
+    /* the whole packet is applied in one go, so the list is sorted only once */
+    lockMutex(&c->acceptedKeysMutex);
+    if (type==BRLAPI_PACKET_IGNOREKEYRANGES) res = removeKeyranges(ranges,count,&c->acceptedKeys);
+    else res = addKeyranges(ranges,count,&c->acceptedKeys);
+    unlockMutex(&c->acceptedKeysMutex);
+  }
+  if (res==-1) {
+    /* XXX: humf, removals may have been partially applied :( */
+    WERR(c->fd,BRLAPI_ERROR_NOMEM,"no memory for key range");
+  } else {
+    writeAck(c->fd);
   }
-  unlockMutex(&c->acceptedKeysMutex);
-  if (!res) writeAck(c->fd);
   return 0;
 }
 
@@ -1102,12 +1161,96 @@ static int handleResumeDriver(Connection *c, brlapi_packetType_t type, brlapi_pa
   return 0;
 }
 
+/* Function : getPacketHandler */
+/* Returns the handler for the given packet type, or NULL if there isn't one */
+static PacketHandler getPacketHandler(const PacketHandlers *handlers, brlapi_packetType_t type)
+{
+  switch (type) {
+    case BRLAPI_PACKET_GETDRIVERNAME: return handlers->getDriverName;
+    case BRLAPI_PACKET_GETMODELID: return handlers->getModelIdentifier;
+    case BRLAPI_PACKET_GETDISPLAYSIZE: return handlers->getDisplaySize;
+    case BRLAPI_PACKET_ENTERTTYMODE: return handlers->enterTtyMode;
+    case BRLAPI_PACKET_SETFOCUS: return handlers->setFocus;
+    case BRLAPI_PACKET_LEAVETTYMODE: return handlers->leaveTtyMode;
+    case BRLAPI_PACKET_IGNOREKEYRANGES: return handlers->ignoreKeyRanges;
+    case BRLAPI_PACKET_ACCEPTKEYRANGES: return handlers->acceptKeyRanges;
+    case BRLAPI_PACKET_WRITE: return handlers->write;
+    case BRLAPI_PACKET_ENTERRAWMODE: return handlers->enterRawMode;
+    case BRLAPI_PACKET_LEAVERAWMODE: return handlers->leaveRawMode;
+    case BRLAPI_PACKET_PACKET: return handlers->packet;
+    case BRLAPI_PACKET_SUSPENDDRIVER: return handlers->suspendDriver;
+    case BRLAPI_PACKET_RESUMEDRIVER: return handlers->resumeDriver;
+    case BRLAPI_PACKET_BATCH: return handlers->batch;
+    default: return NULL;
+  }
+}
+
+static PacketHandlers packetHandlers;
+
+/* Function : handleBatch */
+/* Executes the sub-requests of a batch packet in order, */
+/* and sends their replies back together */
+static int handleBatch(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
+{
+  BatchReply reply;
+  size_t offset;
+  unsigned int count = 0;
+
+  /* check the whole batch before executing any of it */
+  for (offset=0; offset<size; count+=1) {
+    const brlapi_header_t *header = (const brlapi_header_t *) &packet->data[offset];
+    CHECKEXC((size-offset)>=BRLAPI_HEADERSIZE,BRLAPI_ERROR_INVALID_PACKET,"truncated sub-request header");
+    offset += BRLAPI_HEADERSIZE;
+    CHECKEXC(ntohl(header->size)<=(size-offset),BRLAPI_ERROR_INVALID_PACKET,"truncated sub-request");
+    offset += ntohl(header->size);
+  }
+
+  logMessage(LOG_CATEGORY(SERVER_EVENTS), "executing %u batched requests on fd %"PRIfd, count, c->fd);
+  reply.fd = c->fd;
+  reply.count = 0;
+  reply.size = 0;
+  batchReply = &reply;
+
+  for (offset=0; offset<size; ) {
+    brlapi_packet_t subPacket;
+    brlapi_header_t header;
+    PacketHandler handler;
+    unsigned int replies = reply.count;
+
+    memcpy(&header, &packet->data[offset], BRLAPI_HEADERSIZE);
+    offset += BRLAPI_HEADERSIZE;
+    header.size = ntohl(header.size);
+    header.type = ntohl(header.type);
+
+    /* copy it so that it is properly aligned */
+    memcpy(&subPacket.data, &packet->data[offset], header.size);
+    offset += header.size;
+
+    if (header.type == BRLAPI_PACKET_BATCH) {
+      WERR(c->fd, BRLAPI_ERROR_ILLEGAL_INSTRUCTION, "nested batch request");
+    } else if ((handler = getPacketHandler(&packetHandlers, header.type))) {
+      logRequest(header.type, c->fd);
+      handler(c, header.type, &subPacket, header.size);
+    } else {
+      WEXC(c->fd, BRLAPI_ERROR_UNKNOWN_INSTRUCTION, header.type, &subPacket, header.size, "unknown packet type");
+    }
+
+    /* every sub-request gets exactly one reply, even those which */
+    /* normally don't get any when they succeed (e.g. write) */
+    if (reply.count == replies) writeAck(c->fd);
+  }
+
+  batchReply = NULL;
+  flushBatchReply(&reply);
+  return 0;
+}
+
 static PacketHandlers packetHandlers = {
   handleGetDriverName, handleGetModelIdentifier, handleGetDisplaySize,
   handleEnterTtyMode, handleSetFocus, handleLeaveTtyMode,
   handleKeyRanges, handleKeyRanges, handleWrite,
   handleEnterRawMode, handleLeaveRawMode, handlePacket,
-  handleSuspendDriver, handleResumeDriver,
+  handleSuspendDriver, handleResumeDriver, handleBatch,
 };
 
 static void handleNewConnection(Connection *c)
@@ -1290,22 +1433,7 @@ static int processRequest(Connection *c, PacketHandlers *handlers)
     logMessage(LOG_WARNING, "Discarding too large packet of type %s on fd %"PRIfd,brlapiserver_getPacketTypeName(type), c->fd);
     return 0;
   }
-  switch (type) {
-    case BRLAPI_PACKET_GETDRIVERNAME: p = handlers->getDriverName; break;
-    case BRLAPI_PACKET_GETMODELID: p = handlers->getModelIdentifier; break;
-    case BRLAPI_PACKET_GETDISPLAYSIZE: p = handlers->getDisplaySize; break;
-    case BRLAPI_PACKET_ENTERTTYMODE: p = handlers->enterTtyMode; break;
-    case BRLAPI_PACKET_SETFOCUS: p = handlers->setFocus; break;
-    case BRLAPI_PACKET_LEAVETTYMODE: p = handlers->leaveTtyMode; break;
-    case BRLAPI_PACKET_IGNOREKEYRANGES: p = handlers->ignoreKeyRanges; break;
-    case BRLAPI_PACKET_ACCEPTKEYRANGES: p = handlers->acceptKeyRanges; break;
-    case BRLAPI_PACKET_WRITE: p = handlers->write; break;
-    case BRLAPI_PACKET_ENTERRAWMODE: p = handlers->enterRawMode; break;
-    case BRLAPI_PACKET_LEAVERAWMODE: p = handlers->leaveRawMode; break;
-    case BRLAPI_PACKET_PACKET: p = handlers->packet; break;
-    case BRLAPI_PACKET_SUSPENDDRIVER: p = handlers->suspendDriver; break;
-    case BRLAPI_PACKET_RESUMEDRIVER: p = handlers->resumeDriver; break;
-  }
+  p = getPacketHandler(handlers, type);
   if (p!=NULL) {
     logRequest(type, c->fd);
     p(c, type, packet, size);
@@ -30,6 +30,7 @@
 #include "parse.h"
 #include "file.h"
 #include "cmd_queue.h"
+#include "cmd_enqueue.h"
 #include "brl.h"
 #include "brl_input.h"
 #include "brl_utils.h"
@@ -39,6 +40,8 @@
 #include "charset.h"
 #include "async_wait.h"
 #include "learn.h"
+#include "io_generic.h"
+#include "timing.h"
 
 BrailleDisplay brl;
 
@@ -46,6 +49,7 @@ static char *opt_brailleDevice;
 static char *opt_driversDirectory;
 static char *opt_tablesDirectory;
 static char *opt_writableDirectory;
+static int opt_benchmark;
 
 BEGIN_OPTION_TABLE(programOptions)
   { .letter = 'D',
@@ -85,8 +89,181 @@ BEGIN_OPTION_TABLE(programOptions)
     .internal.setting = BRAILLE_DEVICE,
     .description = "Path to device for accessing braille display."
   },
+
+  { .letter = 'b',
+    .word = "benchmark",
+    .setting.flag = &opt_benchmark,
+    .description = "Report driver statistics for a replayed device (replay:file)."
+  },
 END_OPTION_TABLE
 
+#define BENCHMARK_STALL_TIMEOUT 10000
+#define BENCHMARK_SETTLE_TIME 100
+#define BENCHMARK_UPDATE_COUNT 100
+
+typedef struct {
+  GioReplayStatistics statistics;
+  unsigned long int updates;
+  unsigned long int updatesWritten;
+  unsigned long int updateBytes;
+
+  unsigned long int commands;
+  unsigned long int latencyTotal;
+  unsigned long int latencyMaximum;
+} BenchmarkData;
+
+static long int
+microsecondsBetween (const TimeValue *from, const TimeValue *to) {
+  return ((to->seconds - from->seconds) * USECS_PER_SEC)
+       + ((to->nanoseconds - from->nanoseconds) / NSECS_PER_USEC);
+}
+
+static int
+handleBenchmarkCommands (int command, void *data) {
+  BenchmarkData *bmd = data;
+  GioReplayStatistics statistics;
+
+  if (gioGetReplayStatistics(brl.gioEndpoint, &statistics)) {
+    TimeValue now;
+    long int latency;
+
+    getMonotonicTime(&now);
+    latency = microsecondsBetween(&statistics.inputTime, &now);
+    if (latency < 0) latency = 0;
+
+    bmd->latencyTotal += latency;
+    if (latency > bmd->latencyMaximum) bmd->latencyMaximum = latency;
+  }
+
+  bmd->commands += 1;
+  return 1;
+}
+
+static int
+writeBenchmarkWindow (BenchmarkData *bmd) {
+  size_t size = brl.textColumns * brl.textRows;
+  wchar_t text[size];
+  unsigned long int outputBytes;
+  unsigned int i;
+
+  for (i=0; i<size; i+=1) {
+    text[i] = WC_C('a') + ((bmd->updates + i) % 26);
+  }
+
+  convertCharactersToDots(textTable, text, brl.buffer, size);
+
+  gioGetReplayStatistics(brl.gioEndpoint, &bmd->statistics);
+  outputBytes = bmd->statistics.outputBytes;
+
+  bmd->updates += 1;
+  if (!braille->writeWindow(&brl, text)) return 0;
+
+  /* drivers which wait for acknowledgements may defer the update */
+  gioGetReplayStatistics(brl.gioEndpoint, &bmd->statistics);
+  outputBytes = bmd->statistics.outputBytes - outputBytes;
+
+  if (outputBytes) {
+    bmd->updatesWritten += 1;
+    bmd->updateBytes += outputBytes;
+  }
+
+  return 1;
+}
+
+static int
+runBenchmark (void) {
+  BenchmarkData bmd;
+  TimeValue start;
+  long int inputTime;
+
+  memset(&bmd, 0, sizeof(bmd));
+
+  if (!gioGetReplayStatistics(brl.gioEndpoint, &bmd.statistics)) {
+    logMessage(LOG_ERR, "benchmarking requires a replay device");
+    return 0;
+  }
+
+  pushCommandEnvironment("benchmark", NULL, NULL);
+  pushCommandHandler("benchmark", KTB_CTX_DEFAULT,
+                     handleBenchmarkCommands, NULL, &bmd);
+
+  getMonotonicTime(&start);
+
+  while (1) {
+    GioEndpoint *endpoint = brl.gioEndpoint;
+
+    /* Call the driver directly rather than via the input poller so that
+     * what's measured is the driver's own parsing.
+     */
+    if (gioAwaitInput(endpoint, 0)) {
+      int command = readBrailleCommand(&brl, KTB_CTX_DEFAULT);
+
+      if (command != EOF) enqueueCommand(command);
+      asyncWait(0);
+      continue;
+    }
+
+    gioGetReplayStatistics(endpoint, &bmd.statistics);
+    if (bmd.statistics.inputFinished) break;
+
+    if (bmd.statistics.awaitingOutput) {
+      /* the recorded input is waiting for the driver to write something */
+      if (!writeBenchmarkWindow(&bmd)) break;
+    } else if (!gioAwaitInput(endpoint, BENCHMARK_STALL_TIMEOUT)) {
+      logMessage(LOG_WARNING, "replay stalled");
+      break;
+    }
+  }
+
+  inputTime = MAX(getMonotonicElapsed(&start), 1);
+
+  asyncWait(BENCHMARK_SETTLE_TIME);
+  popCommandEnvironment();
+
+  {
+    unsigned long int updates = bmd.updates;
+
+    while (bmd.updates - updates < BENCHMARK_UPDATE_COUNT) {
+      if (!writeBenchmarkWindow(&bmd)) break;
+    }
+
+    printf("input: %lu bytes in %lu chunks, %lu packets, %ld ms",
+           bmd.statistics.inputBytes, bmd.statistics.inputChunks,
+           brl.packetsRead, inputTime);
+    if (!bmd.statistics.inputFinished) printf(" (incomplete)");
+    printf("\n");
+
+    printf("packets/s: %lu  bytes/s: %lu\n",
+           (brl.packetsRead * MSECS_PER_SEC) / inputTime,
+           (bmd.statistics.inputBytes * MSECS_PER_SEC) / inputTime);
+
+    printf("commands: %lu", bmd.commands);
+    if (bmd.commands) {
+      printf("  latency (us): average %lu, maximum %lu",
+             bmd.latencyTotal / bmd.commands, bmd.latencyMaximum);
+    }
+    printf("\n");
+
+    printf("updates: %lu (%lu written)", bmd.updates, bmd.updatesWritten);
+    if (bmd.updatesWritten) {
+      printf("  output bytes/update: %lu", bmd.updateBytes / bmd.updatesWritten);
+    }
+    printf("\n");
+
+    {
+      GioOutputStatistics output;
+
+      gioGetOutputStatistics(brl.gioEndpoint, &output);
+      printf("output frames: %lu queued, %lu superseded, maximum queue depth %u\n",
+             output.enqueuedFrames, output.supersededFrames,
+             output.maximumQueueDepth);
+    }
+  }
+
+  /* a replay which didn't run to its end means the driver went astray */
+  return bmd.statistics.inputFinished;
+}
+
 int
 main (int argc, char *argv[]) {
   ProgramExitStatus exitStatus;
@@ -105,6 +282,7 @@ main (int argc, char *argv[]) {
   }
 
   setWritableDirectory(opt_writableDirectory);
+  gioEnableReplay();
 
   if (argc) {
     driver = *argv++, --argc;
@@ -188,9 +366,15 @@ main (int argc, char *argv[]) {
         }
 
         beginCommandQueue();
-        startBrailleInput();
-        learnMode(10000);
-        stopBrailleInput();
+
+        if (opt_benchmark) {
+          exitStatus = runBenchmark()? PROG_EXIT_SUCCESS: PROG_EXIT_FATAL;
+        } else {
+          startBrailleInput();
+          learnMode(10000);
+          stopBrailleInput();
+          exitStatus = PROG_EXIT_SUCCESS;
+        }
 
         if (brl.keyTable) {
           KeyTable *table = brl.keyTable;
@@ -200,7 +384,6 @@ main (int argc, char *argv[]) {
         }
 
         braille->destruct(&brl);		/* finish with the display */
-        exitStatus = PROG_EXIT_SUCCESS;
       } else {
         logMessage(LOG_ERR, "can't allocate braille buffer");
         exitStatus = PROG_EXIT_FATAL;
@@ -265,13 +448,7 @@ message (const char *mode, const char *text, MessageOptions options) {
     }
     wmemset(&buffer[count], WC_C(' '), (size - count));
 
-    {
-      unsigned int i;
-
-      for (i=0; i<size; i+=1) {
-        brl.buffer[i] = convertCharacterToDots(textTable, buffer[i]);
-      }
-    }
+    convertCharactersToDots(textTable, buffer, brl.buffer, size);
 
     if (!braille->writeWindow(&brl, buffer)) return 0;
 
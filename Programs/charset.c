@@ -228,6 +228,16 @@ getUtf8Length (const char *utf8) {
 void
 convertUtf8ToWchars (const char **utf8, wchar_t **characters, size_t count) {
   while (**utf8 && (count > 1)) {
+    const unsigned char *byte = (const unsigned char *)*utf8;
+
+    if (!(byte[0] & 0X80) && ((byte[1] & 0XC0) != 0X80)) {
+      /* plain ASCII - by far the most common case */
+      *(*characters)++ = byte[0];
+      *utf8 += 1;
+      count -= 1;
+      continue;
+    }
+
     size_t utfs = UTF8_LEN_MAX;
     wint_t character = convertUtf8ToWchar(utf8, &utfs);
 
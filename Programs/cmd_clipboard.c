@@ -35,6 +35,7 @@
 #include "datafile.h"
 #include "charset.h"
 #include "core.h"
+#include "timing.h"
 
 typedef struct {
   struct {
@@ -368,14 +369,21 @@ cpbPaste (ClipboardCommandData *ccd, unsigned int index) {
   if (!length) return 0;
 
   {
-    unsigned int i;
+    TimeValue start;
+    int inserted;
 
-    for (i=0; i<length; i+=1)
-      if (!insertScreenKey(characters[i]))
-        return 0;
-  }
+    getMonotonicTime(&start);
+    inserted = insertScreenCharacters(characters, length);
 
-  return 1;
+    {
+      long int elapsed = getMonotonicElapsed(&start);
+
+      logMessage(LOG_DEBUG, "clipboard paste: %"PRIsize " characters in %ldms (%ld/s)",
+                 length, elapsed, (long int)((length * 1000) / (elapsed? elapsed: 1)));
+    }
+
+    return inserted;
+  }
 }
 
 static FILE *
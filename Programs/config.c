@@ -26,6 +26,10 @@
 #include <errno.h>
 #include <fcntl.h>
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif /* HAVE_SYS_INOTIFY_H */
+
 #include "parameters.h"
 #include "embed.h"
 #include "log.h"
@@ -36,6 +40,7 @@
 #include "cmd.h"
 #include "brl.h"
 #include "brl_utils.h"
+#include "brl_base.h"
 #include "spk.h"
 #include "spk_input.h"
 #include "scr.h"
@@ -60,6 +65,10 @@
 #include "parse.h"
 #include "dynld.h"
 #include "async_alarm.h"
+#include "async_wait.h"
+#include "async_event.h"
+#include "thread.h"
+#include "timing.h"
 #include "program.h"
 #include "revision.h"
 #include "service.h"
@@ -173,6 +182,7 @@ static char *opt_driversDirectory;
 
 static char *opt_brailleDevice;
 int opt_releaseDevice;
+static int opt_concurrentProbing;
 static char **brailleDevices = NULL;
 static const char *brailleDevice = NULL;
 static int brailleConstructed;
@@ -188,6 +198,7 @@ static char *oldPreferencesFile = NULL;
 static int oldPreferencesEnabled = 1;
 
 char *opt_tablesDirectory;
+static int opt_watchTables;
 char *opt_textTable;
 char *opt_attributesTable;
 
@@ -427,6 +438,14 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("Release braille device when screen or window is unreadable.")
   },
 
+  { .letter = 'j',
+    .word = "concurrent-probing",
+    .flags = OPT_Hidden | OPT_Config | OPT_Environ,
+    .setting.flag = &opt_concurrentProbing,
+    .internal.setting = FLAG_FALSE_WORD,
+    .description = strtext("Probe all of the braille devices at the same time.")
+  },
+
   { .letter = 'T',
     .word = "tables-directory",
     .flags = OPT_Hidden | OPT_Config | OPT_Environ,
@@ -437,6 +456,14 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("Path to directory containing tables.")
   },
 
+  { .letter = 'w',
+    .word = "watch-tables",
+    .flags = OPT_Hidden | OPT_Config | OPT_Environ,
+    .setting.flag = &opt_watchTables,
+    .internal.setting = FLAG_FALSE_WORD,
+    .description = strtext("Recompile the tables whenever their files change.")
+  },
+
   { .letter = 't',
     .word = "text-table",
     .bootParameter = 3,
@@ -743,9 +770,387 @@ brlttyPrepare (int argc, char *argv[]) {
   return PROG_EXIT_SUCCESS;
 }
 
+typedef struct {
+  char *path;
+  const char *name;
+  int watch;
+} TableFile;
+
+typedef struct {
+  const char *type;
+  const char *cannotCompile;
+
+  char *(*makePath) (const char *directory, const char *name);
+  void *(*compile) (const char *path);
+  void (*destroy) (void *table);
+  int (*install) (void *table);
+
+  unsigned int generation;
+  char *name;
+
+  struct {
+    TableFile *array;
+    unsigned int count;
+  } files;
+
+  unsigned reload:1;
+} TableLoader;
+
+typedef struct {
+  TableLoader *loader;
+  const char *path;
+
+  void *table;
+  TableFile *files;
+  unsigned int fileSize;
+  unsigned int fileCount;
+} TableCompilation;
+
+static void
+deallocateTableFiles (TableFile *files, unsigned int count) {
+  if (files) {
+    while (count > 0) free(files[--count].path);
+    free(files);
+  }
+}
+
+static
+DATA_FILE_OPENED_HANDLER(addTableFile) {
+  TableCompilation *tc = data;
+
+  if (tc->fileCount == tc->fileSize) {
+    unsigned int newSize = tc->fileSize? tc->fileSize<<1: 0X8;
+    TableFile *newArray = realloc(tc->files, ARRAY_SIZE(newArray, newSize));
+
+    if (!newArray) {
+      logMallocError();
+      return;
+    }
+
+    tc->files = newArray;
+    tc->fileSize = newSize;
+  }
+
+  {
+    TableFile *file = &tc->files[tc->fileCount];
+
+    if ((file->path = strdup(path))) {
+      file->name = locatePathName(file->path);
+      file->watch = -1;
+      tc->fileCount += 1;
+    } else {
+      logMallocError();
+    }
+  }
+}
+
+static void
+compileTableFile (TableCompilation *tc) {
+  /* the watch needs to know which files the table was built from */
+  if (opt_watchTables) setDataFileOpenedHandler(addTableFile, tc);
+  tc->table = tc->loader->compile(tc->path);
+  setDataFileOpenedHandler(NULL, NULL);
+}
+
+#if defined(GOT_PTHREADS) && defined(THREAD_LOCAL)
+/* Tables are compiled one at a time: the global variables are shared by
+ * every thread, and so are some of the external translators.
+ */
+static pthread_mutex_t tableCompilationMutex = PTHREAD_MUTEX_INITIALIZER;
+
+THREAD_FUNCTION(runTableCompilationThread) {
+  TableCompilation *tc = argument;
+
+  lockMutex(&tableCompilationMutex);
+  compileTableFile(tc);
+  releaseDataVariables();
+  unlockMutex(&tableCompilationMutex);
+
+  return NULL;
+}
+#endif /* defined(GOT_PTHREADS) && defined(THREAD_LOCAL) */
+
+static void
+compileTable (TableCompilation *tc) {
+#if defined(GOT_PTHREADS) && defined(THREAD_LOCAL)
+  /* The main thread keeps updating the braille display (with the old table)
+   * while the new one is being compiled.
+   */
+  if (callThreadFunction("table-compiler", runTableCompilationThread, tc, NULL)) return;
+  logMessage(LOG_WARNING, "%s table compilation thread not started", tc->loader->type);
+#endif /* defined(GOT_PTHREADS) && defined(THREAD_LOCAL) */
+
+  compileTableFile(tc);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+static TableLoader *const *getTableLoaders (void);
+static int changeTable (TableLoader *loader, const char *name);
+
+static int tableWatchDescriptor = -1;
+static AsyncHandle tableWatchMonitor = NULL;
+static AsyncHandle tableReloadAlarm = NULL;
+
+static void
+stopTableWatch (void) {
+  if (tableWatchMonitor) {
+    asyncCancelRequest(tableWatchMonitor);
+    tableWatchMonitor = NULL;
+  }
+
+  if (tableWatchDescriptor != -1) {
+    close(tableWatchDescriptor);
+    tableWatchDescriptor = -1;
+  }
+}
+
+static void
+exitTableWatch (void *data) {
+  stopTableWatch();
+
+  if (tableReloadAlarm) {
+    asyncCancelRequest(tableReloadAlarm);
+    tableReloadAlarm = NULL;
+  }
+}
+
+ASYNC_ALARM_CALLBACK(handleTableReloadAlarm) {
+  TableLoader *const *loader = getTableLoaders();
+
+  asyncDiscardHandle(tableReloadAlarm);
+  tableReloadAlarm = NULL;
+
+  while (*loader) {
+    if ((*loader)->reload) {
+      (*loader)->reload = 0;
+
+      if ((*loader)->name) {
+        char name[strlen((*loader)->name) + 1];
+
+        strcpy(name, (*loader)->name);
+        logMessage(LOG_INFO, "recompiling %s table: %s", (*loader)->type, name);
+        changeTable(*loader, name);
+      }
+    }
+
+    loader += 1;
+  }
+}
+
+ASYNC_MONITOR_CALLBACK(handleTableFileChanges) {
+  if (parameters->error) {
+    logActionError(parameters->error, "table watch");
+    return 0;
+  }
+
+  {
+    int changed = 0;
+    union {
+      struct inotify_event event;
+      char bytes[0X1000];
+    } buffer;
+    ssize_t count;
+
+    while ((count = read(tableWatchDescriptor, &buffer, sizeof(buffer))) > 0) {
+      const char *byte = buffer.bytes;
+      const char *end = byte + count;
+
+      while (byte < end) {
+        const struct inotify_event *event = (const void *)byte;
+
+        if (event->len) {
+          TableLoader *const *loader = getTableLoaders();
+
+          while (*loader) {
+            const TableFile *file = (*loader)->files.array;
+            const TableFile *fileEnd = file + (*loader)->files.count;
+
+            while (file < fileEnd) {
+              if ((file->watch == event->wd) && (strcmp(file->name, event->name) == 0)) {
+                logMessage(LOG_DEBUG, "table file changed: %s", file->path);
+                (*loader)->reload = 1;
+                changed = 1;
+                break;
+              }
+
+              file += 1;
+            }
+
+            loader += 1;
+          }
+        }
+
+        byte += sizeof(*event) + event->len;
+      }
+    }
+
+    if ((count == -1) && (errno != EAGAIN)) logSystemError("table watch read");
+
+    /* editors usually write a file in several steps */
+    if (changed) {
+      if (tableReloadAlarm) {
+        asyncResetAlarmIn(tableReloadAlarm, TABLE_RELOAD_DELAY);
+      } else {
+        asyncNewRelativeAlarm(&tableReloadAlarm, TABLE_RELOAD_DELAY, handleTableReloadAlarm, NULL);
+      }
+    }
+  }
+
+  return 1;
+}
+
+static void
+startTableWatch (void) {
+  static int exitRegistered = 0;
+  TableLoader *const *loader;
+  int watching = 0;
+
+  stopTableWatch();
+  if (!opt_watchTables) return;
+
+  if (!exitRegistered) {
+    onProgramExit("table-watch", exitTableWatch, NULL);
+    exitRegistered = 1;
+  }
+
+  if ((tableWatchDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+    logSystemError("inotify_init1");
+    return;
+  }
+
+  for (loader=getTableLoaders(); *loader; loader+=1) {
+    TableFile *file = (*loader)->files.array;
+    TableFile *end = file + (*loader)->files.count;
+
+    while (file < end) {
+      char *directory = getPathDirectory(file->path);
+
+      if (directory) {
+        if ((file->watch = inotify_add_watch(tableWatchDescriptor, directory, IN_CLOSE_WRITE | IN_MOVED_TO)) != -1) {
+          watching = 1;
+        } else {
+          logSystemError("inotify_add_watch");
+        }
+
+        free(directory);
+      }
+
+      file += 1;
+    }
+  }
+
+  if (watching) {
+    if (asyncMonitorFileInput(&tableWatchMonitor, tableWatchDescriptor, handleTableFileChanges, NULL)) {
+      return;
+    }
+  }
+
+  stopTableWatch();
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+static int
+changeTable (TableLoader *loader, const char *name) {
+  unsigned int generation = ++loader->generation;
+
+  TableCompilation tc = {
+    .loader = loader,
+    .path = NULL,
+
+    .table = NULL,
+    .files = NULL,
+    .fileSize = 0,
+    .fileCount = 0
+  };
+
+  if (name) {
+    char *path;
+
+    if ((path = loader->makePath(opt_tablesDirectory, name))) {
+      tc.path = path;
+      logMessage(LOG_DEBUG, "compiling %s table: %s", loader->type, path);
+      compileTable(&tc);
+
+      if (!tc.table) logMessage(LOG_ERR, "%s: %s", gettext(loader->cannotCompile), path);
+      tc.path = NULL;
+      free(path);
+    }
+
+    if (!tc.table) {
+      deallocateTableFiles(tc.files, tc.fileCount);
+      return 0;
+    }
+
+    if (generation != loader->generation) {
+      /* another table was selected while this one was being compiled */
+      logMessage(LOG_DEBUG, "discarding superseded %s table: %s", loader->type, name);
+      loader->destroy(tc.table);
+      deallocateTableFiles(tc.files, tc.fileCount);
+      return 1;
+    }
+  }
+
+  if (!loader->install(tc.table)) {
+    deallocateTableFiles(tc.files, tc.fileCount);
+    return 0;
+  }
+
+  {
+    char *newName = NULL;
+
+    if (name && !(newName = strdup(name))) logMallocError();
+    if (loader->name) free(loader->name);
+    loader->name = newName;
+  }
+
+  deallocateTableFiles(loader->files.array, loader->files.count);
+  loader->files.array = tc.files;
+  loader->files.count = tc.fileCount;
+
+#ifdef HAVE_SYS_INOTIFY_H
+  startTableWatch();
+#endif /* HAVE_SYS_INOTIFY_H */
+
+  return 1;
+}
+
+static void *
+compileTextTableFile (const char *path) {
+  return compileTextTable(path);
+}
+
+static void
+destroyTextTableObject (void *table) {
+  destroyTextTable(table);
+}
+
+static int
+installTextTable (void *table) {
+  if (!table) return replaceTextTable(opt_tablesDirectory, NULL);
+
+  {
+    TextTable *oldTable = textTable;
+
+    textTable = table;
+    destroyTextTable(oldTable);
+  }
+
+  return 1;
+}
+
+static TableLoader textTableLoader = {
+  .type = "text",
+  .cannotCompile = strtext("cannot compile text table"),
+
+  .makePath = makeTextTablePath,
+  .compile = compileTextTableFile,
+  .destroy = destroyTextTableObject,
+  .install = installTextTable
+};
+
 int
 changeTextTable (const char *name) {
-  return replaceTextTable(opt_tablesDirectory, name);
+  return changeTable(&textTableLoader, name);
 }
 
 static void
@@ -753,9 +1158,43 @@ exitTextTable (void *data) {
   changeTextTable(NULL);
 }
 
+static void *
+compileAttributesTableFile (const char *path) {
+  return compileAttributesTable(path);
+}
+
+static void
+destroyAttributesTableObject (void *table) {
+  destroyAttributesTable(table);
+}
+
+static int
+installAttributesTable (void *table) {
+  if (!table) return replaceAttributesTable(opt_tablesDirectory, NULL);
+
+  {
+    AttributesTable *oldTable = attributesTable;
+
+    attributesTable = table;
+    destroyAttributesTable(oldTable);
+  }
+
+  return 1;
+}
+
+static TableLoader attributesTableLoader = {
+  .type = "attributes",
+  .cannotCompile = strtext("cannot compile attributes table"),
+
+  .makePath = makeAttributesTablePath,
+  .compile = compileAttributesTableFile,
+  .destroy = destroyAttributesTableObject,
+  .install = installAttributesTable
+};
+
 int
 changeAttributesTable (const char *name) {
-  return replaceAttributesTable(opt_tablesDirectory, name);
+  return changeTable(&attributesTableLoader, name);
 }
 
 static void
@@ -764,39 +1203,61 @@ exitAttributesTable (void *data) {
 }
 
 #ifdef ENABLE_CONTRACTED_BRAILLE
+static void *
+compileContractionTableFile (const char *path) {
+  return compileContractionTable(path);
+}
+
+static void
+destroyContractionTableObject (void *table) {
+  destroyContractionTable(table);
+}
+
+static int
+installContractionTable (void *table) {
+  if (contractionTable) destroyContractionTable(contractionTable);
+  contractionTable = table;
+  return 1;
+}
+
+static TableLoader contractionTableLoader = {
+  .type = "contraction",
+  .cannotCompile = strtext("cannot compile contraction table"),
+
+  .makePath = makeContractionTablePath,
+  .compile = compileContractionTableFile,
+  .destroy = destroyContractionTableObject,
+  .install = installContractionTable
+};
+
 static void
 exitContractionTable (void *data) {
-  if (contractionTable) {
-    destroyContractionTable(contractionTable);
-    contractionTable = NULL;
-  }
+  changeTable(&contractionTableLoader, NULL);
 }
 
 int
 changeContractionTable (const char *name) {
-  ContractionTable *table = NULL;
-
-  if (*name) {
-    char *path;
-
-    if ((path = makeContractionTablePath(opt_tablesDirectory, name))) {
-      logMessage(LOG_DEBUG, "compiling contraction table: %s", path);
+  return changeTable(&contractionTableLoader, (*name? name: NULL));
+}
+#endif /* ENABLE_CONTRACTED_BRAILLE */
 
-      if (!(table = compileContractionTable(path))) {
-        logMessage(LOG_ERR, "%s: %s", gettext("cannot compile contraction table"), path);
-      }
+#ifdef HAVE_SYS_INOTIFY_H
+static TableLoader *const *
+getTableLoaders (void) {
+  static TableLoader *const loaders[] = {
+    &textTableLoader,
+    &attributesTableLoader,
 
-      free(path);
-    }
+#ifdef ENABLE_CONTRACTED_BRAILLE
+    &contractionTableLoader,
+#endif /* ENABLE_CONTRACTED_BRAILLE */
 
-    if (!table) return 0;
-  }
+    NULL
+  };
 
-  if (contractionTable) destroyContractionTable(contractionTable);
-  contractionTable = table;
-  return 1;
+  return loaders;
 }
-#endif /* ENABLE_CONTRACTED_BRAILLE */
+#endif /* HAVE_SYS_INOTIFY_H */
 
 static KeyTableState
 handleKeyboardEvent (KeyGroup group, KeyNumber number, int press) {
@@ -1370,43 +1831,49 @@ initializeBrailleDisplay (void) {
   brl.api = &api;
 }
 
-int
-constructBrailleDriver (void) {
-  initializeBrailleDisplay();
-
-  if (braille->construct(&brl, brailleDriverParameters, brailleDevice)) {
-    if (ensureBrailleBuffer(&brl, LOG_INFO)) {
-      if (brl.keyBindings) {
-        char *keyTablePath = makeBrailleKeyTablePath();
-
-        logMessage(LOG_INFO, "%s: %s", gettext("Key Bindings"), brl.keyBindings);
-
-        if (keyTablePath) {
-          if (brl.keyNames) {
-            if ((brl.keyTable = compileKeyTable(keyTablePath, brl.keyNames))) {
-              logMessage(LOG_INFO, "%s: %s", gettext("Key Table"), keyTablePath);
-
-              setKeyTableLogLabel(brl.keyTable, "brl");
-              setLogKeyEventsFlag(brl.keyTable, &LOG_CATEGORY_FLAG(BRAILLE_KEYS));
-              setKeyboardEnabledFlag(brl.keyTable, &prefs.brailleKeyboardEnabled);
-            } else {
-              logMessage(LOG_WARNING, "%s: %s", gettext("cannot compile key table"), keyTablePath);
-            }
+static int
+completeBrailleDriverConstruction (void) {
+  if (ensureBrailleBuffer(&brl, LOG_INFO)) {
+    if (brl.keyBindings) {
+      char *keyTablePath = makeBrailleKeyTablePath();
+
+      logMessage(LOG_INFO, "%s: %s", gettext("Key Bindings"), brl.keyBindings);
+
+      if (keyTablePath) {
+        if (brl.keyNames) {
+          if ((brl.keyTable = compileKeyTable(keyTablePath, brl.keyNames))) {
+            logMessage(LOG_INFO, "%s: %s", gettext("Key Table"), keyTablePath);
+
+            setKeyTableLogLabel(brl.keyTable, "brl");
+            setLogKeyEventsFlag(brl.keyTable, &LOG_CATEGORY_FLAG(BRAILLE_KEYS));
+            setKeyboardEnabledFlag(brl.keyTable, &prefs.brailleKeyboardEnabled);
+          } else {
+            logMessage(LOG_WARNING, "%s: %s", gettext("cannot compile key table"), keyTablePath);
           }
-
-          makeBrailleHelpPage(keyTablePath);
-          free(keyTablePath);
         }
+
+        makeBrailleHelpPage(keyTablePath);
+        free(keyTablePath);
       }
+    }
 
-      report(REPORT_BRAILLE_ONLINE, NULL);
-      startBrailleInput();
+    report(REPORT_BRAILLE_ONLINE, NULL);
+    startBrailleInput();
 
-      brailleConstructed = 1;
-      return 1;
-    }
+    brailleConstructed = 1;
+    return 1;
+  }
+
+  braille->destruct(&brl);
+  return 0;
+}
+
+int
+constructBrailleDriver (void) {
+  initializeBrailleDisplay();
 
-    braille->destruct(&brl);
+  if (braille->construct(&brl, brailleDriverParameters, brailleDevice)) {
+    if (completeBrailleDriverConstruction()) return 1;
   } else {
     logMessage(LOG_DEBUG, "%s: %s -> %s",
                gettext("braille driver initialization failed"),
@@ -1429,6 +1896,39 @@ destructBrailleDriver (void) {
   destructBrailleDisplay(&brl);
 }
 
+static int
+announceBrailleDriver (void) {
+  logMessage(LOG_INFO, "%s: %s [%s]",
+             gettext("Braille Driver"), braille->definition.code, braille->definition.name);
+  identifyBrailleDriver(braille, 0);
+  logParameters(braille->parameters, brailleDriverParameters,
+                gettext("Braille Parameter"));
+  logMessage(LOG_INFO, "%s: %s", gettext("Braille Device"), brailleDevice);
+
+  {
+    const char *strings[] = {
+      CONFIGURATION_DIRECTORY, "/",
+      PACKAGE_TARNAME, "-",
+      braille->definition.code, ".prefs"
+    };
+
+    oldPreferencesFile = joinStrings(strings, ARRAY_COUNT(strings));
+  }
+
+  if (oldPreferencesFile) {
+    logMessage(LOG_INFO, "%s: %s", gettext("Old Preferences File"), oldPreferencesFile);
+
+    startApiServer();
+    api.link();
+
+    return 1;
+  } else {
+    logMallocError();
+  }
+
+  return 0;
+}
+
 static int
 initializeBrailleDriver (const char *code, int verify) {
   if ((braille = loadBrailleDriver(code, &brailleObject, opt_driversDirectory))) {
@@ -1450,48 +1950,610 @@ initializeBrailleDriver (const char *code, int verify) {
       }
 
       if (constructed) {
-        logMessage(LOG_INFO, "%s: %s [%s]",
-                   gettext("Braille Driver"), braille->definition.code, braille->definition.name);
-        identifyBrailleDriver(braille, 0);
-        logParameters(braille->parameters, brailleDriverParameters,
-                      gettext("Braille Parameter"));
-        logMessage(LOG_INFO, "%s: %s", gettext("Braille Device"), brailleDevice);
-
-        {
-          const char *strings[] = {
-            CONFIGURATION_DIRECTORY, "/",
-            PACKAGE_TARNAME, "-",
-            braille->definition.code, ".prefs"
-          };
-
-          oldPreferencesFile = joinStrings(strings, ARRAY_COUNT(strings));
-        }
+        if (announceBrailleDriver()) return 1;
+      }
+
+      deallocateStrings(brailleDriverParameters);
+      brailleDriverParameters = NULL;
+    }
+
+    unloadDriverObject(&brailleObject);
+  } else {
+    logMessage(LOG_ERR, "%s: %s", gettext("braille driver not loadable"), code);
+  }
+
+  braille = &noBraille;
+  return 0;
+}
+
+static const char *const *
+getAutodetectableBrailleDrivers (const char *device) {
+  if (isSerialDeviceIdentifier(&device)) {
+    static const char *const serialDrivers[] = {
+      "md", "pm", "ts", "ht", "bn", "al", "bm", "pg", "sk",
+      NULL
+    };
+    return serialDrivers;
+  }
+
+  if (isUsbDeviceIdentifier(&device)) {
+    static const char *const usbDrivers[] = {
+      "al", "bm", "bn", "eu", "fs", "hd", "hm", "ht", "hw", "ic", "mt", "pg", "pm", "sk", "vo",
+      NULL
+    };
+    return usbDrivers;
+  }
+
+  if (isBluetoothDeviceIdentifier(&device)) {
+    const char *const *drivers = bthGetDriverCodes(device, BLUETOOTH_DEVICE_NAME_OBTAIN_TIMEOUT);
+    if (drivers) return drivers;
+
+    {
+      static const char *const bluetoothDrivers[] = {
+        "np", "ht", "al", "bm",
+        NULL
+      };
+      return bluetoothDrivers;
+    }
+  }
 
-        if (oldPreferencesFile) {
-          logMessage(LOG_INFO, "%s: %s", gettext("Old Preferences File"), oldPreferencesFile);
+  {
+    static const char *const noDrivers[] = {NULL};
+    return noDrivers;
+  }
+}
+
+#if defined(GOT_PTHREADS) && defined(THREAD_LOCAL)
+typedef enum {
+  BRL_PROBE_USB,
+  BRL_PROBE_SERIAL,
+  BRL_PROBE_BLUETOOTH,
+  BRL_PROBE_OTHER,
+  BRL_PROBE_GROUP_COUNT
+} BrailleProbeGroupIndex;
+
+typedef struct {
+  const BrailleDriver *driver;
+  void *object;
+  char **parameters;
+
+  BrailleDisplay display;
+  CellTranslationTables cellTranslationTables;
+} BrailleProbeInstance;
+
+typedef struct {
+  unsigned int references;
+  unsigned int running;
+  unsigned cancel:1;
+
+  AsyncEvent *event;
+  char *foundDevice;
+  char *foundDriver;
+  BrailleProbeInstance *foundInstance;
+} BrailleProbeData;
+
+typedef struct {
+  BrailleProbeData *probe;
+  char **devices;
+  unsigned int count;
+} BrailleProbeGroup;
+
+typedef struct BrailleProbeDriverLockStruct BrailleProbeDriverLock;
+
+struct BrailleProbeDriverLockStruct {
+  BrailleProbeDriverLock *next;
+  const char *code;
+};
+
+static pthread_mutex_t brailleProbeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t brailleProbeCondition = PTHREAD_COND_INITIALIZER;
+static BrailleProbeDriverLock *brailleProbeDriverLocks = NULL;
 
-          startApiServer();
-          api.link();
+static void
+destroyBrailleProbeInstance (BrailleProbeInstance *instance) {
+  instance->driver->destruct(&instance->display);
+  destructBrailleDisplay(&instance->display);
+
+  deallocateStrings(instance->parameters);
+  unloadDriverObject(&instance->object);
+  free(instance);
+}
+
+static void
+releaseBrailleProbeData (BrailleProbeData *probe) {
+  int last;
+
+  lockMutex(&brailleProbeMutex);
+  last = !--probe->references;
+  unlockMutex(&brailleProbeMutex);
+
+  if (last) {
+    if (probe->foundInstance) destroyBrailleProbeInstance(probe->foundInstance);
+    if (probe->foundDevice) free(probe->foundDevice);
+    if (probe->foundDriver) free(probe->foundDriver);
+    free(probe);
+  }
+}
+
+static void
+deallocateBrailleProbeGroup (BrailleProbeGroup *group) {
+  while (group->count) free(group->devices[--group->count]);
+  if (group->devices) free(group->devices);
+
+  releaseBrailleProbeData(group->probe);
+  free(group);
+}
+
+static int
+isBrailleProbeDriverBusy (const char *code) {
+  const BrailleProbeDriverLock *lock = brailleProbeDriverLocks;
 
-          return 1;
+  while (lock) {
+    if (strcmp(lock->code, code) == 0) return 1;
+    lock = lock->next;
+  }
+
+  return 0;
+}
+
+static int
+acquireBrailleProbeDriver (
+  BrailleProbeDriverLock *lock, const char *code,
+  const BrailleProbeData *probe
+) {
+  int acquired = 0;
+
+  /* The same driver mustn't be constructed by two threads at the same
+   * time because drivers keep their state in static variables. Once a
+   * driver has been found no more are started so that none of them can
+   * interfere with the one being activated.
+   */
+  lockMutex(&brailleProbeMutex);
+
+  while (!probe->cancel) {
+    if (!isBrailleProbeDriverBusy(code)) {
+      lock->code = code;
+      lock->next = brailleProbeDriverLocks;
+      brailleProbeDriverLocks = lock;
+
+      acquired = 1;
+      break;
+    }
+
+    pthread_cond_wait(&brailleProbeCondition, &brailleProbeMutex);
+  }
+
+  unlockMutex(&brailleProbeMutex);
+  return acquired;
+}
+
+static void
+releaseBrailleProbeDriver (BrailleProbeDriverLock *lock) {
+  BrailleProbeDriverLock **previous = &brailleProbeDriverLocks;
+
+  lockMutex(&brailleProbeMutex);
+
+  while (*previous) {
+    if (*previous == lock) {
+      *previous = lock->next;
+      break;
+    }
+
+    previous = &(*previous)->next;
+  }
+
+  pthread_cond_broadcast(&brailleProbeCondition);
+  unlockMutex(&brailleProbeMutex);
+}
+
+static void
+notifyBrailleProbe (BrailleProbeData *probe) {
+  pthread_cond_broadcast(&brailleProbeCondition);
+  if (probe->event) asyncSignalEvent(probe->event, NULL);
+}
+
+static int
+setBrailleProbeResult (
+  BrailleProbeData *probe, const char *device, const char *code,
+  BrailleProbeInstance *instance
+) {
+  int accepted = 0;
+
+  lockMutex(&brailleProbeMutex);
+
+  if (!probe->foundDriver) {
+    if ((probe->foundDevice = strdup(device))) {
+      if ((probe->foundDriver = strdup(code))) {
+        probe->foundInstance = instance;
+        probe->cancel = 1;
+        accepted = 1;
+      } else {
+        free(probe->foundDevice);
+        probe->foundDevice = NULL;
+      }
+    }
+
+    if (!accepted) logMallocError();
+  }
+
+  notifyBrailleProbe(probe);
+  unlockMutex(&brailleProbeMutex);
+
+  return accepted;
+}
+
+static int
+isAdoptableBrailleProbeInstance (const BrailleProbeInstance *instance) {
+  /* An acknowledgement alarm refers to the display by its address, and it
+   * belongs to the thread which constructed the driver.
+   */
+  if (instance->display.acknowledgements.alarm) return 0;
+
+  return 1;
+}
+
+static int
+probeBrailleDriver (const char *device, const char *code, BrailleProbeInstance **result) {
+  BrailleProbeInstance *instance;
+  int found = 0;
+
+  TimeValue start;
+  getMonotonicTime(&start);
+
+  if ((instance = malloc(sizeof(*instance)))) {
+    memset(instance, 0, sizeof(*instance));
+
+    /* the tables the driver makes are kept with it until it's activated */
+    setThreadCellTranslationTables(&instance->cellTranslationTables);
+
+    if ((instance->driver = loadBrailleDriver(code, &instance->object, opt_driversDirectory))) {
+      instance->parameters = getParameters(instance->driver->parameters,
+                                           instance->driver->definition.code,
+                                           brailleParameters);
+
+      if (instance->parameters) {
+        BrailleDisplay *display = &instance->display;
+
+        constructBrailleDisplay(display);
+
+        if (instance->driver->construct(display, instance->parameters, device)) {
+          found = 1;
         } else {
-          logMallocError();
+          destructBrailleDisplay(display);
+          deallocateStrings(instance->parameters);
         }
       }
 
-      deallocateStrings(brailleDriverParameters);
-      brailleDriverParameters = NULL;
+      if (!found) unloadDriverObject(&instance->object);
     }
 
-    unloadDriverObject(&brailleObject);
+    setThreadCellTranslationTables(NULL);
+
+    if (!found) {
+      free(instance);
+    } else if (isAdoptableBrailleProbeInstance(instance)) {
+      *result = instance;
+    } else {
+      destroyBrailleProbeInstance(instance);
+    }
   } else {
-    logMessage(LOG_ERR, "%s: %s", gettext("braille driver not loadable"), code);
+    logMallocError();
+  }
+
+  logMessage(LOG_INFO, "braille probe %s: %s -> %s (%ldms)",
+             (found? "succeeded": "failed"), code, device,
+             getMonotonicElapsed(&start));
+
+  return found;
+}
+
+static void
+probeBrailleDevices (BrailleProbeGroup *group) {
+  BrailleProbeData *probe = group->probe;
+  int oneDriver = brailleDrivers[0] && !brailleDrivers[1];
+  int autodetect = oneDriver && (strcmp(brailleDrivers[0], optionOperand_autodetect) == 0);
+  const char *const defaultDrivers[] = {getDefaultBrailleDriver(), NULL};
+  unsigned int index;
+
+  for (index=0; index<group->count; index+=1) {
+    const char *device = group->devices[index];
+    const char *const *driver;
+
+    if (!autodetect) {
+      driver = (const char *const *)brailleDrivers;
+    } else if (defaultDrivers[0]) {
+      driver = defaultDrivers;
+    } else {
+      driver = getAutodetectableBrailleDrivers(device);
+    }
+
+    while (*driver) {
+      if (!autodetect || haveBrailleDriver(*driver)) {
+        BrailleProbeDriverLock lock;
+        BrailleProbeInstance *instance = NULL;
+
+        if (!acquireBrailleProbeDriver(&lock, *driver, probe)) return;
+
+        if (probeBrailleDriver(device, *driver, &instance)) {
+          /* The result is set before the driver is released so that
+           * another device can't be probed with the driver which has
+           * just been found.
+           */
+          if (!setBrailleProbeResult(probe, device, *driver, instance)) {
+            if (instance) destroyBrailleProbeInstance(instance);
+          }
+
+          releaseBrailleProbeDriver(&lock);
+          return;
+        }
+
+        releaseBrailleProbeDriver(&lock);
+      }
+
+      driver += 1;
+    }
+  }
+}
+
+static void
+finishBrailleProbeGroup (BrailleProbeGroup *group) {
+  BrailleProbeData *probe = group->probe;
+
+  lockMutex(&brailleProbeMutex);
+  probe->running -= 1;
+  if (probe->event) notifyBrailleProbe(probe);
+  unlockMutex(&brailleProbeMutex);
+
+  deallocateBrailleProbeGroup(group);
+}
+
+THREAD_FUNCTION(runBrailleProbeThread) {
+  BrailleProbeGroup *group = argument;
+
+  probeBrailleDevices(group);
+  finishBrailleProbeGroup(group);
+  return NULL;
+}
+
+static BrailleProbeGroupIndex
+getBrailleProbeGroupIndex (const char *device) {
+  if (isUsbDeviceIdentifier(&device)) return BRL_PROBE_USB;
+  if (isSerialDeviceIdentifier(&device)) return BRL_PROBE_SERIAL;
+  if (isBluetoothDeviceIdentifier(&device)) return BRL_PROBE_BLUETOOTH;
+  return BRL_PROBE_OTHER;
+}
+
+static BrailleProbeGroup *
+getBrailleProbeGroup (BrailleProbeGroup **groups, BrailleProbeData *probe, const char *device) {
+  BrailleProbeGroup **group = &groups[getBrailleProbeGroupIndex(device)];
+
+  if (!*group) {
+    if (!(*group = malloc(sizeof(**group)))) {
+      logMallocError();
+      return NULL;
+    }
+
+    memset(*group, 0, sizeof(**group));
+    (*group)->probe = probe;
+
+    lockMutex(&brailleProbeMutex);
+    probe->references += 1;
+    unlockMutex(&brailleProbeMutex);
+  }
+
+  return *group;
+}
+
+static int
+addBrailleProbeDevice (BrailleProbeGroup *group, const char *device) {
+  char **devices = realloc(group->devices, ARRAY_SIZE(devices, group->count+1));
+
+  if (devices) {
+    group->devices = devices;
+
+    if ((devices[group->count] = strdup(device))) {
+      group->count += 1;
+      return 1;
+    }
+  }
+
+  logMallocError();
+  return 0;
+}
+
+static void
+startBrailleProbeGroup (BrailleProbeGroup **group, BrailleProbeData *probe, const char *name) {
+  pthread_t thread;
+
+  lockMutex(&brailleProbeMutex);
+  probe->running += 1;
+  unlockMutex(&brailleProbeMutex);
+
+  if (name) {
+    if (createThread(name, &thread, NULL, runBrailleProbeThread, *group) == 0) {
+      pthread_detach(thread);
+      *group = NULL;
+      return;
+    }
   }
 
+  probeBrailleDevices(*group);
+  finishBrailleProbeGroup(*group);
+  *group = NULL;
+}
+
+ASYNC_EVENT_CALLBACK(handleBrailleProbeEvent) {
+}
+
+static ASYNC_CONDITION_TESTER(testBrailleProbeFinished) {
+  BrailleProbeData *probe = data;
+  int finished;
+
+  lockMutex(&brailleProbeMutex);
+  finished = probe->foundDriver || !probe->running;
+  unlockMutex(&brailleProbeMutex);
+
+  return finished;
+}
+
+static int
+adoptBrailleProbeInstance (BrailleProbeInstance *instance) {
+  BrailleDisplay *display = &instance->display;
+
+  braille = instance->driver;
+  brailleObject = instance->object;
+  brailleDriverParameters = instance->parameters;
+
+  logMessage(LOG_DEBUG, "adopting probed braille driver: %s -> %s",
+             braille->definition.code, brailleDevice);
+
+  adoptCellTranslationTables(&instance->cellTranslationTables);
+  initializeBrailleDisplay();
+  display->bufferResized = brl.bufferResized;
+  display->api = brl.api;
+  brl = *display;
+  free(instance);
+
+  if (completeBrailleDriverConstruction()) {
+    brailleDriver = braille;
+    if (announceBrailleDriver()) return 1;
+  }
+
+  deallocateStrings(brailleDriverParameters);
+  brailleDriverParameters = NULL;
+
+  unloadDriverObject(&brailleObject);
   braille = &noBraille;
   return 0;
 }
 
+static int
+activateProbedBrailleDriver (BrailleProbeData *probe) {
+  const char *code;
+  BrailleProbeInstance *instance;
+  int activated = 0;
+
+  lockMutex(&brailleProbeMutex);
+  code = probe->foundDriver;
+  instance = probe->foundInstance;
+  probe->foundInstance = NULL;
+  unlockMutex(&brailleProbeMutex);
+
+  if (code) {
+    const char *const *device = (const char *const *)brailleDevices;
+
+    while (*device) {
+      if (strcmp(*device, probe->foundDevice) == 0) {
+        brailleDevice = *device;
+
+        if (instance) {
+          activated = adoptBrailleProbeInstance(instance);
+          instance = NULL;
+        } else {
+          /* the driver couldn't be handed over so it's constructed again */
+          logMessage(LOG_DEBUG, "activating probed braille driver: %s -> %s", code, brailleDevice);
+          activated = initializeBrailleDriver(code, 0);
+        }
+
+        if (!activated) brailleDevice = NULL;
+        break;
+      }
+
+      device += 1;
+    }
+  }
+
+  if (instance) destroyBrailleProbeInstance(instance);
+  return activated;
+}
+
+static int
+probeBrailleDevicesConcurrently (void) {
+  int activated = 0;
+  BrailleProbeData *probe;
+
+  if ((probe = malloc(sizeof(*probe)))) {
+    BrailleProbeGroup *groups[BRL_PROBE_GROUP_COUNT];
+    BrailleProbeGroupIndex index;
+
+    memset(probe, 0, sizeof(*probe));
+    probe->references = 1;
+
+    memset(groups, 0, sizeof(groups));
+
+    /* the probe threads use this to wake up the main thread */
+    if (!(probe->event = asyncNewEvent(handleBrailleProbeEvent, probe))) goto done;
+
+    {
+      const char *const *device = (const char *const *)brailleDevices;
+
+      while (*device) {
+        BrailleProbeGroup *group = getBrailleProbeGroup(groups, probe, *device);
+
+        if (!group) goto done;
+        if (!addBrailleProbeDevice(group, *device)) goto done;
+
+        device += 1;
+      }
+    }
+
+    {
+      static const char *const threadNames[] = {
+        [BRL_PROBE_SERIAL] = "braille-probe-serial",
+        [BRL_PROBE_BLUETOOTH] = "braille-probe-bluetooth",
+        [BRL_PROBE_OTHER] = "braille-probe-other"
+      };
+
+      /* Devices of the same type are probed one after another in order to
+       * not have the I/O layer for that type used concurrently. USB devices
+       * are probed on this thread because the USB layer's input monitors
+       * belong to the thread which opens the device, so a driver found on
+       * another thread couldn't be handed over with its device still open.
+       */
+      for (index=0; index<BRL_PROBE_GROUP_COUNT; index+=1) {
+        if (index == BRL_PROBE_USB) continue;
+        if (groups[index]) startBrailleProbeGroup(&groups[index], probe, threadNames[index]);
+      }
+
+      if (groups[BRL_PROBE_USB]) startBrailleProbeGroup(&groups[BRL_PROBE_USB], probe, NULL);
+    }
+
+    asyncWaitFor(testBrailleProbeFinished, probe);
+
+  done:
+    {
+      AsyncEvent *event;
+
+      /* The probe threads which are still running are left to finish on
+       * their own - they don't start any more drivers and they discard
+       * whatever they find.
+       */
+      lockMutex(&brailleProbeMutex);
+      probe->cancel = 1;
+      pthread_cond_broadcast(&brailleProbeCondition);
+
+      event = probe->event;
+      probe->event = NULL;
+      unlockMutex(&brailleProbeMutex);
+
+      if (event) asyncDiscardEvent(event);
+    }
+
+    activated = activateProbedBrailleDriver(probe);
+
+    for (index=0; index<BRL_PROBE_GROUP_COUNT; index+=1) {
+      if (groups[index]) deallocateBrailleProbeGroup(groups[index]);
+    }
+
+    releaseBrailleProbeData(probe);
+  } else {
+    logMallocError();
+  }
+
+  return activated;
+}
+#endif /* defined(GOT_PTHREADS) && defined(THREAD_LOCAL) */
+
 static int
 activateBrailleDriver (int verify) {
   int oneDevice = brailleDevices[0] && !brailleDevices[1];
@@ -1499,46 +2561,22 @@ activateBrailleDriver (int verify) {
 
   if (!oneDevice) verify = 0;
 
-  while (*device) {
-    const char *const *autodetectableDrivers;
+#if defined(GOT_PTHREADS) && defined(THREAD_LOCAL)
+  if (opt_concurrentProbing && brailleDevices[0] && brailleDevices[1]) {
+    logMessage(LOG_DEBUG, "probing braille devices concurrently");
+    return probeBrailleDevicesConcurrently();
+  }
+#endif /* defined(GOT_PTHREADS) && defined(THREAD_LOCAL) */
 
+  while (*device) {
     brailleDevice = *device;
     logMessage(LOG_DEBUG, "checking braille device: %s", brailleDevice);
 
-    {
-      const char *dev = brailleDevice;
-
-      if (isSerialDeviceIdentifier(&dev)) {
-        static const char *const serialDrivers[] = {
-          "md", "pm", "ts", "ht", "bn", "al", "bm", "pg", "sk",
-          NULL
-        };
-        autodetectableDrivers = serialDrivers;
-      } else if (isUsbDeviceIdentifier(&dev)) {
-        static const char *const usbDrivers[] = {
-          "al", "bm", "bn", "eu", "fs", "hd", "hm", "ht", "hw", "ic", "mt", "pg", "pm", "sk", "vo",
-          NULL
-        };
-        autodetectableDrivers = usbDrivers;
-      } else if (isBluetoothDeviceIdentifier(&dev)) {
-        if (!(autodetectableDrivers = bthGetDriverCodes(dev, BLUETOOTH_DEVICE_NAME_OBTAIN_TIMEOUT))) {
-          static const char *bluetoothDrivers[] = {
-            "np", "ht", "al", "bm",
-            NULL
-          };
-          autodetectableDrivers = bluetoothDrivers;
-        }
-      } else {
-        static const char *noDrivers[] = {NULL};
-        autodetectableDrivers = noDrivers;
-      }
-    }
-
     {
       const DriverActivationData data = {
         .driverType = "braille",
         .requestedDrivers = (const char *const *)brailleDrivers,
-        .autodetectableDrivers = autodetectableDrivers,
+        .autodetectableDrivers = getAutodetectableBrailleDrivers(brailleDevice),
         .getDefaultDriver = getDefaultBrailleDriver,
         .haveDriver = haveBrailleDriver,
         .initializeDriver = initializeBrailleDriver
@@ -2635,13 +3673,13 @@ brlttyStart (void) {
       changeStringSetting(&opt_textTable, "");
 
       if (name) {
-        if (replaceTextTable(opt_tablesDirectory, name)) {
+        if (changeTextTable(name)) {
           changeStringSetting(&opt_textTable, name);
         }
 
         free(name);
       }
-    } else if (!replaceTextTable(opt_tablesDirectory, opt_textTable)) {
+    } else if (!changeTextTable(opt_textTable)) {
       changeStringSetting(&opt_textTable, "");
     }
   }
@@ -2655,7 +3693,7 @@ brlttyStart (void) {
 
   /* handle attributes table option */
   if (*opt_attributesTable) {
-    if (!replaceAttributesTable(opt_tablesDirectory, opt_attributesTable)) {
+    if (!changeAttributesTable(opt_attributesTable)) {
       changeStringSetting(&opt_attributesTable, "");
     }
   }
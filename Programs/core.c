@@ -59,6 +59,7 @@
 #include "routing.h"
 #include "charset.h"
 #include "scr.h"
+#include "scr_utils.h"
 #include "update.h"
 #include "ses.h"
 #include "brl.h"
@@ -684,35 +685,95 @@ moveBrailleWindowRight (unsigned int amount) {
   return 1;
 }
 
-int
-shiftBrailleWindowLeft (unsigned int amount) {
 #ifdef ENABLE_CONTRACTED_BRAILLE
-  if (isContracting()) {
-    int reference = ses->winx;
-    int first = 0;
-    int last = ses->winx - 1;
+static int
+findContractedShiftStart (unsigned int amount) {
+  int reference = ses->winx;
+  int first = 0;
+  int last = ses->winx - 1;
 
-    while (first <= last) {
-      int end = (ses->winx = (first + last) / 2) + getContractedLength(amount);
+  while (first <= last) {
+    int end = (ses->winx = (first + last) / 2) + getContractedLength(amount);
 
-      if (end < reference) {
-        first = ses->winx + 1;
-      } else {
-        last = ses->winx - 1;
-      }
+    if (end < reference) {
+      first = ses->winx + 1;
+    } else {
+      last = ses->winx - 1;
     }
+  }
 
-    if (first > 0) {
-      ScreenCharacter characters[reference];
-      readScreenRow(ses->winy, reference, characters);
+  ses->winx = reference;
 
-      if (!isWordBreak(characters, ses->winy, first-1)) {
-        while (!isWordBreak(characters, ses->winy, first)) first += 1;
-      }
+  if (first > 0) {
+    ScreenCharacter characters[reference];
+    readScreenRow(ses->winy, reference, characters);
 
-      while (isWordBreak(characters, ses->winy, first)) first += 1;
+    if (!isWordBreak(characters, ses->winy, first-1)) {
+      while (!isWordBreak(characters, ses->winy, first)) first += 1;
     }
 
+    while (isWordBreak(characters, ses->winy, first)) first += 1;
+  }
+
+  return first;
+}
+
+typedef struct {
+  ContractionTable *table;
+  ScreenRowHash hash;
+  int screen;
+  int column;
+  int row;
+  int cursorColumn;
+  int cursorRow;
+  unsigned int amount;
+  unsigned char hideCursor;
+  unsigned char expandCurrentWord;
+  unsigned char capitalizationMode;
+} ContractedShiftKey;
+
+static ContractedShiftKey contractedShiftKey;
+static int contractedShiftStart = -1;
+
+static int
+getContractedShiftStart (unsigned int amount) {
+  ContractedShiftKey key;
+
+  memset(&key, 0, sizeof(key));
+  key.table = contractionTable;
+  key.screen = scr.number;
+  key.column = ses->winx;
+  key.row = ses->winy;
+  key.cursorColumn = scr.posx;
+  key.cursorRow = scr.posy;
+  key.amount = amount;
+  key.hideCursor = ses->hideScreenCursor;
+  key.expandCurrentWord = prefs.expandCurrentWord;
+  key.capitalizationMode = prefs.capitalizationMode;
+
+  {
+    ScreenCharacter characters[scr.cols];
+
+    readScreenRow(ses->winy, scr.cols, characters);
+    key.hash = hashScreenCharacters(characters, scr.cols);
+  }
+
+  if ((contractedShiftStart < 0) || (memcmp(&key, &contractedShiftKey, sizeof(key)) != 0)) {
+    contractedShiftStart = findContractedShiftStart(amount);
+    contractedShiftKey = key;
+  }
+
+  return contractedShiftStart;
+}
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+
+int
+shiftBrailleWindowLeft (unsigned int amount) {
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  if (isContracting()) {
+    int reference = ses->winx;
+    int first = getContractedShiftStart(amount);
+
     if (first == reference) {
       if (!first) return 0;
       first -= 1;
@@ -1056,6 +1117,114 @@ getContractedLength (unsigned int outputLimit) {
                NULL, getContractedCursor());
   return inputLength;
 }
+
+static void
+contractWindowAt (int column, int row) {
+  int oldColumn = ses->winx;
+  int oldRow = ses->winy;
+
+  ses->winx = column;
+  ses->winy = row;
+
+  {
+    int inputLength = scr.cols - column;
+    wchar_t inputBuffer[inputLength];
+    int offsets[inputLength];
+
+    int outputLength = textCount * brl.textRows;
+    unsigned char outputBuffer[outputLength];
+
+    readScreenText(column, row, inputLength, 1, inputBuffer);
+    contractText(contractionTable,
+                 inputBuffer, &inputLength,
+                 outputBuffer, &outputLength,
+                 offsets, getContractedCursor());
+  }
+
+  ses->winx = oldColumn;
+  ses->winy = oldRow;
+}
+
+static AsyncHandle contractionSpeculationAlarm = NULL;
+
+typedef struct {
+  ContractionTable *table;
+  ScreenRowHash content;
+  int screen;
+  int column;
+  int row;
+  int cursorColumn;
+  int cursorRow;
+} ContractionSpeculationKey;
+
+static ContractionSpeculationKey contractionSpeculationKey;
+static ContractionSpeculationKey pendingSpeculationKey;
+static int haveContractionSpeculationKey = 0;
+
+ASYNC_ALARM_CALLBACK(handleContractionSpeculationAlarm) {
+  asyncDiscardHandle(contractionSpeculationAlarm);
+  contractionSpeculationAlarm = NULL;
+
+  if (isContracting() && canBraille()) {
+    int column = ses->winx;
+    int row = ses->winy;
+
+    contractionSpeculationKey = pendingSpeculationKey;
+    haveContractionSpeculationKey = 1;
+
+    if (column > 0) {
+      int first = getContractedShiftStart(fullWindowShift);
+
+      if (first == column) first -= 1;
+      contractWindowAt(first, row);
+    }
+
+    {
+      int next = column + getContractedLength(fullWindowShift);
+
+      if ((next > column) && (next < scr.cols)) {
+        contractWindowAt(next, row);
+      } else if ((row + 1) < scr.rows) {
+        contractWindowAt(0, (row + 1));
+      }
+    }
+
+    if ((row + 1) < scr.rows) contractWindowAt(column, (row + 1));
+
+    /* leave the current window as the most recently cached translation */
+    contractWindowAt(column, row);
+  }
+}
+
+void
+scheduleContractionSpeculation (const ScreenCharacter *characters, unsigned int count) {
+  ContractionSpeculationKey key;
+
+  memset(&key, 0, sizeof(key));
+  key.table = contractionTable;
+  key.content = hashScreenCharacters(characters, count);
+  key.screen = scr.number;
+  key.column = ses->winx;
+  key.row = ses->winy;
+  key.cursorColumn = scr.posx;
+  key.cursorRow = scr.posy;
+
+  /* The translations are keyed by their text so changed content can't give
+   * stale cells, but it does need to be speculated on again.
+   */
+  if (haveContractionSpeculationKey) {
+    if (memcmp(&key, &contractionSpeculationKey, sizeof(key)) == 0) return;
+  }
+
+  pendingSpeculationKey = key;
+
+  if (contractionSpeculationAlarm) {
+    asyncResetAlarmIn(contractionSpeculationAlarm, CONTRACTION_SPECULATION_DELAY);
+  } else {
+    asyncNewRelativeAlarm(&contractionSpeculationAlarm, CONTRACTION_SPECULATION_DELAY,
+                          handleContractionSpeculationAlarm, NULL);
+  }
+}
 #endif /* ENABLE_CONTRACTED_BRAILLE */
 
 int
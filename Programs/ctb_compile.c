@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
  
 #include "log.h"
 #include "parse.h"
@@ -536,17 +537,26 @@ initializeCommonFields (ContractionTable *table) {
   table->characters.size = 0;
   table->characters.count = 0;
 
-  table->cache.input.characters = NULL;
-  table->cache.input.size = 0;
-  table->cache.input.count = 0;
+  {
+    ContractionCache *cache = table->cache;
+    const ContractionCache *end = cache + ARRAY_COUNT(table->cache);
+
+    while (cache < end) {
+      cache->input.characters = NULL;
+      cache->input.size = 0;
+      cache->input.count = 0;
+
+      cache->output.cells = NULL;
+      cache->output.size = 0;
+      cache->output.count = 0;
 
-  table->cache.output.cells = NULL;
-  table->cache.output.size = 0;
-  table->cache.output.count = 0;
+      cache->offsets.array = NULL;
+      cache->offsets.size = 0;
+      cache->offsets.count = 0;
 
-  table->cache.offsets.array = NULL;
-  table->cache.offsets.size = 0;
-  table->cache.offsets.count = 0;
+      cache += 1;
+    }
+  }
 }
 
 static void
@@ -556,19 +566,28 @@ destroyCommonFields (ContractionTable *table) {
     table->characters.array = NULL;
   }
 
-  if (table->cache.input.characters) {
-    free(table->cache.input.characters);
-    table->cache.input.characters = NULL;
-  }
+  {
+    ContractionCache *cache = table->cache;
+    const ContractionCache *end = cache + ARRAY_COUNT(table->cache);
 
-  if (table->cache.output.cells) {
-    free(table->cache.output.cells);
-    table->cache.output.cells = NULL;
-  }
+    while (cache < end) {
+      if (cache->input.characters) {
+        free(cache->input.characters);
+        cache->input.characters = NULL;
+      }
 
-  if (table->cache.offsets.array) {
-    free(table->cache.offsets.array);
-    table->cache.offsets.array = NULL;
+      if (cache->output.cells) {
+        free(cache->output.cells);
+        cache->output.cells = NULL;
+      }
+
+      if (cache->offsets.array) {
+        free(cache->offsets.array);
+        cache->offsets.array = NULL;
+      }
+
+      cache += 1;
+    }
   }
 }
 
@@ -609,6 +628,13 @@ compileContractionTable_native (const char *fileName) {
     }
 
     if ((ctd.area = newDataArea())) {
+      {
+        struct stat info;
+
+        /* a compiled table is usually about twice the size of its source */
+        if (stat(fileName, &info) != -1) reserveDataArea(ctd.area, info.st_size * 2);
+      }
+
       if (allocateDataItem(ctd.area, NULL, sizeof(ContractionTableHeader), __alignof__(ContractionTableHeader))) {
         if (allocateCharacterClasses(&ctd)) {
           const DataFileParameters parameters = {
@@ -623,6 +649,7 @@ compileContractionTable_native (const char *fileName) {
                 table->translationMethods = getContractionTableTranslationMethods_native();
                 initializeCommonFields(table);
 
+                trimDataArea(ctd.area);
                 table->data.internal.header.fields = getContractionTableHeader(&ctd);
                 table->data.internal.size = getDataSize(ctd.area);
                 resetDataArea(ctd.area);
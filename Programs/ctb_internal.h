@@ -129,6 +129,34 @@ extern GetContractionTableTranslationMethodsFunction getContractionTableTranslat
 extern GetContractionTableTranslationMethodsFunction getContractionTableTranslationMethods_external;
 extern GetContractionTableTranslationMethodsFunction getContractionTableTranslationMethods_louis;
 
+typedef struct {
+  struct {
+    wchar_t *characters;
+    unsigned int size;
+    unsigned int count;
+    unsigned int consumed;
+  } input;
+
+  struct {
+    unsigned char *cells;
+    unsigned int size;
+    unsigned int count;
+    unsigned int maximum;
+  } output;
+
+  struct {
+    int *array;
+    unsigned int size;
+    unsigned int count;
+  } offsets;
+
+  int cursorOffset;
+  unsigned char expandCurrentWord;
+  unsigned char capitalizationMode;
+} ContractionCache;
+
+#define CONTRACTION_CACHE_SIZE 8
+
 struct ContractionTableStruct {
   const ContractionTableManagementMethods *managementMethods;
   const ContractionTableTranslationMethods *translationMethods;
@@ -139,31 +167,7 @@ struct ContractionTableStruct {
     int count;
   } characters;
 
-  struct {
-    struct {
-      wchar_t *characters;
-      unsigned int size;
-      unsigned int count;
-      unsigned int consumed;
-    } input;
-
-    struct {
-      unsigned char *cells;
-      unsigned int size;
-      unsigned int count;
-      unsigned int maximum;
-    } output;
-
-    struct {
-      int *array;
-      unsigned int size;
-      unsigned int count;
-    } offsets;
-
-    int cursorOffset;
-    unsigned char expandCurrentWord;
-    unsigned char capitalizationMode;
-  } cache;
+  ContractionCache cache[CONTRACTION_CACHE_SIZE];
 
   union {
     struct {
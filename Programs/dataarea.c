@@ -49,25 +49,63 @@ destroyDataArea (DataArea *area) {
   free(area);
 }
 
+static int
+resizeDataArea (DataArea *area, size_t size) {
+  unsigned char *newAddress;
+
+  if (!(newAddress = realloc(area->address, size))) {
+    logMallocError();
+    return 0;
+  }
+
+  area->address = newAddress;
+  area->size = size;
+  return 1;
+}
+
+int
+reserveDataArea (DataArea *area, size_t size) {
+  size_t newSize = area->used + size;
+
+  if (newSize > area->size) {
+    if (!resizeDataArea(area, (newSize | 0XFFF) + 1)) return 0;
+  }
+
+  return 1;
+}
+
+void
+trimDataArea (DataArea *area) {
+  if (area->used < area->size) {
+    if (area->used) {
+      unsigned char *newAddress;
+
+      /* not being able to shrink it isn't a problem */
+      if ((newAddress = realloc(area->address, area->used))) {
+        area->address = newAddress;
+        area->size = area->used;
+      }
+    }
+  }
+}
+
 int
 allocateDataItem (DataArea *area, DataOffset *offset, size_t size, size_t alignment) {
   size_t newOffset = (area->used + (alignment - 1)) / alignment * alignment;
   size_t newUsed = newOffset + size;
 
   if (newUsed > area->size) {
-    size_t newSize = (newUsed | 0XFFF) + 1;
-    unsigned char *newAddress;
-
-    if (!(newAddress = realloc(area->address, newSize))) {
-      logMallocError();
-      return 0;
-    }
+    /* grow geometrically so that building a large table doesn't copy it
+     * over and over again */
+    size_t newSize = area->size << 1;
 
-    memset(newAddress+area->size, 0, (newSize - area->size));
-    area->address = newAddress;
-    area->size = newSize;
+    if (newSize < newUsed) newSize = newUsed;
+    if (!resizeDataArea(area, (newSize | 0XFFF) + 1)) return 0;
   }
 
+  /* only clear what's being handed out so that untouched space doesn't need
+   * to become resident */
+  memset(area->address+area->used, 0, (newUsed - area->used));
   area->used = newUsed;
   if (offset) *offset = newOffset;
   return 1;
@@ -184,20 +184,52 @@ isNumber (int *number, const wchar_t *characters, int length) {
   return 0;
 }
 
-static VariableNestingLevel *baseDataVariables = NULL;
-static VariableNestingLevel *currentDataVariables = NULL;
+#ifndef THREAD_LOCAL
+#define THREAD_LOCAL
+#endif /* THREAD_LOCAL */
 
-static VariableNestingLevel *
-getBaseDataVariables (void) {
+/* Each thread has its own variables, including its own copy of the global
+ * ones, so that a table can be compiled on a background thread while the
+ * main thread is processing some other file.
+ */
+static THREAD_LOCAL VariableNestingLevel *baseDataVariables = NULL;
+static THREAD_LOCAL VariableNestingLevel *currentDataVariables = NULL;
+
+static THREAD_LOCAL DataFileOpenedHandler *dataFileOpenedHandler = NULL;
+static THREAD_LOCAL void *dataFileOpenedData = NULL;
+
+void
+setDataFileOpenedHandler (DataFileOpenedHandler *handler, void *data) {
+  dataFileOpenedHandler = handler;
+  dataFileOpenedData = data;
+}
+
+void
+releaseDataVariables (void) {
   if (baseDataVariables) {
     releaseVariableNestingLevel(currentDataVariables);
-    deleteVariables(baseDataVariables);
-  } else {
-    VariableNestingLevel *globalVariables = getGlobalVariables(1);
+    currentDataVariables = NULL;
+
+    releaseVariableNestingLevel(baseDataVariables);
+    baseDataVariables = NULL;
+  }
+}
+
+static VariableNestingLevel *
+getBaseDataVariables (void) {
+  /* start again from a fresh copy of the global variables */
+  releaseDataVariables();
+
+  {
+    VariableNestingLevel *globalVariables = copyGlobalVariables();
     if (!globalVariables) return NULL;
 
     VariableNestingLevel *baseVariables = newVariableNestingLevel(globalVariables, "base");
-    if (!baseVariables) return NULL;
+
+    if (!baseVariables) {
+      releaseVariableNestingLevel(claimVariableNestingLevel(globalVariables));
+      return NULL;
+    }
 
     baseDataVariables = claimVariableNestingLevel(baseVariables);
   }
@@ -1179,6 +1211,10 @@ openIncludedDataFile (DataFile *includer, const char *path, const char *mode, in
   }
 
 done:
+  if (file && dataFileOpenedHandler) {
+    dataFileOpenedHandler(overridePath? overridePath: path, dataFileOpenedData);
+  }
+
   if (overridePath) free(overridePath);
   return file;
 }
@@ -22,6 +22,7 @@
 #include <errno.h>
 
 #include "log.h"
+#include "queue.h"
 #include "async_wait.h"
 #include "async_alarm.h"
 #include "io_generic.h"
@@ -36,6 +37,14 @@ const GioClass *const gioClasses[] = {
   NULL
 };
 
+/* Only programs which link the replay class in (e.g. brltest) set this. */
+static const GioClass *gioReplayClassAddress = NULL;
+
+void
+gioSetReplayClass (const GioClass *class) {
+  gioReplayClassAddress = class;
+}
+
 static void
 gioInitializeOptions (GioOptions *options) {
   options->applicationData = NULL;
@@ -92,6 +101,29 @@ gioStartEndpoint (GioEndpoint *endpoint) {
   return 1;
 }
 
+static int
+gioTestClass (
+  const GioClass *class,
+  const char **identifier,
+  const GioDescriptor *descriptor
+) {
+  if (class->isSupported) {
+    if (class->isSupported(descriptor)) {
+      if (class->testIdentifier) {
+        if (class->testIdentifier(identifier)) {
+          return 1;
+        }
+      } else {
+        logUnsupportedOperation("testIdentifier");
+      }
+    }
+  } else {
+    logUnsupportedOperation("isSupported");
+  }
+
+  return 0;
+}
+
 static const GioClass *
 gioGetClass (
   const char **identifier,
@@ -100,23 +132,16 @@ gioGetClass (
   const GioClass *const *class = gioClasses;
 
   while (*class) {
-    if ((*class)->isSupported) {
-      if ((*class)->isSupported(descriptor)) {
-        if ((*class)->testIdentifier) {
-          if ((*class)->testIdentifier(identifier)) {
-            return *class;
-          }
-        } else {
-          logUnsupportedOperation("testIdentifier");
-        }
-      }
-    } else {
-      logUnsupportedOperation("isSupported");
-    }
-
+    if (gioTestClass(*class, identifier, descriptor)) return *class;
     class += 1;
   }
 
+  if (gioReplayClassAddress) {
+    if (gioTestClass(gioReplayClassAddress, identifier, descriptor)) {
+      return gioReplayClassAddress;
+    }
+  }
+
   errno = ENOSYS;
   logMessage(LOG_WARNING, "unsupported generic resource identifier: %s", *identifier);
   return NULL;
@@ -140,6 +165,14 @@ gioConnectResource (
       endpoint->input.from = 0;
       endpoint->input.to = 0;
 
+      endpoint->output.frames = NULL;
+      endpoint->output.alarm = NULL;
+      endpoint->output.bytesPerSecond = 0;
+      endpoint->output.error = 0;
+      endpoint->output.maximumDepth = 0;
+      endpoint->output.enqueued = 0;
+      endpoint->output.dropped = 0;
+
       endpoint->hidReportItems.address = NULL;
       endpoint->hidReportItems.size = 0;
 
@@ -158,6 +191,21 @@ gioConnectResource (
       if (class->connectResource) {
         if ((endpoint->handle = class->connectResource(identifier, descriptor))) {
           if (!class->prepareEndpoint || class->prepareEndpoint(endpoint)) {
+            if (endpoint->resourceType == GIO_RESOURCE_BLUETOOTH) {
+              /* An RFCOMM link reports no speed but the display behind it
+               * usually takes data at the rate of its serial interface.
+               */
+              SerialParameters parameters;
+
+              if (descriptor->serial.parameters) {
+                parameters = *descriptor->serial.parameters;
+              } else {
+                gioInitializeSerialParameters(&parameters);
+              }
+
+              endpoint->output.bytesPerSecond = parameters.baud / serialGetCharacterSize(&parameters);
+            }
+
             if (gioStartEndpoint(endpoint)) {
               return endpoint;
             }
@@ -184,11 +232,68 @@ gioConnectResource (
   return NULL;
 }
 
+static ssize_t gioWriteNow (GioEndpoint *endpoint, const void *data, size_t size);
+
+typedef struct {
+  int type;
+  size_t size;
+  unsigned char bytes[0];
+} GioOutputFrame;
+
+static void
+gioDeallocateOutputFrame (void *item, void *data) {
+  GioOutputFrame *frame = item;
+
+  free(frame);
+}
+
+static void
+gioStopOutput (GioEndpoint *endpoint) {
+  if (endpoint->output.alarm) {
+    asyncCancelRequest(endpoint->output.alarm);
+    endpoint->output.alarm = NULL;
+  }
+
+  if (endpoint->output.frames) {
+    unsigned int count = 0;
+    GioOutputFrame *frame;
+
+    /* Ordered frames may be requests or acknowledgements that the device
+     * still needs to see. Superseding frames are only the latest version of
+     * something (e.g. the display content) so they can be left unsent.
+     */
+    while ((frame = dequeueItem(endpoint->output.frames))) {
+      if (frame->type == GIO_FRAME_ORDERED) {
+        if (!endpoint->output.error) {
+          if (gioWriteNow(endpoint, frame->bytes, frame->size) == -1) {
+            endpoint->output.error = errno;
+            logSystemError("output frame flush");
+          }
+        }
+      } else {
+        count += 1;
+      }
+
+      gioDeallocateOutputFrame(frame, NULL);
+    }
+
+    if (count) logMessage(LOG_DEBUG, "unsent output frames: %u", count);
+    deallocateQueue(endpoint->output.frames);
+    endpoint->output.frames = NULL;
+  }
+
+  if (endpoint->output.dropped) {
+    logMessage(LOG_DEBUG, "superseded output frames: %lu", endpoint->output.dropped);
+  }
+}
+
 int
 gioDisconnectResource (GioEndpoint *endpoint) {
   int ok = 0;
   GioDisconnectResourceMethod *method = endpoint->methods->disconnectResource;
 
+  gioStopOutput(endpoint);
+
   if (!method) {
     logUnsupportedOperation("disconnectResource");
   } else if (method(endpoint->handle)) {
@@ -219,8 +324,8 @@ gioGetResourceName (GioEndpoint *endpoint) {
   return name;
 }
 
-ssize_t
-gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
+static ssize_t
+gioWriteNow (GioEndpoint *endpoint, const void *data, size_t size) {
   GioWriteDataMethod *method = endpoint->methods->writeData;
 
   if (!method) {
@@ -244,6 +349,140 @@ gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
   return result;
 }
 
+static void gioHoldOutput (GioEndpoint *endpoint, size_t size);
+
+ASYNC_ALARM_CALLBACK(gioHandleOutputAlarm) {
+  GioEndpoint *endpoint = parameters->data;
+  GioOutputFrame *frame = endpoint->output.frames? dequeueItem(endpoint->output.frames): NULL;
+
+  asyncDiscardHandle(endpoint->output.alarm);
+  endpoint->output.alarm = NULL;
+
+  if (frame) {
+    logBytes(LOG_CATEGORY(OUTPUT_PACKETS), "dequeued", frame->bytes, frame->size);
+
+    if (gioWriteNow(endpoint, frame->bytes, frame->size) != -1) {
+      gioHoldOutput(endpoint, frame->size);
+    } else {
+      endpoint->output.error = errno;
+      logSystemError("output frame write");
+    }
+
+    gioDeallocateOutputFrame(frame, NULL);
+  }
+}
+
+static void
+gioHoldOutput (GioEndpoint *endpoint, size_t size) {
+  unsigned int milliseconds = gioGetMillisecondsToTransfer(endpoint, size);
+
+  if (!milliseconds) {
+    unsigned int bytesPerSecond = endpoint->output.bytesPerSecond;
+
+    if (bytesPerSecond) milliseconds = ((size * 1000) / bytesPerSecond) + 1;
+  }
+
+  if (milliseconds) {
+    asyncNewRelativeAlarm(&endpoint->output.alarm, milliseconds,
+                          gioHandleOutputAlarm, endpoint);
+  }
+}
+
+static int
+gioFindSupersededFrame (const void *item, void *data) {
+  const GioOutputFrame *old = item;
+  const GioOutputFrame *new = data;
+
+  return old->type == new->type;
+}
+
+static ssize_t
+gioEnqueueFrame (GioEndpoint *endpoint, int type, const void *data, size_t size) {
+  GioOutputFrame *frame;
+
+  if (!endpoint->output.frames) {
+    if (!(endpoint->output.frames = newQueue(gioDeallocateOutputFrame, NULL))) {
+      return -1;
+    }
+  }
+
+  if ((frame = malloc(sizeof(*frame) + size))) {
+    frame->type = type;
+    frame->size = size;
+    memcpy(frame->bytes, data, size);
+
+    if (type != GIO_FRAME_ORDERED) {
+      Element *element = findElement(endpoint->output.frames, gioFindSupersededFrame, frame);
+
+      if (element) {
+        GioOutputFrame *old = getElementItem(element);
+
+        logBytes(LOG_CATEGORY(OUTPUT_PACKETS), "superseded", old->bytes, old->size);
+        deleteElement(element);
+        endpoint->output.dropped += 1;
+      }
+    }
+
+    if (enqueueItem(endpoint->output.frames, frame)) {
+      unsigned int depth = getQueueSize(endpoint->output.frames);
+
+      if (depth > endpoint->output.maximumDepth) endpoint->output.maximumDepth = depth;
+      endpoint->output.enqueued += 1;
+
+      logBytes(LOG_CATEGORY(OUTPUT_PACKETS), "enqueued", frame->bytes, frame->size);
+      return size;
+    }
+
+    gioDeallocateOutputFrame(frame, NULL);
+  } else {
+    logMallocError();
+  }
+
+  return -1;
+}
+
+static int
+gioTestOutputError (GioEndpoint *endpoint) {
+  if (!endpoint->output.error) return 0;
+
+  errno = endpoint->output.error;
+  endpoint->output.error = 0;
+  return 1;
+}
+
+ssize_t
+gioWriteFrame (GioEndpoint *endpoint, int type, const void *data, size_t size) {
+  if (gioTestOutputError(endpoint)) return -1;
+  if (endpoint->output.alarm) return gioEnqueueFrame(endpoint, type, data, size);
+
+  {
+    ssize_t result = gioWriteNow(endpoint, data, size);
+
+    if (result != -1) gioHoldOutput(endpoint, size);
+    return result;
+  }
+}
+
+ssize_t
+gioWriteData (GioEndpoint *endpoint, const void *data, size_t size) {
+  if (gioTestOutputError(endpoint)) return -1;
+
+  /* it mustn't overtake the frames which are still waiting to be written */
+  if (endpoint->output.frames && getQueueSize(endpoint->output.frames)) {
+    return gioEnqueueFrame(endpoint, GIO_FRAME_ORDERED, data, size);
+  }
+
+  return gioWriteNow(endpoint, data, size);
+}
+
+void
+gioGetOutputStatistics (GioEndpoint *endpoint, GioOutputStatistics *statistics) {
+  statistics->queueDepth = endpoint->output.frames? getQueueSize(endpoint->output.frames): 0;
+  statistics->maximumQueueDepth = endpoint->output.maximumDepth;
+  statistics->enqueuedFrames = endpoint->output.enqueued;
+  statistics->supersededFrames = endpoint->output.dropped;
+}
+
 int
 gioAwaitInput (GioEndpoint *endpoint, int timeout) {
   GioAwaitInputMethod *method = endpoint->methods->awaitInput;
@@ -326,11 +565,59 @@ gioReadByte (GioEndpoint *endpoint, unsigned char *byte, int wait) {
   return 0;
 }
 
+ssize_t
+gioPeekInput (GioEndpoint *endpoint, const unsigned char **bytes, int wait) {
+  GioReadDataMethod *method = endpoint->methods->readData;
+
+  if (!method) {
+    logUnsupportedOperation("readData");
+    return -1;
+  }
+
+  if (endpoint->input.to == endpoint->input.from) {
+    endpoint->input.from = endpoint->input.to = 0;
+
+    if (endpoint->input.error) {
+      errno = endpoint->input.error;
+      endpoint->input.error = 0;
+      return -1;
+    }
+
+    {
+      ssize_t result = method(endpoint->handle,
+                              endpoint->input.buffer, sizeof(endpoint->input.buffer),
+                              (wait? endpoint->options.inputTimeout: 0), 0);
+
+      if (result > 0) {
+        logBytes(LOG_CATEGORY(GENERIC_INPUT), NULL, endpoint->input.buffer, result);
+        endpoint->input.to = result;
+      } else {
+        if (!result) errno = EAGAIN;
+        if (errno == EAGAIN) return 0;
+        return -1;
+      }
+    }
+  }
+
+  *bytes = &endpoint->input.buffer[endpoint->input.from];
+  return endpoint->input.to - endpoint->input.from;
+}
+
+void
+gioConsumeInput (GioEndpoint *endpoint, size_t count) {
+  endpoint->input.from += MIN(count, endpoint->input.to - endpoint->input.from);
+}
+
 int
 gioDiscardInput (GioEndpoint *endpoint) {
-  unsigned char byte;
-  while (gioReadByte(endpoint, &byte, 0));
-  return errno == EAGAIN;
+  const unsigned char *bytes;
+  ssize_t count;
+
+  while ((count = gioPeekInput(endpoint, &bytes, 0)) > 0) {
+    gioConsumeInput(endpoint, count);
+  }
+
+  return !count;
 }
 
 int
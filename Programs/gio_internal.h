@@ -19,6 +19,8 @@
 #ifndef BRLTTY_INCLUDED_GIO_INTERNAL
 #define BRLTTY_INCLUDED_GIO_INTERNAL
 
+#include "queue.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -125,8 +127,18 @@ struct GioEndpointStruct {
     int error;
     unsigned int from;
     unsigned int to;
-    unsigned char buffer[0X40];
+    unsigned char buffer[0X100];
   } input;
+
+  struct {
+    Queue *frames;
+    AsyncHandle alarm;
+    unsigned int bytesPerSecond;
+    int error;
+    unsigned int maximumDepth;
+    unsigned long int enqueued;
+    unsigned long int dropped;
+  } output;
 };
 
 typedef int GioIsSupportedMethod (const GioDescriptor *descriptor);
@@ -162,8 +174,10 @@ extern const GioClass gioNullClass;
 extern const GioClass gioSerialClass;
 extern const GioClass gioUsbClass;
 extern const GioClass gioBluetoothClass;
+extern const GioClass gioReplayClass;
 
 extern void gioSetBytesPerSecond (GioEndpoint *endpoint, const SerialParameters *parameters);
+extern void gioSetReplayClass (const GioClass *class);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,568 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2018 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU Lesser General Public License, as published by the Free Software
+ * Foundation; either version 2.1 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-LGPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* A replay file is a transcript of the traffic between a driver and its
+ * device. Each line is a time stamp (in milliseconds), a direction ("<" for
+ * bytes from the device, ">" for bytes to the device), and the bytes
+ * themselves in hexadecimal. Blank lines and lines starting with "#" are
+ * ignored. Input which follows output in the transcript isn't made
+ * available until the driver has written as many times as it had when the
+ * input was originally received. The capture file (if requested) is written
+ * in the same format so that it can itself be replayed.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+#include "io_generic.h"
+#include "gio_internal.h"
+#include "parse.h"
+#include "device.h"
+#include "file.h"
+#include "timing.h"
+#include "async_wait.h"
+
+typedef struct {
+  unsigned char *bytes;
+  size_t count;
+
+  long int delay;
+  unsigned int writes;
+  TimeValue anchor;
+
+  unsigned long int offset;
+  TimeValue arrival;
+} ReplayChunk;
+
+struct GioHandleStruct {
+  ReplayChunk *chunks;
+  unsigned int chunkCount;
+  unsigned int chunkSize;
+
+  unsigned int chunkIndex;
+  size_t byteIndex;
+  unsigned int gateIndex;
+
+  FILE *output;
+  unsigned timing:1;
+
+  SerialParameters serialParameters;
+
+  TimeValue start;
+  GioReplayStatistics statistics;
+};
+
+static void
+deallocateReplayChunks (GioHandle *handle) {
+  while (handle->chunkCount) free(handle->chunks[--handle->chunkCount].bytes);
+  if (handle->chunks) free(handle->chunks);
+}
+
+static long int
+getReplayTime (GioHandle *handle) {
+  return getMonotonicElapsed(&handle->start);
+}
+
+static void
+captureReplayBytes (GioHandle *handle, char direction, const unsigned char *bytes, size_t count) {
+  if (handle->output) {
+    const unsigned char *end = bytes + count;
+
+    fprintf(handle->output, "%ld %c", getReplayTime(handle), direction);
+    while (bytes < end) fprintf(handle->output, " %02X", *bytes++);
+    fprintf(handle->output, "\n");
+  }
+}
+
+static void
+openReplayGates (GioHandle *handle) {
+  TimeValue now;
+
+  getMonotonicTime(&now);
+
+  while (handle->gateIndex < handle->chunkCount) {
+    ReplayChunk *chunk = &handle->chunks[handle->gateIndex];
+
+    if (chunk->writes > handle->statistics.outputWrites) break;
+    chunk->anchor = now;
+    handle->gateIndex += 1;
+  }
+
+  handle->statistics.inputFinished = handle->chunkIndex == handle->chunkCount;
+  handle->statistics.awaitingOutput = handle->chunkIndex == handle->gateIndex;
+  if (handle->statistics.inputFinished) handle->statistics.awaitingOutput = 0;
+}
+
+static long int
+getReplayDelay (GioHandle *handle) {
+  if (handle->chunkIndex == handle->gateIndex) return -1;
+
+  {
+    const ReplayChunk *chunk = &handle->chunks[handle->chunkIndex];
+    TimeValue due = chunk->anchor;
+
+    if (!handle->timing) return 0;
+    adjustTimeValue(&due, chunk->delay);
+
+    {
+      TimeValue now;
+      long int delay;
+
+      getMonotonicTime(&now);
+      delay = millisecondsBetween(&now, &due);
+      return MAX(delay, 0);
+    }
+  }
+}
+
+static int
+disconnectReplayResource (GioHandle *handle) {
+  if (handle->output) fclose(handle->output);
+  deallocateReplayChunks(handle);
+  free(handle);
+  return 1;
+}
+
+static char *
+getReplayResourceName (GioHandle *handle, int timeout) {
+  char *name = strdup("replay");
+
+  if (!name) logMallocError();
+  return name;
+}
+
+static ssize_t
+writeReplayData (GioHandle *handle, const void *data, size_t size, int timeout) {
+  captureReplayBytes(handle, '>', data, size);
+
+  handle->statistics.outputWrites += 1;
+  handle->statistics.outputBytes += size;
+
+  openReplayGates(handle);
+  return size;
+}
+
+static int
+awaitReplayInput (GioHandle *handle, int timeout) {
+  long int delay = getReplayDelay(handle);
+
+  if (delay == 0) return 1;
+
+  if ((delay > 0) && (delay <= timeout)) {
+    asyncWait(delay);
+    return 1;
+  }
+
+  if (timeout > 0) asyncWait(timeout);
+  errno = EAGAIN;
+  return 0;
+}
+
+static ssize_t
+readReplayData (
+  GioHandle *handle, void *buffer, size_t size,
+  int initialTimeout, int subsequentTimeout
+) {
+  unsigned char *next = buffer;
+  unsigned char *end = next + size;
+
+  if (!awaitReplayInput(handle, initialTimeout)) return 0;
+
+  while ((next < end) && (getReplayDelay(handle) == 0)) {
+    ReplayChunk *chunk = &handle->chunks[handle->chunkIndex];
+    size_t count = MIN(end-next, chunk->count-handle->byteIndex);
+
+    memcpy(next, &chunk->bytes[handle->byteIndex], count);
+    captureReplayBytes(handle, '<', next, count);
+    next += count;
+
+    handle->statistics.inputBytes += count;
+
+    if (!handle->byteIndex) {
+      if (handle->timing) {
+        chunk->arrival = chunk->anchor;
+        adjustTimeValue(&chunk->arrival, chunk->delay);
+      } else {
+        getMonotonicTime(&chunk->arrival);
+      }
+    }
+
+    if ((handle->byteIndex += count) == chunk->count) {
+      handle->byteIndex = 0;
+      handle->chunkIndex += 1;
+      handle->statistics.inputChunks += 1;
+      openReplayGates(handle);
+    }
+  }
+
+  return next - (unsigned char *)buffer;
+}
+
+static int
+reconfigureReplayResource (GioHandle *handle, const SerialParameters *parameters) {
+  handle->serialParameters = *parameters;
+  return 1;
+}
+
+static const GioMethods gioReplayMethods = {
+  .disconnectResource = disconnectReplayResource,
+
+  .getResourceName = getReplayResourceName,
+
+  .writeData = writeReplayData,
+  .awaitInput = awaitReplayInput,
+  .readData = readReplayData,
+
+  .reconfigureResource = reconfigureReplayResource
+};
+
+static int
+addReplayChunk (GioHandle *handle, const unsigned char *bytes, size_t count, long int delay, unsigned int writes) {
+  if (handle->chunkCount == handle->chunkSize) {
+    unsigned int newSize = handle->chunkSize? handle->chunkSize<<1: 0X40;
+    ReplayChunk *newChunks = realloc(handle->chunks, ARRAY_SIZE(newChunks, newSize));
+
+    if (!newChunks) {
+      logMallocError();
+      return 0;
+    }
+
+    handle->chunks = newChunks;
+    handle->chunkSize = newSize;
+  }
+
+  {
+    ReplayChunk *chunk = &handle->chunks[handle->chunkCount];
+
+    if (!(chunk->bytes = malloc(count))) {
+      logMallocError();
+      return 0;
+    }
+
+    memcpy(chunk->bytes, bytes, count);
+    chunk->count = count;
+    chunk->delay = delay;
+    chunk->writes = writes;
+
+    if (handle->chunkCount) {
+      const ReplayChunk *previous = chunk - 1;
+      chunk->offset = previous->offset + previous->count;
+    } else {
+      chunk->offset = 0;
+    }
+  }
+
+  handle->chunkCount += 1;
+  return 1;
+}
+
+static int
+loadReplayFile (GioHandle *handle, const char *path) {
+  int ok = 0;
+  FILE *file = openFile(path, "r", 0);
+
+  if (file) {
+    char *buffer = NULL;
+    size_t bufferSize = 0;
+    unsigned int lineNumber = 0;
+
+    long int anchor = 0;
+    int anchored = 0;
+    unsigned int writes = 0;
+
+    ok = 1;
+
+    while (readLine(file, &buffer, &bufferSize)) {
+      const char *character = buffer;
+      char *end;
+      long int time;
+      char direction;
+
+      size_t length = strlen(buffer);
+      unsigned char bytes[(length / 2) + 1];
+      size_t count = 0;
+
+      lineNumber += 1;
+      while (*character == ' ') character += 1;
+      if (!*character || (*character == '#')) continue;
+
+      time = strtol(character, &end, 10);
+      if (end == character) goto invalid;
+      character = end;
+
+      while (*character == ' ') character += 1;
+      direction = *character++;
+
+      while (*character) {
+        unsigned long int value;
+
+        while (*character == ' ') character += 1;
+        if (!*character) break;
+
+        value = strtoul(character, &end, 0X10);
+        if ((end == character) || (value > UINT8_MAX)) goto invalid;
+        character = end;
+
+        bytes[count++] = value;
+      }
+
+      if (!anchored) {
+        anchor = time;
+        anchored = 1;
+      }
+
+      switch (direction) {
+        case '<':
+          if (count) {
+            if (!addReplayChunk(handle, bytes, count, time-anchor, writes)) {
+              ok = 0;
+              goto done;
+            }
+          }
+          continue;
+
+        case '>':
+          writes += 1;
+          anchor = time;
+          continue;
+
+        default:
+          break;
+      }
+
+    invalid:
+      logMessage(LOG_ERR, "invalid replay line: %s[%u]: %s", path, lineNumber, buffer);
+      errno = EINVAL;
+      ok = 0;
+      break;
+    }
+
+  done:
+    if (buffer) free(buffer);
+    fclose(file);
+  }
+
+  return ok;
+}
+
+typedef enum {
+  REPLAY_PARM_FILE,
+  REPLAY_PARM_OUTPUT,
+  REPLAY_PARM_TIMING
+} ReplayParameter;
+
+static char **
+getReplayParameters (const char *identifier) {
+  static const char *const names[] = {
+    "file",
+    "output",
+    "timing",
+    NULL
+  };
+
+  return getDeviceParameters(names, identifier);
+}
+
+static int
+processReplayParameters (GioHandle *handle, char **parameters) {
+  {
+    const char *file = parameters[REPLAY_PARM_FILE];
+
+    if (!*file) {
+      logMessage(LOG_ERR, "replay file not specified");
+      errno = EINVAL;
+      return 0;
+    }
+
+    if (!loadReplayFile(handle, file)) return 0;
+  }
+
+  {
+    const char *timing = parameters[REPLAY_PARM_TIMING];
+
+    if (*timing) {
+      unsigned int flag;
+
+      if (!validateYesNo(&flag, timing)) {
+        logMessage(LOG_ERR, "invalid replay timing setting: %s", timing);
+        errno = EINVAL;
+        return 0;
+      }
+
+      handle->timing = flag;
+    }
+  }
+
+  {
+    const char *output = parameters[REPLAY_PARM_OUTPUT];
+
+    if (*output) {
+      if (!(handle->output = openFile(output, "w", 0))) return 0;
+    }
+  }
+
+  return 1;
+}
+
+static int
+isReplaySupported (const GioDescriptor *descriptor) {
+  return 1;
+}
+
+static int
+testReplayIdentifier (const char **identifier) {
+  return hasQualifier(identifier, "replay");
+}
+
+static const GioOptions *
+getReplayOptions (const GioDescriptor *descriptor) {
+  if (descriptor->serial.parameters) return &descriptor->serial.options;
+  if (descriptor->bluetooth.channelNumber || descriptor->bluetooth.discoverChannel) return &descriptor->bluetooth.options;
+  return &descriptor->null.options;
+}
+
+static const GioMethods *
+getReplayMethods (void) {
+  return &gioReplayMethods;
+}
+
+static GioHandle *
+connectReplayResource (
+  const char *identifier,
+  const GioDescriptor *descriptor
+) {
+  GioHandle *handle = malloc(sizeof(*handle));
+
+  if (handle) {
+    memset(handle, 0, sizeof(*handle));
+    handle->chunks = NULL;
+    handle->output = NULL;
+    handle->timing = 1;
+
+    if (descriptor->serial.parameters) {
+      handle->serialParameters = *descriptor->serial.parameters;
+    } else {
+      gioInitializeSerialParameters(&handle->serialParameters);
+    }
+
+    {
+      char **parameters = getReplayParameters(identifier);
+
+      if (parameters) {
+        int ok = processReplayParameters(handle, parameters);
+
+        deallocateStrings(parameters);
+
+        if (ok) {
+          getMonotonicTime(&handle->start);
+          openReplayGates(handle);
+
+          logMessage(LOG_DEBUG,
+                     "replaying %u input chunk(s) %s",
+                     handle->chunkCount,
+                     (handle->timing? "with original timing": "as fast as possible"));
+
+          return handle;
+        }
+      }
+    }
+
+    if (handle->output) fclose(handle->output);
+    deallocateReplayChunks(handle);
+    free(handle);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+static int
+prepareReplayEndpoint (GioEndpoint *endpoint) {
+  /* pace the output as if it were going over the original serial line */
+  gioSetBytesPerSecond(endpoint, &endpoint->handle->serialParameters);
+  return 1;
+}
+
+const GioClass gioReplayClass = {
+  .isSupported = isReplaySupported,
+  .testIdentifier = testReplayIdentifier,
+
+  .getOptions = getReplayOptions,
+  .getMethods = getReplayMethods,
+
+  .connectResource = connectReplayResource,
+  .prepareEndpoint = prepareReplayEndpoint,
+
+  .resourceType = GIO_RESOURCE_REPLAY
+};
+
+void
+gioEnableReplay (void) {
+  gioSetReplayClass(&gioReplayClass);
+}
+
+static const ReplayChunk *
+findReplayChunk (GioHandle *handle, unsigned long int offset) {
+  unsigned int first = 0;
+  unsigned int last = handle->chunkIndex;
+
+  if (last == handle->chunkCount) last -= 1;
+
+  while (first < last) {
+    unsigned int current = (first + last + 1) / 2;
+
+    if (handle->chunks[current].offset > offset) {
+      last = current - 1;
+    } else {
+      first = current;
+    }
+  }
+
+  return &handle->chunks[first];
+}
+
+int
+gioGetReplayStatistics (GioEndpoint *endpoint, GioReplayStatistics *statistics) {
+  if (!endpoint) return 0;
+  if (endpoint->methods != &gioReplayMethods) return 0;
+
+  {
+    GioHandle *handle = endpoint->handle;
+
+    *statistics = handle->statistics;
+
+    {
+      /* what has been read but is still buffered hasn't been taken yet */
+      unsigned long int taken = statistics->inputBytes;
+      taken -= endpoint->input.to - endpoint->input.from;
+
+      if (taken) {
+        statistics->inputTime = findReplayChunk(handle, taken-1)->arrival;
+      } else {
+        statistics->inputTime = handle->start;
+      }
+    }
+  }
+
+  return 1;
+}
@@ -909,37 +909,12 @@ ASYNC_INPUT_CALLBACK(handleKobjectUeventString) {
 
   return 0;
 }
-
-static int
-getKobjectUeventSocket (void) {
-  static int socketDescriptor = -1;
-
-  if (socketDescriptor == -1) {
-    const struct sockaddr_nl socketAddress = {
-      .nl_family = AF_NETLINK,
-      .nl_pid = getpid(),
-      .nl_groups = 0XFFFFFFFF
-    };
-
-    if ((socketDescriptor = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT)) != -1) {
-      if (bind(socketDescriptor, (const struct sockaddr *)&socketAddress, sizeof(socketAddress)) == -1) {
-        logSystemError("bind");
-        close(socketDescriptor);
-        socketDescriptor = -1;
-      }
-    } else {
-      logSystemError("socket");
-    }
-  }
-
-  return socketDescriptor;
-}
 #endif /* NETLINK_KOBJECT_UEVENT */
 
 static int
 monitorNewKeyboards (KeyboardMonitorObject *kmo) {
 #ifdef NETLINK_KOBJECT_UEVENT
-  if ((kmo->kmx->uevent.socket = getKobjectUeventSocket()) != -1) {
+  if ((kmo->kmx->uevent.socket = newKobjectUeventSocket()) != -1) {
     if (asyncReadSocket(&kmo->kmx->uevent.monitor,
                         kmo->kmx->uevent.socket, 6+1+PATH_MAX+1,
                         handleKobjectUeventString, kmo)) {
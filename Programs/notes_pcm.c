@@ -28,6 +28,15 @@
 
 char *opt_pcmDevice;
 
+/* The triangle waveform is precomputed, already encoded for the device's
+ * amplitude format and channel count, for this many phases per period.
+ */
+#define PCM_WAVE_TABLE_BITS 12
+#define PCM_WAVE_TABLE_SIZE (1 << PCM_WAVE_TABLE_BITS)
+
+/* Tones are faded in and out over (at most) this long to avoid clicks. */
+#define PCM_FADE_MILLISECONDS 2
+
 struct NoteDeviceStruct {
   PcmDevice *pcm;
 
@@ -40,45 +49,263 @@ struct NoteDeviceStruct {
   int blockUsed;
 
   PcmSampleMaker makeSample;
+  int frameSize;
+
+  NoteRendering *rendering;
+
+  struct {
+    int16_t *amplitudes;
+    unsigned char *frames;
+    unsigned char *silence;
+    unsigned char volume;
+    unsigned ready:1;
+  } wave;
+};
+
+struct NoteRenderingStruct {
+  int sampleRate;
+  int channelCount;
+  PcmAmplitudeFormat amplitudeFormat;
+  unsigned char volume;
+
+  size_t size;
+  size_t used;
+  unsigned char bytes[];
 };
 
+typedef struct {
+  uint32_t value;
+  uint32_t step;
+
+  int32_t fadeLevel;
+  int32_t fadeIncrement;
+  int32_t fadeLength;
+} PcmWaveState;
+
+typedef void PcmFrameGenerator (
+  NoteDevice *device, unsigned char *frames,
+  int32_t count, PcmWaveState *state
+);
+
+static inline void
+pcmCopyFrame (unsigned char *to, const unsigned char *from, int size) {
+  /* constant sizes let the compiler use a single load and store */
+  switch (size) {
+    case 1: memcpy(to, from, 1); break;
+    case 2: memcpy(to, from, 2); break;
+    case 4: memcpy(to, from, 4); break;
+    default: memcpy(to, from, size); break;
+  }
+}
+
+static void
+pcmEncodeFrame (NoteDevice *device, unsigned char *frame, int16_t amplitude) {
+  PcmSample sample;
+  PcmSampleSize size = device->makeSample(&sample, amplitude);
+
+  for (int channel=0; channel<device->channelCount; channel+=1) {
+    memcpy(frame, sample.bytes, size);
+    frame += size;
+  }
+}
+
+static int
+pcmCaptureBytes (NoteDevice *device) {
+  NoteRendering *rendering = device->rendering;
+  size_t needed = rendering->used + device->blockUsed;
+
+  if (needed > rendering->size) {
+    size_t size = MAX(needed, rendering->size * 2);
+
+    if (!(rendering = realloc(rendering, sizeof(*rendering) + size))) {
+      logMallocError();
+      return 0;
+    }
+
+    rendering->size = size;
+    device->rendering = rendering;
+  }
+
+  memcpy(&rendering->bytes[rendering->used], device->blockAddress, device->blockUsed);
+  rendering->used = needed;
+  return 1;
+}
+
 static int
 pcmFlushBytes (NoteDevice *device) {
-  int ok = writePcmData(device->pcm, device->blockAddress, device->blockUsed);
+  int ok = device->rendering?
+           pcmCaptureBytes(device):
+           writePcmData(device->pcm, device->blockAddress, device->blockUsed);
+
   if (ok) device->blockUsed = 0;
   return ok;
 }
 
 static int
-pcmWriteSample (NoteDevice *device, int16_t amplitude) {
-  PcmSample *sample = (PcmSample *)&device->blockAddress[device->blockUsed];
-  PcmSampleSize size = device->makeSample(sample, amplitude);
-  device->blockUsed += size;
-
-  for (int channel=1; channel<device->channelCount; channel+=1) {
-    for (int byte=0; byte<size; byte+=1) {
-      device->blockAddress[device->blockUsed++] = sample->bytes[byte];
+pcmWriteFrames (
+  NoteDevice *device, int32_t count,
+  PcmFrameGenerator *generate, PcmWaveState *state
+) {
+  while (count > 0) {
+    int32_t available = (device->blockSize - device->blockUsed) / device->frameSize;
+    int32_t chunk = MIN(count, available);
+
+    generate(device, &device->blockAddress[device->blockUsed], chunk, state);
+    device->blockUsed += chunk * device->frameSize;
+    count -= chunk;
+
+    if (device->blockUsed == device->blockSize) {
+      if (!pcmFlushBytes(device)) {
+        return 0;
+      }
     }
   }
 
-  if (device->blockUsed == device->blockSize) {
-    if (!pcmFlushBytes(device)) {
-      return 0;
-    }
+  return 1;
+}
+
+static void
+pcmGenerateSilence (
+  NoteDevice *device, unsigned char *frames,
+  int32_t count, PcmWaveState *state
+) {
+  const int size = device->frameSize;
+
+  while (count > 0) {
+    pcmCopyFrame(frames, device->wave.silence, size);
+    frames += size;
+    count -= 1;
   }
+}
 
-  return 1;
+static void
+pcmGenerateWave (
+  NoteDevice *device, unsigned char *frames,
+  int32_t count, PcmWaveState *state
+) {
+  const int size = device->frameSize;
+  const unsigned char *table = device->wave.frames;
+  uint32_t value = state->value;
+  const uint32_t step = state->step;
+
+  while (count > 0) {
+    pcmCopyFrame(frames, &table[(value >> (32 - PCM_WAVE_TABLE_BITS)) * size], size);
+    frames += size;
+    value += step;
+    count -= 1;
+  }
+
+  state->value = value;
+}
+
+static void
+pcmGenerateFade (
+  NoteDevice *device, unsigned char *frames,
+  int32_t count, PcmWaveState *state
+) {
+  const int16_t *amplitudes = device->wave.amplitudes;
+
+  while (count > 0) {
+    int32_t amplitude = amplitudes[state->value >> (32 - PCM_WAVE_TABLE_BITS)];
+    amplitude *= state->fadeLevel;
+    amplitude /= state->fadeLength;
+
+    pcmEncodeFrame(device, frames, amplitude);
+    frames += device->frameSize;
+
+    state->value += state->step;
+    state->fadeLevel += state->fadeIncrement;
+    count -= 1;
+  }
 }
 
 static int
 pcmFlushBlock (NoteDevice *device) {
-  while (device->blockUsed)
-    if (!pcmWriteSample(device, 0))
-      return 0;
+  if (device->blockUsed) {
+    int32_t count = (device->blockSize - device->blockUsed) / device->frameSize;
+    if (!pcmWriteFrames(device, count, pcmGenerateSilence, NULL)) return 0;
+  }
 
   return 1;
 }
 
+static unsigned char
+pcmGetVolume (void) {
+  return MIN(100, prefs.pcmVolume);
+}
+
+static void
+pcmPrepareWave (NoteDevice *device) {
+  /* We need to know the maximum amplitude based on the currently set
+   * volume percentage. This percentage then needs to be squared because
+   * we perceive loudness exponentially.
+   */
+  const unsigned char fullVolume = 100;
+  const unsigned char currentVolume = pcmGetVolume();
+
+  if (device->wave.ready && (device->wave.volume == currentVolume)) return;
+  device->wave.volume = currentVolume;
+  device->wave.ready = 1;
+
+  const int32_t maximumAmplitude = INT16_MAX
+                                 * (currentVolume * currentVolume)
+                                 / (fullVolume * fullVolume);
+
+  /* The calculations for triangle wave generation work out nicely and
+   * efficiently if we map a full period onto a 32-bit unsigned range.
+   */
+
+  /* The two high-order bits specify which quarter wave a sample is for.
+   *   00 -> ascending from the negative peak to zero
+   *   01 -> ascending from zero to the positive peak
+   *   10 -> descending from the positive peak to zero
+   *   11 -> descending from zero to the negative peak
+   * The higher bit is 0 for the ascending segment and 1 for the
+   * descending segment. The lower bit is 0 when going from a peak to
+   * zero and 1 when going from zero to a peak.
+   */
+  const uint8_t magnitudeWidth = 32 - 2;
+
+  /* The amplitude is 0 when the lower bit of the quarter wave indicator
+   * is 1 and the rest of the (magnitude) bits are all 0.
+   */
+  const uint32_t zeroValue = UINT32_C(1) << magnitudeWidth;
+
+  unsigned char *frame = device->wave.frames;
+
+  for (unsigned int index=0; index<PCM_WAVE_TABLE_SIZE; index+=1) {
+    /* The current value needs to be a signed value so that the >> operator
+     * will extend its sign bit.
+     */
+    int32_t currentValue = (uint32_t)index << (32 - PCM_WAVE_TABLE_BITS);
+
+    /* Convert the current 32-bit unsigned linear value to a 31-bit
+     * triangular amplitude by inverting its low-order 31 bits if its
+     * high-order (sign) bit is set.
+     */
+    int32_t amplitude = currentValue ^ (currentValue >> 31);
+
+    /* Convert the 31-bit amplitude from unsigned to signed. */
+    amplitude -= zeroValue;
+
+    /* Convert the amplitude's magnitude from 30 bits to 16 bits. */
+    amplitude >>= magnitudeWidth - 16;
+
+    /* Adjust the 17-bit signed amplitude (sign bit + 16-bit value) by
+     * the currently set volume (15-bit value):
+     * (16-bit value) * (15-bit value) + (sign bit) = 32-bit signed value
+     */
+    amplitude *= maximumAmplitude;
+
+    /* Convert the signed amplitude from 32 bits to 16 bits. */
+    amplitude >>= 16;
+
+    device->wave.amplitudes[index] = amplitude;
+    pcmEncodeFrame(device, frame, amplitude);
+    frame += device->frameSize;
+  }
+}
+
 static NoteDevice *
 pcmConstruct (int errorLevel) {
   NoteDevice *device;
@@ -98,13 +325,28 @@ pcmConstruct (int errorLevel) {
       PcmSample sample;
       PcmSampleSize sampleSize = device->makeSample(&sample, 0);
       sampleSize *= device->channelCount;
+      device->frameSize = sampleSize;
 
       if (sampleSize && device->blockSize &&
           !(device->blockSize % sampleSize)) {
         if ((device->blockAddress = malloc(device->blockSize))) {
-          logMessage(LOG_DEBUG, "PCM enabled: BlkSz:%d Rate:%d ChnCt:%d Fmt:%d",
-                     device->blockSize, device->sampleRate, device->channelCount, device->amplitudeFormat);
-          return device;
+          size_t tableSize = ARRAY_SIZE(device->wave.amplitudes, PCM_WAVE_TABLE_SIZE);
+          size_t framesSize = (PCM_WAVE_TABLE_SIZE + 1) * sampleSize;
+
+          if ((device->wave.amplitudes = malloc(tableSize + framesSize))) {
+            device->wave.frames = (unsigned char *)&device->wave.amplitudes[PCM_WAVE_TABLE_SIZE];
+            device->wave.silence = &device->wave.frames[PCM_WAVE_TABLE_SIZE * sampleSize];
+            pcmEncodeFrame(device, device->wave.silence, 0);
+            device->wave.ready = 0;
+
+            logMessage(LOG_DEBUG, "PCM enabled: BlkSz:%d Rate:%d ChnCt:%d Fmt:%d",
+                       device->blockSize, device->sampleRate, device->channelCount, device->amplitudeFormat);
+            return device;
+          } else {
+            logMallocError();
+          }
+
+          free(device->blockAddress);
         } else {
           logMallocError();
         }
@@ -130,6 +372,7 @@ pcmConstruct (int errorLevel) {
 static void
 pcmDestruct (NoteDevice *device) {
   pcmFlushBlock(device);
+  free(device->wave.amplitudes);
   free(device->blockAddress);
   closePcmDevice(device->pcm);
   free(device);
@@ -148,37 +391,10 @@ pcmTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency) {
      * relying too much on floating-point performance and/or on
      * expensive math functions like sin(). Considerations like
      * these are especially important on PDAs without any FPU.
+     * Its samples are precomputed (see pcmPrepareWave) so that
+     * generating a tone only needs to copy already encoded frames.
      */ 
-
-    /* We need to know the maximum amplitude based on the currently set
-     * volume percentage. This percentage then needs to be squared because
-     * we perceive loudness exponentially.
-     */
-    const unsigned char fullVolume = 100;
-    const unsigned char currentVolume = MIN(fullVolume, prefs.pcmVolume);
-    const int32_t maximumAmplitude = INT16_MAX
-                                   * (currentVolume * currentVolume)
-                                   / (fullVolume * fullVolume);
-
-    /* The calculations for triangle wave generation work out nicely and
-     * efficiently if we map a full period onto a 32-bit unsigned range.
-     */
-
-    /* The two high-order bits specify which quarter wave a sample is for.
-     *   00 -> ascending from the negative peak to zero
-     *   01 -> ascending from zero to the positive peak
-     *   10 -> descending from the positive peak to zero
-     *   11 -> descending from zero to the negative peak
-     * The higher bit is 0 for the ascending segment and 1 for the
-     * descending segment. The lower bit is 0 when going from a peak to
-     * zero and 1 when going from zero to a peak.
-     */
-    const uint8_t magnitudeWidth = 32 - 2;
-
-    /* The amplitude is 0 when the lower bit of the quarter wave indicator
-     * is 1 and the rest of the (magnitude) bits are all 0.
-     */
-    const uint32_t zeroValue = UINT32_C(1) << magnitudeWidth;
+    pcmPrepareWave(device);
 
     /* We need to know how many steps to make from one sample to the next.
      * stepsPerSample = stepsPerWave * wavesPerSecond / samplesPerSecond
@@ -189,13 +405,6 @@ pcmTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency) {
                                   / (NoteFrequency)device->sampleRate
                                   * frequency;
 
-    /* The current value needs to be a signed value so that the >> operator
-     * will extend its sign bit. We start by initializing it to the value
-     * that corresponds to the start of the first logical quarter wave
-     * (the one that ascends from zero to the positive peak).
-     */
-    int32_t currentValue = zeroValue;
-
     /* Round the number of samples up to a whole number of periods:
      * partialSteps = (sampleCount * stepsPerSample) % stepsPerWave
      *
@@ -210,37 +419,39 @@ pcmTone (NoteDevice *device, unsigned int duration, NoteFrequency frequency) {
      */
     sampleCount += (uint32_t)(sampleCount * -stepsPerSample) / stepsPerSample;
 
-    while (sampleCount > 0) {
-      /* Convert the current 32-bit unsigned linear value to a 31-bit
-       * triangular amplitude by inverting its low-order 31 bits if its
-       * high-order (sign) bit is set.
-       */
-      int32_t amplitude = currentValue ^ (currentValue >> 31);
+    int32_t fadeCount = MIN(device->sampleRate * PCM_FADE_MILLISECONDS / 1000,
+                            sampleCount / 4);
 
-      /* Convert the 31-bit amplitude from unsigned to signed. */
-      amplitude -= zeroValue;
+    /* We start at the value that corresponds to the start of the first
+     * logical quarter wave (the one that ascends from zero to the positive
+     * peak).
+     */
+    PcmWaveState state = {
+      .value = UINT32_C(1) << (32 - 2),
+      .step = stepsPerSample,
 
-      /* Convert the amplitude's magnitude from 30 bits to 16 bits. */
-      amplitude >>= magnitudeWidth - 16;
+      .fadeLevel = 0,
+      .fadeIncrement = 1,
+      .fadeLength = fadeCount
+    };
 
-      /* Adjust the 17-bit signed amplitude (sign bit + 16-bit value) by
-       * the currently set volume (15-bit value):
-       * (16-bit value) * (15-bit value) + (sign bit) = 32-bit signed value
-       */
-      amplitude *= maximumAmplitude;
+    if (pcmWriteFrames(device, fadeCount, pcmGenerateFade, &state)) {
+      sampleCount -= fadeCount;
 
-      /* Convert the signed amplitude from 32 bits to 16 bits. */
-      amplitude >>= 16;
+      if (pcmWriteFrames(device, sampleCount-fadeCount, pcmGenerateWave, &state)) {
+        sampleCount = fadeCount;
+        state.fadeLevel = fadeCount;
+        state.fadeIncrement = -1;
 
-      if (!pcmWriteSample(device, amplitude)) break;
-      currentValue += stepsPerSample;
-      sampleCount -= 1;
+        if (pcmWriteFrames(device, fadeCount, pcmGenerateFade, &state)) {
+          sampleCount = 0;
+        }
+      }
     }
   } else {
     /* generate silence */
-    while (sampleCount > 0) {
-      if (!pcmWriteSample(device, 0)) break;
-      sampleCount -= 1;
+    if (pcmWriteFrames(device, sampleCount, pcmGenerateSilence, NULL)) {
+      sampleCount = 0;
     }
   }
 
@@ -257,11 +468,81 @@ pcmFlush (NoteDevice *device) {
   return pcmFlushBlock(device);
 }
 
+static NoteRendering *
+pcmRender (NoteDevice *device, const ToneElement *tune) {
+  NoteRendering *rendering;
+
+  if (!pcmFlushBlock(device)) return NULL;
+
+  if ((rendering = malloc(sizeof(*rendering) + device->blockSize))) {
+    memset(rendering, 0, sizeof(*rendering));
+    rendering->sampleRate = device->sampleRate;
+    rendering->channelCount = device->channelCount;
+    rendering->amplitudeFormat = device->amplitudeFormat;
+    rendering->volume = pcmGetVolume();
+    rendering->size = device->blockSize;
+    device->rendering = rendering;
+
+    {
+      int ok = 1;
+
+      while (tune->duration) {
+        if (!pcmTone(device, tune->duration, tune->frequency)) {
+          ok = 0;
+          break;
+        }
+
+        tune += 1;
+      }
+
+      if (ok) ok = pcmFlushBlock(device);
+      rendering = device->rendering;
+      device->rendering = NULL;
+
+      if (ok) {
+        logMessage(LOG_DEBUG, "PCM tune rendered: Size:%"PRIsize, rendering->used);
+        return rendering;
+      }
+    }
+
+    device->blockUsed = 0;
+    free(rendering);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+static int
+pcmIsRenderingUsable (NoteDevice *device, const NoteRendering *rendering) {
+  return (rendering->sampleRate == device->sampleRate)
+      && (rendering->channelCount == device->channelCount)
+      && (rendering->amplitudeFormat == device->amplitudeFormat)
+      && (rendering->volume == pcmGetVolume());
+}
+
+static int
+pcmPlay (NoteDevice *device, const NoteRendering *rendering) {
+  if (!pcmFlushBlock(device)) return 0;
+  return writePcmData(device->pcm, rendering->bytes, rendering->used);
+}
+
+static void
+pcmRelease (NoteRendering *rendering) {
+  free(rendering);
+}
+
 const NoteMethods pcmNoteMethods = {
   .construct = pcmConstruct,
   .destruct = pcmDestruct,
 
   .tone = pcmTone,
   .note = pcmNote,
-  .flush = pcmFlush
+  .flush = pcmFlush,
+
+  .render = pcmRender,
+  .isRenderingUsable = pcmIsRenderingUsable,
+  .play = pcmPlay,
+  .release = pcmRelease
 };
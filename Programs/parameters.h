@@ -37,6 +37,7 @@ extern "C" {
 
 #define SPEECH_DRIVER_START_RETRY_INTERVAL 5000
 #define SPEECH_DRIVER_START_AUTOSPEAK_DELAY 4000
+#define AUTOSPEAK_NEARBY_ROW_LIMIT 5
 
 #define SPEECH_DRIVER_THREAD_START_TIMEOUT 15000
 #define SPEECH_DRIVER_THREAD_STOP_TIMEOUT 5000
@@ -53,6 +54,7 @@ extern "C" {
 #define PID_FILE_CREATE_RETRY_INTERVAL 5000
 
 #define UPDATE_SCHEDULE_DELAY 15
+#define CONTRACTION_SPECULATION_DELAY 50
 
 #define TUNE_DEVICE_CLOSE_DELAY 2000
 #define TUNE_TOGGLE_REPEAT_DELAY 100
@@ -65,6 +67,8 @@ extern "C" {
 
 #define MOUNT_TABLE_UPDATE_RETRY_INTERVAL 5000
 
+#define TABLE_RELOAD_DELAY 500
+
 #define GPM_CONNECTION_RESET_DELAY 5000
 
 #define GIO_USB_INPUT_MONITOR_DISABLE 0
@@ -85,6 +89,9 @@ extern "C" {
 #define LINUX_USB_INPUT_PIPE_DISABLE 0
 #define LINUX_USB_INPUT_USE_SIGNAL_MONITOR 0
 #define LINUX_USB_INPUT_TREAT_INTERRUPT_AS_BULK 0
+#define LINUX_USB_HOTPLUG_EVENT_SIZE 0X2000
+#define LINUX_UINPUT_BATCH_EVENT_LIMIT 32
+#define LINUX_UINPUT_BATCH_FLUSH_DELAY 5
 #define LINUX_BLUETOOTH_NAME_OBTAIN_ASYNCHRONOUS 1
 #define LINUX_BLUETOOTH_CHANNEL_DISCOVER_ASYNCHRONOUS 1
 #define LINUX_BLUETOOTH_CHANNEL_CONNECT_ASYNCHRONOUS 1
@@ -131,6 +131,12 @@ insertScreenKey (ScreenKey key) {
   return currentScreen->insertKey(key);
 }
 
+int
+insertScreenCharacters (const wchar_t *characters, size_t count) {
+  logMessage(LOG_CATEGORY(SCREEN_DRIVER), "insert characters: %"PRIsize, count);
+  return currentScreen->insertCharacters(characters, count);
+}
+
 int
 routeScreenCursor (int column, int row, int screen) {
   return currentScreen->routeCursor(column, row, screen);
@@ -144,6 +144,17 @@ insertKey_BaseScreen (ScreenKey key) {
   return 0;
 }
 
+static int
+insertCharacters_BaseScreen (const wchar_t *characters, size_t count) {
+  const wchar_t *end = characters + count;
+
+  while (characters < end) {
+    if (!insertScreenKey(*characters++)) return 0;
+  }
+
+  return 1;
+}
+
 static int
 routeCursor_BaseScreen (int column, int row, int screen) {
   return 0;
@@ -184,6 +195,7 @@ initializeBaseScreen (BaseScreen *base) {
   base->describe = describe_BaseScreen;
   base->readCharacters = readCharacters_BaseScreen;
   base->insertKey = insertKey_BaseScreen;
+  base->insertCharacters = insertCharacters_BaseScreen;
 
   base->routeCursor = routeCursor_BaseScreen;
   base->highlightRegion = highlightRegion_BaseScreen;
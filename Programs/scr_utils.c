@@ -39,3 +39,50 @@ clearScreenCharacters (ScreenCharacter *characters, size_t count) {
   setScreenCharacterText(characters, WC_C(' '), count);
   setScreenCharacterAttributes(characters, SCR_COLOUR_DEFAULT, count);
 }
+
+ScreenRowHash
+hashScreenCharacters (const ScreenCharacter *characters, size_t count) {
+  const ScreenCharacter *end = characters + count;
+  ScreenRowHash hash = 0X811C9DC5;
+
+  while (characters < end) {
+    hash ^= characters->text;
+    hash *= 0X01000193;
+
+    hash ^= characters->attributes;
+    hash *= 0X01000193;
+
+    characters += 1;
+  }
+
+  return hash;
+}
+
+void
+findScreenTextChange (
+  ScreenTextChange *change,
+  const ScreenCharacter *oldCharacters, unsigned int oldCount,
+  const ScreenCharacter *newCharacters, unsigned int newCount
+) {
+  unsigned int limit = MIN(oldCount, newCount);
+  unsigned int prefix = 0;
+  unsigned int suffix = 0;
+
+  while (prefix < limit) {
+    if (oldCharacters[prefix].text != newCharacters[prefix].text) break;
+    prefix += 1;
+  }
+
+  limit -= prefix;
+  oldCharacters += oldCount;
+  newCharacters += newCount;
+
+  while (suffix < limit) {
+    if ((--oldCharacters)->text != (--newCharacters)->text) break;
+    suffix += 1;
+  }
+
+  change->column = prefix;
+  change->oldCount = oldCount - prefix - suffix;
+  change->newCount = newCount - prefix - suffix;
+}
@@ -25,9 +25,13 @@
 #include <sys/sysmacros.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
 #include <linux/major.h>
+#include <linux/netlink.h>
 
 #include "log.h"
+#include "parameters.h"
+#include "timing.h"
 #include "file.h"
 #include "device.h"
 #include "async_wait.h"
@@ -710,6 +714,12 @@ const unsigned char linuxKeyMapCount = ARRAY_COUNT(linuxKeyMapDescriptors);
 struct UinputObjectStruct {
   int fileDescriptor;
   BITMASK(pressedKeys, KEY_MAX+1, char);
+
+  struct {
+    struct input_event events[LINUX_UINPUT_BATCH_EVENT_LIMIT];
+    unsigned int count;
+    unsigned int depth;
+  } batch;
 };
 #endif /* HAVE_LINUX_UINPUT_H */
 
@@ -845,6 +855,35 @@ openCharacterDevice (const char *name, int flags, int major, int minor) {
   return descriptor;
 }
 
+int
+newKobjectUeventSocket (void) {
+#ifdef NETLINK_KOBJECT_UEVENT
+  int socketDescriptor;
+
+  const struct sockaddr_nl socketAddress = {
+    .nl_family = AF_NETLINK,
+    .nl_pid = 0,
+    .nl_groups = 0XFFFFFFFF
+  };
+
+  if ((socketDescriptor = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT)) != -1) {
+    if (bind(socketDescriptor, (const struct sockaddr *)&socketAddress, sizeof(socketAddress)) != -1) {
+      return socketDescriptor;
+    } else {
+      logSystemError("bind");
+    }
+
+    close(socketDescriptor);
+  } else {
+    logSystemError("socket");
+  }
+#else /* NETLINK_KOBJECT_UEVENT */
+  logUnsupportedOperation("kobject uevent socket");
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+  return -1;
+}
+
 UinputObject *
 newUinputObject (const char *name) {
   UinputObject *uinput = NULL;
@@ -921,6 +960,7 @@ newUinputObject (const char *name) {
 void
 destroyUinputObject (UinputObject *uinput) {
 #ifdef HAVE_LINUX_UINPUT_H
+  uinput->batch.depth = 0;
   releasePressedKeys(uinput);
   close(uinput->fileDescriptor);
   free(uinput);
@@ -952,24 +992,112 @@ enableUinputEventType (UinputObject *uinput, int type) {
   return 0;
 }
 
+#ifdef HAVE_LINUX_UINPUT_H
+static int
+writeInputEvents (UinputObject *uinput, const struct input_event *events, unsigned int count) {
+  const unsigned char *from = (const void *)events;
+  size_t size = count * sizeof(*events);
+
+  while (size) {
+    ssize_t result = write(uinput->fileDescriptor, from, size);
+
+    if (result == -1) {
+      if (errno == EINTR) continue;
+      logSystemError("write(struct input_event)");
+      return 0;
+    }
+
+    from += result;
+    size -= result;
+  }
+
+  return 1;
+}
+
+static struct input_event *
+addInputEvent (UinputObject *uinput) {
+  if (uinput->batch.count == ARRAY_COUNT(uinput->batch.events)) {
+    /* The kernel's per-client event buffer is small, so a full batch is
+     * written through its last complete report and the reader is given a
+     * moment to drain it before any more are collected.
+     */
+    struct input_event *events = uinput->batch.events;
+    unsigned int count = uinput->batch.count;
+
+    while (count) {
+      const struct input_event *event = &events[count - 1];
+      if ((event->type == EV_SYN) && (event->code == SYN_REPORT)) break;
+      count -= 1;
+    }
+
+    if (!count) count = uinput->batch.count;
+    if (!writeInputEvents(uinput, events, count)) return NULL;
+
+    uinput->batch.count -= count;
+    memmove(events, &events[count], ARRAY_SIZE(events, uinput->batch.count));
+    approximateDelay(LINUX_UINPUT_BATCH_FLUSH_DELAY);
+  }
+
+  return &uinput->batch.events[uinput->batch.count++];
+}
+#endif /* HAVE_LINUX_UINPUT_H */
+
 int
 writeInputEvent (UinputObject *uinput, uint16_t type, uint16_t code, int32_t value) {
 #ifdef HAVE_LINUX_UINPUT_H
   struct input_event event;
+  struct input_event *next = &event;
+
+  if (uinput->batch.depth) {
+    if (!(next = addInputEvent(uinput))) return 0;
+  }
+
+  memset(next, 0, sizeof(*next));
+  gettimeofday(&next->time, NULL);
+  next->type = type;
+  next->code = code;
+  next->value = value;
+
+  if (next != &event) return 1;
+  if (writeInputEvents(uinput, &event, 1)) return 1;
+#endif /* HAVE_LINUX_UINPUT_H */
+
+  return 0;
+}
+
+int
+flushInputEvents (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  unsigned int count = uinput->batch.count;
 
-  memset(&event, 0, sizeof(event));
-  gettimeofday(&event.time, NULL);
-  event.type = type;
-  event.code = code;
-  event.value = value;
+  uinput->batch.count = 0;
+  if (!count) return 1;
 
-  if (write(uinput->fileDescriptor, &event, sizeof(event)) != -1) return 1;
-  logSystemError("write(struct input_event)");
+  if (writeInputEvents(uinput, uinput->batch.events, count)) return 1;
 #endif /* HAVE_LINUX_UINPUT_H */
 
   return 0;
 }
 
+void
+beginInputEvents (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  uinput->batch.depth += 1;
+#endif /* HAVE_LINUX_UINPUT_H */
+}
+
+int
+endInputEvents (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  if (uinput->batch.depth) {
+    if (--uinput->batch.depth) return 1;
+    return flushInputEvents(uinput);
+  }
+#endif /* HAVE_LINUX_UINPUT_H */
+
+  return 1;
+}
+
 static int
 writeSynReport (UinputObject *uinput) {
   return writeInputEvent(uinput, EV_SYN, SYN_REPORT, 0);
@@ -348,6 +348,7 @@ makeTextTable (TextTableData *ttd) {
   if (table) {
     memset(table, 0, sizeof(*table));
 
+    trimDataArea(ttd->area);
     table->header.fields = getTextTableHeader(ttd);
     table->size = getDataSize(ttd->area);
 
@@ -359,9 +360,24 @@ makeTextTable (TextTableData *ttd) {
   return table;
 }
 
+void
+resetTextTableCache (TextTable *table) {
+  unsigned int rowNumber;
+
+  for (rowNumber=0; rowNumber<TEXT_TABLE_CACHE_ROW_COUNT; rowNumber+=1) {
+    TextTableCacheRow **row = &table->cache.rows[rowNumber];
+
+    if (*row) {
+      free(*row);
+      *row = NULL;
+    }
+  }
+}
+
 void
 destroyTextTable (TextTable *table) {
   if (table->size) {
+    resetTextTableCache(table);
     free(table->header.fields);
     free(table);
   }
@@ -52,6 +52,13 @@ typedef struct {
   wchar_t to;
 } TextTableAliasEntry;
 
+#define TEXT_TABLE_CACHE_ROW_COUNT 0X100
+
+typedef struct {
+  unsigned char cells[UNICODE_CELLS_PER_ROW];
+  BITMASK(cellCached, UNICODE_CELLS_PER_ROW, char);
+} TextTableCacheRow;
+
 typedef struct {
   TextTableOffset unicodeGroups[UNICODE_GROUP_COUNT];
   wchar_t dotsToCharacter[0X100];
@@ -71,8 +78,14 @@ struct TextTableStruct {
   struct {
     unsigned char tryBaseCharacter;
   } options;
+
+  struct {
+    TextTableCacheRow *rows[TEXT_TABLE_CACHE_ROW_COUNT];
+  } cache;
 };
 
+extern void resetTextTableCache (TextTable *table);
+
 extern const TextTableAliasEntry *locateTextTableAlias (
   wchar_t character, const TextTableAliasEntry *array, size_t count
 );
@@ -19,10 +19,12 @@
 #include "prologue.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "log.h"
 #include "file.h"
 #include "charset.h"
+#include "lock.h"
 #include "ttb.h"
 #include "ttb_internal.h"
 #include "brl_dots.h"
@@ -86,9 +88,52 @@ getUnicodeCellEntry (TextTable *table, wchar_t character) {
   return NULL;
 }
 
+static LockDescriptor *
+getTextTableCacheLock (void) {
+  static LockDescriptor *lock = NULL;
+
+  return getLockDescriptor(&lock, "text-table-cache");
+}
+
+static TextTableCacheRow *
+getTextTableCacheRow (TextTable *table, wchar_t character) {
+  uint32_t value = character;
+
+  if (value < (TEXT_TABLE_CACHE_ROW_COUNT << UNICODE_ROW_SHIFT)) {
+    unsigned int rowNumber = value >> UNICODE_ROW_SHIFT;
+    TextTableCacheRow **row = &table->cache.rows[rowNumber];
+
+    /* braille characters translate directly - there's nothing to remember */
+    if (rowNumber == (UNICODE_BRAILLE_ROW >> UNICODE_ROW_SHIFT)) return NULL;
+
+    /* the translation of the 0XF0 row depends on the current character set */
+    if (rowNumber == 0XF0) return NULL;
+
+    if (!*row) {
+      if (!(*row = malloc(sizeof(**row)))) {
+        logMallocError();
+        return NULL;
+      }
+
+      BITMASK_ZERO((*row)->cellCached);
+    }
+
+    return *row;
+  }
+
+  return NULL;
+}
+
 void
 setTryBaseCharacter (TextTable *table, unsigned char yes) {
-  table->options.tryBaseCharacter = yes;
+  if (yes != table->options.tryBaseCharacter) {
+    LockDescriptor *lock = getTextTableCacheLock();
+
+    if (lock) obtainExclusiveLock(lock);
+    table->options.tryBaseCharacter = yes;
+    resetTextTableCache(table);
+    if (lock) releaseLock(lock);
+  }
 }
 
 static int
@@ -136,8 +181,8 @@ setBrailleRepresentation (wchar_t character, void *data) {
   return 0;
 }
 
-unsigned char
-convertCharacterToDots (TextTable *table, wchar_t character) {
+static unsigned char
+translateCharacterToDots (TextTable *table, wchar_t character) {
   switch (character & ~UNICODE_CELL_MASK) {
     case UNICODE_BRAILLE_ROW:
       return character & UNICODE_CELL_MASK;
@@ -202,6 +247,51 @@ convertCharacterToDots (TextTable *table, wchar_t character) {
   return BRL_DOT_1 | BRL_DOT_2 | BRL_DOT_3 | BRL_DOT_4 | BRL_DOT_5 | BRL_DOT_6 | BRL_DOT_7 | BRL_DOT_8;
 }
 
+static unsigned char
+getCachedDots (TextTable *table, wchar_t character) {
+  TextTableCacheRow *row = getTextTableCacheRow(table, character);
+
+  if (row) {
+    unsigned int cellNumber = UNICODE_CELL_NUMBER(character);
+
+    if (!BITMASK_TEST(row->cellCached, cellNumber)) {
+      row->cells[cellNumber] = translateCharacterToDots(table, character);
+      BITMASK_SET(row->cellCached, cellNumber);
+    }
+
+    return row->cells[cellNumber];
+  }
+
+  return translateCharacterToDots(table, character);
+}
+
+unsigned char
+convertCharacterToDots (TextTable *table, wchar_t character) {
+  LockDescriptor *lock = getTextTableCacheLock();
+  unsigned char dots;
+
+  if (!lock) return translateCharacterToDots(table, character);
+  obtainExclusiveLock(lock);
+  dots = getCachedDots(table, character);
+  releaseLock(lock);
+  return dots;
+}
+
+void
+convertCharactersToDots (TextTable *table, const wchar_t *characters, unsigned char *dots, size_t count) {
+  LockDescriptor *lock = getTextTableCacheLock();
+  const wchar_t *end = characters + count;
+
+  if (!lock) {
+    while (characters < end) *dots++ = translateCharacterToDots(table, *characters++);
+    return;
+  }
+
+  obtainExclusiveLock(lock);
+  while (characters < end) *dots++ = getCachedDots(table, *characters++);
+  releaseLock(lock);
+}
+
 wchar_t
 convertDotsToCharacter (TextTable *table, unsigned char dots) {
   const TextTableHeader *header = table->header.fields;
@@ -84,6 +84,62 @@ openTuneDevice (void) {
   return 0;
 }
 
+typedef struct {
+  const ToneElement *tune;
+  NoteRendering *rendering;
+} RenderedTune;
+
+static RenderedTune *renderedTunes = NULL;
+static unsigned int renderedTuneCount = 0;
+static unsigned int renderedTuneSize = 0;
+
+static RenderedTune *
+findRenderedTune (const ToneElement *tune) {
+  RenderedTune *rendered = renderedTunes;
+  const RenderedTune *end = rendered + renderedTuneCount;
+
+  while (rendered < end) {
+    if (rendered->tune == tune) return rendered;
+    rendered += 1;
+  }
+
+  return NULL;
+}
+
+static void
+releaseTuneRendering (RenderedTune *rendered) {
+  if (rendered->rendering) {
+    noteMethods->release(rendered->rendering);
+    rendered->rendering = NULL;
+  }
+}
+
+static void
+releaseTuneRenderings (void) {
+  for (unsigned int index=0; index<renderedTuneCount; index+=1) {
+    releaseTuneRendering(&renderedTunes[index]);
+  }
+}
+
+/* A tune is only rendered when it's played so that the device isn't opened
+ * (and held) for tunes which may never be played.
+ */
+static NoteRendering *
+getTuneRendering (RenderedTune *rendered) {
+  if (!noteMethods->render) return NULL;
+  if (!openTuneDevice()) return NULL;
+
+  if (rendered->rendering) {
+    if (noteMethods->isRenderingUsable(noteDevice, rendered->rendering)) {
+      return rendered->rendering;
+    }
+
+    releaseTuneRendering(rendered);
+  }
+
+  return rendered->rendering = noteMethods->render(noteDevice, rendered->tune);
+}
+
 static const NoteElement *currentlyPlayingNotes = NULL;
 static const ToneElement *currentlyPlayingTones = NULL;
 
@@ -93,6 +149,8 @@ typedef enum {
   TUNE_REQ_SET_DEVICE,
   TUNE_REQ_PLAY_NOTES,
   TUNE_REQ_PLAY_TONES,
+  TUNE_REQ_RENDER_TONES,
+  TUNE_REQ_FORGET_TONES,
   TUNE_REQ_WAIT,
   TUNE_REQ_SYNCHRONIZE
 } TuneRequestType;
@@ -113,6 +171,14 @@ typedef struct {
       const ToneElement *tune;
     } playTones;
 
+    struct {
+      const ToneElement *tune;
+    } renderTones;
+
+    struct {
+      const ToneElement *tune;
+    } forgetTones;
+
     struct {
       int time;
     } wait;
@@ -126,6 +192,7 @@ typedef struct {
 static void
 handleTuneRequest_setDevice (const NoteMethods *methods) {
   if (methods != noteMethods) {
+    if (noteMethods) releaseTuneRenderings();
     closeTuneDevice();
     noteMethods = methods;
   }
@@ -144,6 +211,19 @@ handleTuneRequest_playNotes (const NoteElement *tune) {
 
 static void
 handleTuneRequest_playTones (const ToneElement *tune) {
+  {
+    RenderedTune *rendered = findRenderedTune(tune);
+
+    if (rendered) {
+      const NoteRendering *rendering = getTuneRendering(rendered);
+
+      if (rendering) {
+        noteMethods->play(noteDevice, rendering);
+        return;
+      }
+    }
+  }
+
   while (tune->duration) {
     if (!openTuneDevice()) return;
     if (!noteMethods->tone(noteDevice, tune->duration, tune->frequency)) return;
@@ -153,6 +233,40 @@ handleTuneRequest_playTones (const ToneElement *tune) {
   flushNoteDevice();
 }
 
+static void
+handleTuneRequest_renderTones (const ToneElement *tune) {
+  RenderedTune *rendered = findRenderedTune(tune);
+
+  if (!rendered) {
+    if (renderedTuneCount == renderedTuneSize) {
+      unsigned int newSize = renderedTuneSize? renderedTuneSize<<1: 0X20;
+      RenderedTune *newArray = realloc(renderedTunes, ARRAY_SIZE(newArray, newSize));
+
+      if (!newArray) {
+        logMallocError();
+        return;
+      }
+
+      renderedTunes = newArray;
+      renderedTuneSize = newSize;
+    }
+
+    rendered = &renderedTunes[renderedTuneCount++];
+    rendered->tune = tune;
+    rendered->rendering = NULL;
+  }
+}
+
+static void
+handleTuneRequest_forgetTones (const ToneElement *tune) {
+  RenderedTune *rendered = findRenderedTune(tune);
+
+  if (rendered) {
+    if (noteMethods) releaseTuneRendering(rendered);
+    *rendered = renderedTunes[--renderedTuneCount];
+  }
+}
+
 static void
 handleTuneRequest_wait (int time) {
   asyncWait(time);
@@ -191,6 +305,14 @@ handleTuneRequest (TuneRequest *req) {
         break;
       }
 
+      case TUNE_REQ_RENDER_TONES:
+        handleTuneRequest_renderTones(req->parameters.renderTones.tune);
+        break;
+
+      case TUNE_REQ_FORGET_TONES:
+        handleTuneRequest_forgetTones(req->parameters.forgetTones.tune);
+        break;
+
       case TUNE_REQ_WAIT:
         handleTuneRequest_wait(req->parameters.wait.time);
         break;
@@ -202,6 +324,15 @@ handleTuneRequest (TuneRequest *req) {
 
     free(req);
   } else {
+    if (noteMethods) releaseTuneRenderings();
+
+    if (renderedTunes) {
+      free(renderedTunes);
+      renderedTunes = NULL;
+    }
+
+    renderedTuneCount = 0;
+    renderedTuneSize = 0;
     closeTuneDevice();
   }
 }
@@ -489,6 +620,26 @@ tunePlayTones (const ToneElement *tune) {
   }
 }
 
+void
+tuneRenderTones (const ToneElement *tune) {
+  TuneRequest *req;
+
+  if ((req = newTuneRequest(TUNE_REQ_RENDER_TONES))) {
+    req->parameters.renderTones.tune = tune;
+    if (!sendTuneRequest(req)) free(req);
+  }
+}
+
+void
+tuneForgetTones (const ToneElement *tune) {
+  TuneRequest *req;
+
+  if ((req = newTuneRequest(TUNE_REQ_FORGET_TONES))) {
+    req->parameters.forgetTones.tune = tune;
+    if (!sendTuneRequest(req)) free(req);
+  }
+}
+
 void
 tuneWait (int time) {
   TuneRequest *req;
@@ -306,14 +306,25 @@ showInfo (void) {
   return writeBrailleText(mode, text);
 }
 
+typedef struct {
+  ScreenCharacter *characters;
+  size_t size;
+
+  int screen;
+  int row;
+  int width;
+} SavedScreenRows;
+
+#define SAVED_SCREEN_ROWS_INITIALIZER {.screen=-1, .row=-1}
+
 static int
-saveScreenCharacters (
-  ScreenCharacter **buffer, size_t *size,
+saveScreenRows (
+  SavedScreenRows *saved, int row, int width,
   const ScreenCharacter *characters, size_t count
 ) {
   size_t newSize = count * sizeof(*characters);
 
-  if (newSize > *size) {
+  if (newSize > saved->size) {
     ScreenCharacter *newBuffer = malloc(newSize);
 
     if (!newBuffer) {
@@ -321,26 +332,84 @@ saveScreenCharacters (
       return 0;
     }
 
-    if (*buffer) free(*buffer);
-    *buffer = newBuffer;
-    *size = newSize;
+    if (saved->characters) free(saved->characters);
+    saved->characters = newBuffer;
+    saved->size = newSize;
   }
 
-  memcpy(*buffer, characters, newSize);
+  memcpy(saved->characters, characters, newSize);
+  saved->screen = scr.number;
+  saved->row = row;
+  saved->width = width;
+  return 1;
+}
+
+static int
+haveSavedScreenRows (const SavedScreenRows *saved, int row, int width) {
+  if (!saved->characters) return 0;
+  if (saved->screen != scr.number) return 0;
+  if (saved->row != row) return 0;
+  if (saved->width != width) return 0;
   return 1;
 }
 
+static int
+findScreenScroll (
+  const ScreenCharacter *oldCharacters,
+  int width, int rowCount, int top
+) {
+  int distance = 0;
+  int rows = top + rowCount - 1;
+  ScreenCharacter *characters;
+
+  if ((characters = malloc(ARRAY_SIZE(characters, (rows * width))))) {
+    ScreenRowHash *hashes;
+
+    if ((hashes = malloc(ARRAY_SIZE(hashes, rows)))) {
+      ScreenRowHash oldHashes[rowCount];
+      int row;
+
+      for (row=0; row<rowCount; row+=1) {
+        oldHashes[row] = hashScreenCharacters(&oldCharacters[row * width], width);
+      }
+
+      readScreenRows(0, width, rows, characters);
+
+      for (row=top; row<rows; row+=1) {
+        hashes[row] = hashScreenCharacters(&characters[row * width], width);
+      }
+
+      for (row=top-1; row>=0; row-=1) {
+        if ((scr.posy >= row) && (scr.posy < (row + rowCount))) break;
+        hashes[row] = hashScreenCharacters(&characters[row * width], width);
+
+        if (memcmp(&hashes[row], oldHashes, sizeof(oldHashes)) == 0) {
+          if (isSameRow(&characters[row * width], oldCharacters, (rowCount * width), isSameCharacter)) {
+            distance = top - row;
+            break;
+          }
+        }
+      }
+
+      free(hashes);
+    } else {
+      logMallocError();
+    }
+
+    free(characters);
+  } else {
+    logMallocError();
+  }
+
+  return distance;
+}
+
 static void
 checkScreenScroll (int track) {
   const int rowCount = 3;
 
-  static int oldScreen = -1;
-  static int oldRow = -1;
-  static int oldWidth = 0;
-  static size_t oldSize = 0;
-  static ScreenCharacter *oldCharacters = NULL;
+  static SavedScreenRows old = SAVED_SCREEN_ROWS_INITIALIZER;
 
-  int newScreen = scr.number;
   int newWidth = scr.cols;
   size_t newCount = newWidth * rowCount;
   ScreenCharacter newCharacters[newCount];
@@ -353,54 +422,96 @@ checkScreenScroll (int track) {
   } else {
     readScreenRows(newTop, newWidth, rowCount, newCharacters);
 
-    if (track && prefs.trackScreenScroll && oldCharacters &&
-        (newScreen == oldScreen) && (newWidth == oldWidth) &&
-        (newRow == oldRow)) {
-      while (newTop > 0) {
-        if ((scr.posy >= newTop) && (scr.posy <= newRow)) break;
+    if (track && prefs.trackScreenScroll &&
+        haveSavedScreenRows(&old, newRow, newWidth)) {
+      if ((scr.posy < newTop) || (scr.posy > newRow)) {
+        if (!isSameRow(old.characters, newCharacters, newCount, isSameCharacter)) {
+          int distance = findScreenScroll(old.characters, newWidth, rowCount, newTop);
 
-        if (isSameRow(oldCharacters, newCharacters, newCount, isSameCharacter)) {
-          if (newRow != ses->winy) {
-            ses->winy = newRow;
+          if (distance) {
+            /* the saved rows are what is now at the new window position */
+            ses->winy = newRow - distance;
+            old.row = ses->winy;
             alert(ALERT_SCROLL_UP);
+            return;
           }
-
-          break;
         }
-
-        readScreenRows(--newTop, newWidth, rowCount, newCharacters);
-        newRow -= 1;
       }
     }
   }
 
-  if (saveScreenCharacters(&oldCharacters, &oldSize, newCharacters, newCount)) {
-    oldScreen = newScreen;
-    oldRow = ses->winy;
-    oldWidth = newWidth;
-  }
+  saveScreenRows(&old, ses->winy, newWidth, newCharacters, newCount);
 }
 
 #ifdef ENABLE_SPEECH_SUPPORT
 static int wasAutospeaking;
 
+static int
+findNearbyRowChange (
+  const SavedScreenRows *old, const ScreenCharacter *newCharacters,
+  int rowCount, const ScreenCharacter **characters, int *column, int *count
+) {
+  int width = old->width;
+  int distance;
+
+  /* the rows closest to the window are the most likely to be a menu or a
+   * list of completions for what's being typed
+   */
+  for (distance=1; distance<=AUTOSPEAK_NEARBY_ROW_LIMIT; distance+=1) {
+    const int rows[] = {ses->winy + distance, ses->winy - distance};
+    const int *row = rows;
+    const int *end = row + ARRAY_COUNT(rows);
+
+    while (row < end) {
+      int index = *row++ - old->row;
+
+      if ((index >= 0) && (index < rowCount)) {
+        const ScreenCharacter *from = &old->characters[index * width];
+        const ScreenCharacter *to = &newCharacters[index * width];
+
+        if (!isSameRow(from, to, width, isSameText)) {
+          ScreenTextChange change;
+
+          findScreenTextChange(&change, from, width, to, width);
+
+          if (change.newCount) {
+            *characters = to;
+            *column = change.column;
+            *count = change.newCount;
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
 void
 autospeak (AutospeakMode mode) {
-  static int oldScreen = -1;
+  static SavedScreenRows oldLine = SAVED_SCREEN_ROWS_INITIALIZER;
+  static SavedScreenRows oldNearby = SAVED_SCREEN_ROWS_INITIALIZER;
   static int oldX = -1;
   static int oldY = -1;
-  static int oldWidth = 0;
-  static ScreenCharacter *oldCharacters = NULL;
-  static size_t oldSize = 0;
   static int cursorAssumedStable = 0;
 
+  const ScreenCharacter *oldCharacters = oldLine.characters;
+  int oldScreen = oldLine.screen;
+  int oldWidth = oldLine.width;
+
   int newScreen = scr.number;
   int newX = scr.posx;
   int newY = scr.posy;
   int newWidth = scr.cols;
   ScreenCharacter newCharacters[newWidth];
 
+  int nearbyTop = MAX(ses->winy-AUTOSPEAK_NEARBY_ROW_LIMIT, 0);
+  int nearbyCount = MIN(ses->winy+AUTOSPEAK_NEARBY_ROW_LIMIT+1, scr.rows) - nearbyTop;
+  ScreenCharacter nearbyCharacters[nearbyCount * newWidth];
+
   readScreenRow(ses->winy, newWidth, newCharacters);
+  readScreenRows(nearbyTop, newWidth, nearbyCount, nearbyCharacters);
 
   if (!spk.track.isActive) {
     const ScreenCharacter *characters = newCharacters;
@@ -435,7 +546,9 @@ autospeak (AutospeakMode mode) {
               isSameRow(newCharacters, oldCharacters, newX, isSameText)) {
             int oldLength = oldWidth;
             int newLength = newWidth;
-            int x = newX;
+            int inserted = 0;
+            int deleted = 0;
+            ScreenTextChange change;
 
             while (oldLength > oldX) {
               if (!iswspace(oldCharacters[oldLength-1].text)) break;
@@ -449,34 +562,64 @@ autospeak (AutospeakMode mode) {
             }
             if (newLength < newWidth) newLength += 1;
 
-            while (1) {
-              int done = 1;
+            if ((oldLength < oldWidth) && (newLength < newWidth)) {
+              findScreenTextChange(&change, oldCharacters, oldLength, newCharacters, newLength);
 
-              if (x < newLength) {
-                if (isSameRow(newCharacters+x, oldCharacters+oldX, newWidth-x, isSameText)) {
-                  column = newX;
-                  count = prefs.autospeakInsertedCharacters? (x - newX): 0;
-                  reason = "characters inserted after cursor";
-                  goto autospeak;
+              if (!change.oldCount) {
+                inserted = change.newCount;
+              } else if (!change.newCount) {
+                deleted = change.oldCount;
+              }
+            } else {
+              /* A full row may have had characters pushed off its end, in
+               * which case the two rows don't share a suffix and the diff
+               * only finds where they start to differ. The shift is then
+               * where the first changed character has moved to.
+               */
+              int first;
+              int x;
+
+              findScreenTextChange(&change, oldCharacters, oldWidth, newCharacters, newWidth);
+              first = change.column;
+
+              for (x=first+1; x<newLength; x+=1) {
+                if (newCharacters[x].text == oldCharacters[first].text) {
+                  inserted = x - first;
+                  break;
                 }
-
-                done = 0;
               }
 
-              if (x < oldLength) {
-                if (isSameRow(newCharacters+newX, oldCharacters+x, oldWidth-x, isSameText)) {
-                  characters = oldCharacters;
-                  column = oldX;
-                  count = prefs.autospeakDeletedCharacters? (x - oldX): 0;
-                  reason = "characters deleted after cursor";
-                  goto autospeak;
+              for (x=first+1; x<oldLength; x+=1) {
+                if (oldCharacters[x].text == newCharacters[first].text) {
+                  deleted = x - first;
+                  break;
                 }
+              }
+            }
 
-                done = 0;
+            if (inserted) {
+              int x = newX + inserted;
+
+              if ((x < newLength) &&
+                  isSameRow(newCharacters+x, oldCharacters+oldX, newWidth-x, isSameText)) {
+                column = newX;
+                count = prefs.autospeakInsertedCharacters? (x - newX): 0;
+                reason = "characters inserted after cursor";
+                goto autospeak;
               }
+            }
+
+            if (deleted) {
+              int x = oldX + deleted;
 
-              if (done) break;
-              x += 1;
+              if ((x < oldLength) &&
+                  isSameRow(newCharacters+newX, oldCharacters+x, oldWidth-x, isSameText)) {
+                characters = oldCharacters;
+                column = oldX;
+                count = prefs.autospeakDeletedCharacters? (x - oldX): 0;
+                reason = "characters deleted after cursor";
+                goto autospeak;
+              }
             }
           }
 
@@ -533,9 +676,14 @@ autospeak (AutospeakMode mode) {
           }
         }
 
-        while (newCharacters[column].text == oldCharacters[column].text) ++column;
-        while (newCharacters[count-1].text == oldCharacters[count-1].text) --count;
-        count -= column;
+        {
+          ScreenTextChange change;
+
+          findScreenTextChange(&change, oldCharacters, oldWidth, newCharacters, newWidth);
+          column = change.column;
+          count = change.newCount;
+        }
+
         if (!prefs.autospeakReplacedCharacters) count = 0;
         reason = "characters replaced";
       } else if ((newY == ses->winy) && ((newX != oldX) || (newY != oldY)) && onScreen) {
@@ -573,6 +721,11 @@ autospeak (AutospeakMode mode) {
             }
           }
         }
+      } else if (prefs.autospeakReplacedCharacters &&
+                 haveSavedScreenRows(&oldNearby, nearbyTop, newWidth) &&
+                 findNearbyRowChange(&oldNearby, nearbyCharacters, nearbyCount,
+                                     &characters, &column, &count)) {
+        reason = "nearby characters replaced";
       } else {
         count = 0;
       }
@@ -593,13 +746,13 @@ autospeak (AutospeakMode mode) {
     }
   }
 
-  if (saveScreenCharacters(&oldCharacters, &oldSize, newCharacters, newWidth)) {
-    oldScreen = newScreen;
+  if (saveScreenRows(&oldLine, ses->winy, newWidth, newCharacters, newWidth)) {
     oldX = newX;
     oldY = newY;
-    oldWidth = newWidth;
     cursorAssumedStable = 0;
   }
+
+  saveScreenRows(&oldNearby, nearbyTop, newWidth, nearbyCharacters, nearbyCount*newWidth);
 }
 
 void
@@ -845,6 +998,9 @@ doUpdate (void) {
           contractedTrack = 0;
           isContracted = 1;
 
+          /* the window's text has just been read so let speculation use it */
+          scheduleContractionSpeculation(inputCharacters, (scr.cols - ses->winx));
+
           if (ses->displayMode || prefs.showAttributes) {
             int inputOffset;
             int outputOffset = 0;
@@ -941,12 +1097,16 @@ doUpdate (void) {
             wchar_t *text = &textBuffer[start];
             unsigned int column;
 
+            for (column=0; column<textCount; column+=1) {
+              text[column] = source[column].text;
+            }
+
+            convertCharactersToDots(textTable, text, target, textCount);
+
             for (column=0; column<textCount; column+=1) {
               const ScreenCharacter *character = &source[column];
               unsigned char *dots = &target[column];
 
-              *dots = convertCharacterToDots(textTable, character->text);
-
               if (iswupper(character->text)) {
                 BlinkDescriptor *blink = &uppercaseLettersBlinkDescriptor;
 
@@ -956,8 +1116,6 @@ doUpdate (void) {
 
               if (prefs.textStyle) *dots &= ~(BRL_DOT_7 | BRL_DOT_8);
               if (prefs.showAttributes) overlayAttributesUnderline(dots, character->attributes);
-
-              text[column] = character->text;
             }
           }
         }
@@ -1484,16 +1484,95 @@ usbVerifyInterface (UsbDevice *device, const UsbChannelDefinition *definition) {
 struct UsbChooseChannelDataStruct {
   const UsbChannelDefinition *definition;
 
+  struct {
+    const UsbChannelDefinition **table;
+    unsigned int count;
+  } sorted;
+
   const char *serialNumber;
   uint16_t vendorIdentifier;
   uint16_t productIdentifier;
   unsigned genericDevices:1;
 };
 
+static int
+usbCompareChannelDefinitions (const UsbChannelDefinition *definition, uint16_t vendor, uint16_t product) {
+  if (vendor < definition->vendor) return -1;
+  if (vendor > definition->vendor) return 1;
+
+  if (product < definition->product) return -1;
+  if (product > definition->product) return 1;
+
+  return 0;
+}
+
+static int
+usbSortChannelDefinitions (const void *element1, const void *element2) {
+  const UsbChannelDefinition *const *definition1 = element1;
+  const UsbChannelDefinition *const *definition2 = element2;
+
+  int relation = usbCompareChannelDefinitions(*definition2, (*definition1)->vendor, (*definition1)->product);
+  if (relation) return relation;
+
+  /* keep the original table order for definitions of the same product */
+  if (*definition1 < *definition2) return -1;
+  if (*definition1 > *definition2) return 1;
+  return 0;
+}
+
+static int
+usbSortChannelDefinitionTable (UsbChooseChannelData *data) {
+  const UsbChannelDefinition *definition = data->definition;
+  unsigned int count = 0;
+
+  while (definition[count].vendor) count += 1;
+
+  if ((data->sorted.table = malloc(ARRAY_SIZE(data->sorted.table, count)))) {
+    unsigned int index;
+
+    for (index=0; index<count; index+=1) data->sorted.table[index] = &definition[index];
+    data->sorted.count = count;
+
+    qsort(data->sorted.table, data->sorted.count,
+          sizeof(*data->sorted.table), usbSortChannelDefinitions);
+    return 1;
+  } else {
+    logMallocError();
+  }
+
+  return 0;
+}
+
+static const UsbChannelDefinition *const *
+usbFindChannelDefinitions (UsbChooseChannelData *data, uint16_t vendor, uint16_t product) {
+  const UsbChannelDefinition *const *table = data->sorted.table;
+  unsigned int first = 0;
+  unsigned int last = data->sorted.count;
+
+  while (first < last) {
+    unsigned int current = (first + last) / 2;
+
+    if (usbCompareChannelDefinitions(table[current], vendor, product) > 0) {
+      first = current + 1;
+    } else {
+      last = current;
+    }
+  }
+
+  if (first == data->sorted.count) return NULL;
+  if (usbCompareChannelDefinitions(table[first], vendor, product)) return NULL;
+  return &table[first];
+}
+
 static int
 usbChooseChannel (UsbDevice *device, UsbChooseChannelData *data) {
   const UsbDeviceDescriptor *descriptor = &device->descriptor;
-  const UsbChannelDefinition *definition = data->definition;
+  uint16_t vendor = getLittleEndian16(descriptor->idVendor);
+  uint16_t product = getLittleEndian16(descriptor->idProduct);
+  const UsbChannelDefinition *const *definitions = usbFindChannelDefinitions(data, vendor, product);
+  const UsbChannelDefinition *const *end = data->sorted.table + data->sorted.count;
+
+  if (!definitions) return 0;
 
   if (!(descriptor->iManufacturer ||
         descriptor->iProduct ||
@@ -1507,9 +1586,10 @@ usbChooseChannel (UsbDevice *device, UsbChooseChannelData *data) {
     }
   }
 
-  while (definition->vendor) {
+  while ((definitions < end) && !usbCompareChannelDefinitions(*definitions, vendor, product)) {
+    const UsbChannelDefinition *definition = *definitions;
+
     if (definition->version && (definition->version != getLittleEndian16(descriptor->bcdUSB))) goto nextDefinition;
-    if (!USB_IS_PRODUCT(descriptor, definition->vendor, definition->product)) goto nextDefinition;
 
     if (!data->genericDevices) {
       const UsbSerialAdapter *adapter = usbFindSerialAdapter(descriptor);
@@ -1532,7 +1612,7 @@ usbChooseChannel (UsbDevice *device, UsbChooseChannelData *data) {
     return 1;
 
   nextDefinition:
-    definition += 1;
+    definitions += 1;
   }
 
   return 0;
@@ -1613,9 +1693,13 @@ usbOpenChannel (const UsbChannelDefinition *definitions, const char *identifier)
     }
 
     if (ok) {
-      if (!(channel = usbNewChannel(&choose))) {
-        logMessage(LOG_CATEGORY(USB_IO), "device not found%s%s",
-                   (*identifier? ": ": ""), identifier);
+      if (usbSortChannelDefinitionTable(&choose)) {
+        if (!(channel = usbNewChannel(&choose))) {
+          logMessage(LOG_CATEGORY(USB_IO), "device not found%s%s",
+                     (*identifier? ": ": ""), identifier);
+        }
+
+        free(choose.sorted.table);
       }
     }
 
@@ -27,6 +27,7 @@
 #include <sys/stat.h>
 #include <sys/vfs.h>
 #include <sys/ioctl.h>
+#include <linux/netlink.h>
 #include <linux/usbdevice_fs.h>
 
 #ifndef USBDEVFS_DISCONNECT
@@ -48,6 +49,7 @@
 #include "async_io.h"
 #include "async_signal.h"
 #include "mntpt.h"
+#include "system_linux.h"
 #include "io_usb.h"
 #include "usb_internal.h"
 
@@ -55,12 +57,19 @@ typedef struct {
   char *sysfsPath;
   char *usbfsPath;
   UsbDeviceDescriptor usbDescriptor;
+  unsigned int referenceCount;
 } UsbHostDevice;
 
 static Queue *usbHostDevices = NULL;
+static char *usbfsRoot = NULL;
+
+#ifdef NETLINK_KOBJECT_UEVENT
+static int usbHotplugSocket = -1;
+static AsyncHandle usbHotplugMonitor = NULL;
+#endif /* NETLINK_KOBJECT_UEVENT */
 
 struct UsbDeviceExtensionStruct {
-  const UsbHostDevice *host;
+  UsbHostDevice *host;
   int usbfsFile;
   AsyncHandle usbfsMonitorHandle;
 };
@@ -1178,10 +1187,20 @@ usbDeallocateEndpointExtension (UsbEndpointExtension *eptx) {
   free(eptx);
 }
 
+static void
+usbReleaseHostDevice (UsbHostDevice *host) {
+  if (!--host->referenceCount) {
+    if (host->sysfsPath) free(host->sysfsPath);
+    if (host->usbfsPath) free(host->usbfsPath);
+    free(host);
+  }
+}
+
 void
 usbDeallocateDeviceExtension (UsbDeviceExtension *devx) {
   usbStopUsbfsMonitor(devx);
   usbCloseUsbfsFile(devx);
+  usbReleaseHostDevice(devx->host);
   free(devx);
 }
 
@@ -1189,9 +1208,7 @@ static void
 usbDeallocateHostDevice (void *item, void *data) {
   UsbHostDevice *host = item;
 
-  if (host->sysfsPath) free(host->sysfsPath);
-  if (host->usbfsPath) free(host->usbfsPath);
-  free(host);
+  usbReleaseHostDevice(host);
 }
 
 typedef struct {
@@ -1202,13 +1219,14 @@ typedef struct {
 
 static int
 usbTestHostDevice (void *item, void *data) {
-  const UsbHostDevice *host = item;
+  UsbHostDevice *host = item;
   UsbTestHostDeviceData *test = data;
   UsbDeviceExtension *devx;
 
   if ((devx = malloc(sizeof(*devx)))) {
     memset(devx, 0, sizeof(*devx));
     devx->host = host;
+    host->referenceCount += 1;
     devx->usbfsFile = -1;
     usbInitializeUsbfsMonitor(devx);
 
@@ -1327,6 +1345,8 @@ usbAddHostDevice (const char *path) {
   UsbHostDevice *host;
 
   if ((host = malloc(sizeof(*host)))) {
+    host->referenceCount = 1;
+
     if ((host->usbfsPath = strdup(path))) {
       host->sysfsPath = usbMakeSysfsPath(host->usbfsPath);
 
@@ -1468,7 +1488,7 @@ usbTestUsbfs (const char *path, const char *type) {
   return 0;
 }
 
-static char *
+static const char *
 usbGetUsbfs (void) {
   static const FileSystemCandidate usbfsCandidates[] = {
     {.path="/dev/bus/usb", .verify=usbVerifyDirectory},
@@ -1476,7 +1496,174 @@ usbGetUsbfs (void) {
     {.path=NULL, .verify=NULL}
   };
 
-  return usbGetFileSystem("usbfs", usbfsCandidates, usbTestUsbfs, usbVerifyUsbfs);
+  if (usbfsRoot) {
+    if (access(usbfsRoot, F_OK) != -1) return usbfsRoot;
+
+    free(usbfsRoot);
+    usbfsRoot = NULL;
+  }
+
+  if ((usbfsRoot = usbGetFileSystem("usbfs", usbfsCandidates, usbTestUsbfs, usbVerifyUsbfs))) {
+    logMessage(LOG_CATEGORY(USB_IO), "USBFS root: %s", usbfsRoot);
+  }
+
+  return usbfsRoot;
+}
+
+static int
+usbTestHostDevicePath (const void *item, void *data) {
+  const UsbHostDevice *host = item;
+  const char *path = data;
+
+  return strcmp(host->usbfsPath, path) == 0;
+}
+
+#ifdef NETLINK_KOBJECT_UEVENT
+static void
+usbStopHotplugMonitor (void) {
+  if (usbHotplugMonitor) {
+    asyncCancelRequest(usbHotplugMonitor);
+    usbHotplugMonitor = NULL;
+  }
+
+  if (usbHotplugSocket != -1) {
+    close(usbHotplugSocket);
+    usbHotplugSocket = -1;
+  }
+}
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+static void
+usbRemoveHostDevices (void) {
+#ifdef NETLINK_KOBJECT_UEVENT
+  usbStopHotplugMonitor();
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+  if (usbHostDevices) {
+    deallocateQueue(usbHostDevices);
+    usbHostDevices = NULL;
+  }
+}
+
+#ifdef NETLINK_KOBJECT_UEVENT
+static void
+usbHandleHotplugEvent (const char *action, const char *bus, const char *device) {
+  const char *root = usbfsRoot;
+
+  if (root && bus && device) {
+    char path[strlen(root) + 1 + strlen(bus) + 1 + strlen(device) + 1];
+    Element *element;
+
+    snprintf(path, sizeof(path), "%s/%s/%s", root, bus, device);
+    element = findElement(usbHostDevices, usbTestHostDevicePath, path);
+
+    if (strcmp(action, "add") == 0) {
+      if (!element) {
+        logMessage(LOG_CATEGORY(USB_IO), "USB device added: %s", path);
+        usbAddHostDevice(path);
+      }
+    } else if (strcmp(action, "remove") == 0) {
+      if (element) {
+        logMessage(LOG_CATEGORY(USB_IO), "USB device removed: %s", path);
+        deleteElement(element);
+      }
+    }
+  }
+}
+
+static void
+usbGetHotplugProperty (const char *string, const char *name, const char **value) {
+  size_t length = strlen(name);
+
+  if (strncmp(string, name, length) == 0) {
+    if (string[length] == '=') {
+      *value = &string[length + 1];
+    }
+  }
+}
+
+ASYNC_INPUT_CALLBACK(usbHandleHotplugInput) {
+  static const char label[] = "USB hotplug";
+
+  if (parameters->error) {
+    logMessage(LOG_DEBUG, "%s read error: %s", label, strerror(parameters->error));
+  } else if (parameters->end) {
+    logMessage(LOG_DEBUG, "%s end-of-file", label);
+  } else {
+    const char *string = parameters->buffer;
+    const char *end = string + parameters->length;
+
+    const char *action = NULL;
+    const char *subsystem = NULL;
+    const char *type = NULL;
+    const char *bus = NULL;
+    const char *device = NULL;
+
+    /* Each datagram is one event: "action@devpath" followed by
+     * NUL-terminated "NAME=value" properties. Events rebroadcast by
+     * udev don't have the "@" header and are ignored.
+     */
+    if (!memchr(string, '@', strnlen(string, parameters->length))) {
+      return parameters->length;
+    }
+
+    while (string < end) {
+      const char *terminator = memchr(string, 0, end-string);
+      if (!terminator) break;
+
+      usbGetHotplugProperty(string, "ACTION", &action);
+      usbGetHotplugProperty(string, "SUBSYSTEM", &subsystem);
+      usbGetHotplugProperty(string, "DEVTYPE", &type);
+      usbGetHotplugProperty(string, "BUSNUM", &bus);
+      usbGetHotplugProperty(string, "DEVNUM", &device);
+
+      string = terminator + 1;
+    }
+
+    if (action && subsystem && type) {
+      if ((strcmp(subsystem, "usb") == 0) && (strcmp(type, "usb_device") == 0)) {
+        usbHandleHotplugEvent(action, bus, device);
+      }
+    }
+
+    return parameters->length;
+  }
+
+  /* Events may have been lost so the host device list can't be trusted
+   * anymore. Forget it so that it'll be rebuilt on the next search.
+   */
+  asyncDiscardHandle(usbHotplugMonitor);
+  usbHotplugMonitor = NULL;
+  usbRemoveHostDevices();
+  return 0;
+}
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+static int
+usbStartHotplugMonitor (void) {
+#ifdef NETLINK_KOBJECT_UEVENT
+  if ((usbHotplugSocket = newKobjectUeventSocket()) != -1) {
+    if (asyncReadSocket(&usbHotplugMonitor, usbHotplugSocket,
+                        LINUX_USB_HOTPLUG_EVENT_SIZE, usbHandleHotplugInput, NULL)) {
+      logMessage(LOG_CATEGORY(USB_IO), "USB hotplug monitor started");
+      return 1;
+    }
+
+    close(usbHotplugSocket);
+    usbHotplugSocket = -1;
+  }
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+  return 0;
+}
+
+static int
+usbIsHotplugMonitored (void) {
+#ifdef NETLINK_KOBJECT_UEVENT
+  if (usbHotplugMonitor) return 1;
+#endif /* NETLINK_KOBJECT_UEVENT */
+
+  return 0;
 }
 
 UsbDevice *
@@ -1485,21 +1672,19 @@ usbFindDevice (UsbDeviceChooser *chooser, UsbChooseChannelData *data) {
     int ok = 0;
 
     if ((usbHostDevices = newQueue(usbDeallocateHostDevice, NULL))) {
-      char *root;
+      const char *root;
 
       if ((root = usbGetUsbfs())) {
-        logMessage(LOG_CATEGORY(USB_IO), "USBFS root: %s", root);
+        /* Start listening before scanning so that no device which appears
+         * in between is missed (a duplicate add is ignored).
+         */
+        usbStartHotplugMonitor();
         if (usbAddHostDevices(root)) ok = 1;
-
-        free(root);
       } else {
         logMessage(LOG_CATEGORY(USB_IO), "USBFS not mounted");
       }
 
-      if (!ok) {
-        deallocateQueue(usbHostDevices);
-        usbHostDevices = NULL;
-      }
+      if (!ok) usbRemoveHostDevices();
     }
   }
 
@@ -1518,8 +1703,8 @@ usbFindDevice (UsbDeviceChooser *chooser, UsbChooseChannelData *data) {
 
 void
 usbForgetDevices (void) {
-  if (usbHostDevices) {
-    deallocateQueue(usbHostDevices);
-    usbHostDevices = NULL;
-  }
+  /* The host device list is kept current by the hotplug monitor so it
+   * only needs to be rebuilt when there's no monitor.
+   */
+  if (!usbIsHotplugMonitored()) usbRemoveHostDevices();
 }
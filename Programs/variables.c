@@ -24,6 +24,7 @@
 #include "strfmt.h"
 #include "variables.h"
 #include "queue.h"
+#include "lock.h"
 #include "charset.h"
 
 typedef struct {
@@ -321,10 +322,17 @@ setStringVariables (VariableNestingLevel *vnl, const VariableInitializer *initia
   return 1;
 }
 
+static VariableNestingLevel *globalVariables = NULL;
+
+static LockDescriptor *
+getGlobalVariablesLock (void) {
+  static LockDescriptor *lock = NULL;
+
+  return getLockDescriptor(&lock, "global-variables");
+}
+
 VariableNestingLevel *
 getGlobalVariables (int create) {
-  static VariableNestingLevel *globalVariables = NULL;
-
   if (!globalVariables) {
     VariableNestingLevel *vnl;
 
@@ -341,7 +349,45 @@ getGlobalVariables (int create) {
 
 int
 setGlobalVariable (const char *name, const char *value) {
-  VariableNestingLevel *vnl = getGlobalVariables(1);
-  if (!vnl) return 0;
-  return setStringVariable(vnl, name, value);
+  LockDescriptor *lock = getGlobalVariablesLock();
+  int ok = 0;
+
+  if (lock) obtainExclusiveLock(lock);
+
+  {
+    VariableNestingLevel *vnl = getGlobalVariables(1);
+    if (vnl) ok = setStringVariable(vnl, name, value);
+  }
+
+  if (lock) releaseLock(lock);
+  return ok;
+}
+
+static int
+copyVariable (void *item, void *data) {
+  const Variable *from = item;
+  VariableNestingLevel *vnl = data;
+  Variable *to = findVariable(vnl, from->name.characters, from->name.length, 1);
+
+  if (!to) return 1;
+  return !setVariable(to, from->value.characters, from->value.length);
+}
+
+VariableNestingLevel *
+copyGlobalVariables (void) {
+  LockDescriptor *lock = getGlobalVariablesLock();
+  VariableNestingLevel *copy = newVariableNestingLevel(NULL, "global");
+
+  if (copy) {
+    int ok = 1;
+
+    if (lock) obtainSharedLock(lock);
+    if (globalVariables) ok = !processQueue(globalVariables->variables, copyVariable, copy);
+    if (lock) releaseLock(lock);
+
+    if (ok) return copy;
+    destroyVariableNestingLevel(copy);
+  }
+
+  return NULL;
 }
@@ -322,21 +322,25 @@ iconv_t utf8Conv = (iconv_t)(-1);
 
 #define WINHASHBITS 12
 
+/* Titles are only fetched when a window gets the focus: most windows never
+ * do, and fetching them all costs two X round trips per window. */
 static struct window {
   Window win;
   Window root;
   char *wm_name;
+  unsigned char wm_name_known;
   struct window *next;
 } *windows[(1<<WINHASHBITS)];
 
-#define WINHASH(win) windows[(win)>>(32-WINHASHBITS)^(win&((1<<WINHASHBITS)-1))]
+#define WINHASH(win) windows[((win)>>(32-WINHASHBITS)^(win))&((1<<WINHASHBITS)-1)]
 
-static void add_window(Window win, Window root, char *wm_name) {
+static void add_window(Window win, Window root) {
   struct window *cur;
   if (!(cur=malloc(sizeof(struct window))))
     fatal_errno("malloc(struct window)",NULL);
   cur->win=win;
-  cur->wm_name=wm_name;
+  cur->wm_name=NULL;
+  cur->wm_name_known=0;
   cur->root=root;
   cur->next=WINHASH(win);
   WINHASH(win)=cur;
@@ -508,7 +512,7 @@ static int grabWindows(Window win,int level) {
 
   if (!XQueryTree(dpy,win,&root,&parent,&children,&nchildren)) return 0;
 
-  add_window(win,root,getWindowTitle(win));
+  add_window(win,root);
 
   if (!children) return 1;
 
@@ -522,7 +526,20 @@ static int grabWindows(Window win,int level) {
   return res;
 }
 
-static void setName(const struct window *window) {
+static void forgetWindowTitle(struct window *window) {
+  if (window->wm_name) {
+    free(window->wm_name);
+    window->wm_name=NULL;
+  }
+  window->wm_name_known=0;
+}
+
+static void setName(struct window *window) {
+  if (!window->wm_name_known) {
+    window->wm_name=getWindowTitle(window->win);
+    window->wm_name_known=1;
+  }
+
   if (!window->wm_name)
     if (window->win==window->root) api_setName("root");
     else api_setName("unknown");
@@ -555,6 +572,66 @@ static int tryModifiers(KeyCode keycode, unsigned int *modifiers, unsigned int m
   return 1;
 }
 
+/* Resolved keysyms are remembered until the keyboard mapping changes so that
+ * typing doesn't search the mapping again for every character. */
+#define KEYSYMHASHBITS 8
+
+static struct keysymResolution {
+  KeySym keysym;
+  KeyCode keycode;
+  unsigned int modifiers;
+  unsigned char resolved;
+} keysymResolutions[(1<<KEYSYMHASHBITS)];
+
+#define KEYSYMHASH(keysym) keysymResolutions[((keysym)>>KEYSYMHASHBITS^(keysym))&((1<<KEYSYMHASHBITS)-1)]
+
+static void forgetKeysymResolutions(void) {
+  memset(keysymResolutions, 0, sizeof(keysymResolutions));
+}
+
+static int resolveKeysym(KeySym keysym, KeyCode *keycode, unsigned int *modifiers) {
+  struct keysymResolution *resolution = &KEYSYMHASH(keysym);
+
+  if (!resolution->resolved || resolution->keysym != keysym) {
+    static const unsigned int tryTable[] = {
+      0,
+      ShiftMask,
+      Mod2Mask,
+      Mod3Mask,
+      Mod4Mask,
+      Mod5Mask,
+      ShiftMask|Mod2Mask,
+      ShiftMask|Mod3Mask,
+      ShiftMask|Mod4Mask,
+      ShiftMask|Mod5Mask,
+      0
+    };
+    const unsigned int *try = tryTable;
+
+    resolution->keysym = keysym;
+    resolution->keycode = XKeysymToKeycode(dpy,keysym);
+    resolution->modifiers = 0;
+    resolution->resolved = 1;
+
+    if (resolution->keycode == NoSymbol) {
+      fprintf(stderr,gettext("xbrlapi: Couldn't translate keysym %08lX to keycode.\n"),keysym);
+    } else {
+      do {
+        if (tryModifiers(resolution->keycode, &resolution->modifiers, *try, keysym)) goto foundModifiers;
+      } while (*++try);
+
+      fprintf(stderr,gettext("xbrlapi: Couldn't find modifiers to apply to %d for getting keysym %08lX\n"),resolution->keycode,keysym);
+      resolution->keycode = NoSymbol;
+    }
+  }
+
+foundModifiers:
+  if (resolution->keycode == NoSymbol) return 0;
+  *keycode = resolution->keycode;
+  *modifiers |= resolution->modifiers;
+  return 1;
+}
+
 static void ignoreServerKeys(void) {
   brlapi_range_t range = {
     .first = BRLAPI_KEY_FLG(ControlMask|Mod1Mask),
@@ -578,7 +655,8 @@ static void toX_f(const char *display) {
 #ifdef CAN_SIMULATE_KEY_PRESSES
   int res;
   brlapi_keyCode_t code;
-  unsigned int keysym, keycode, modifiers, next_modifiers = 0;
+  unsigned int keysym, modifiers, next_modifiers = 0;
+  KeyCode keycode;
   Bool haveXTest;
   int eventBase, errorBase, majorVersion, minorVersion;
 #endif /* CAN_SIMULATE_KEY_PRESSES */
@@ -689,8 +767,8 @@ static void toX_f(const char *display) {
 	debugf("win %#010lx created\n",win);
 	if (!(window = window_of_Window(ev.xcreatewindow.parent))) {
 	  fprintf(stderr,gettext("xbrlapi: didn't grab parent of %#010lx\n"),win);
-	  add_window(win,None,getWindowTitle(win));
-	} else add_window(win,window->root,getWindowTitle(win));
+	  add_window(win,None);
+	} else add_window(win,window->root);
       } break;
       case DestroyNotify:
 	debugf("win %#010lx destroyed\n",ev.xdestroywindow.window);
@@ -707,19 +785,19 @@ static void toX_f(const char *display) {
 	  struct window *window;
 	  if (!(window=window_of_Window(win))) {
 	    fprintf(stderr,gettext("xbrlapi: didn't grab window %#010lx\n"),win);
-	    add_window(win,None,getWindowTitle(win));
+	    add_window(win,None);
 	  } else {
-	    if (window->wm_name)
-	      if (!XFree(window->wm_name)) fatal(gettext("XFree(wm_name) for change"));
-	    if ((window->wm_name=getWindowTitle(win))) {
-	      if (!quiet && win==curWindow)
-		api_setName(window->wm_name);
-	    } else fprintf(stderr,gettext("xbrlapi: window %#010lx changed to NULL name\n"),win);
+	    forgetWindowTitle(window);
+	    /* only the focused window's title is needed right away */
+	    if (!quiet && win==curWindow) setName(window);
 	  }
 	}
 	break;
       case MappingNotify:
 	XRefreshKeyboardMapping(&ev.xmapping);
+#ifdef CAN_SIMULATE_KEY_PRESSES
+	forgetKeysymResolutions();
+#endif /* CAN_SIMULATE_KEY_PRESSES */
 	break;
       /* ignored events */
       case UnmapNotify:
@@ -795,36 +873,7 @@ static void toX_f(const char *display) {
 	  case BRLAPI_KEY_TYPE_SYM:
 	    modifiers = ((code & BRLAPI_KEY_FLAGS_MASK) >> BRLAPI_KEY_FLAGS_SHIFT) & 0xFF;
 	    keysym = code & BRLAPI_KEY_CODE_MASK;
-	    keycode = XKeysymToKeycode(dpy,keysym);
-	    if (keycode == NoSymbol) {
-	      fprintf(stderr,gettext("xbrlapi: Couldn't translate keysym %08X to keycode.\n"),keysym);
-	      continue;
-	    }
-
-	    {
-	      static const unsigned int tryTable[] = {
-		0,
-		ShiftMask,
-		Mod2Mask,
-		Mod3Mask,
-		Mod4Mask,
-		Mod5Mask,
-		ShiftMask|Mod2Mask,
-		ShiftMask|Mod3Mask,
-		ShiftMask|Mod4Mask,
-		ShiftMask|Mod5Mask,
-		0
-	      };
-	      const unsigned int *try = tryTable;
-
-	      do {
-		if (tryModifiers(keycode, &modifiers, *try, keysym)) goto foundModifiers;
-	      } while (*++try);
-
-	      fprintf(stderr,gettext("xbrlapi: Couldn't find modifiers to apply to %d for getting keysym %08X\n"),keycode,keysym);
-	      continue;
-	    }
-	  foundModifiers:
+	    if (!resolveKeysym(keysym, &keycode, &modifiers)) continue;
 
 	    debugf("key %08X: (%d,%x,%x)\n", keysym, keycode, next_modifiers, modifiers);
 	    modifiers |= next_modifiers;